@@ -399,6 +399,138 @@ bool Openholo::loadAsImgUpSideDown(const char * fname, uchar* dst)
 	return true;
 }
 
+bool Openholo::loadAsImgResampled(const char* fname, uchar** dst, int nChannel, int neww, int newh, bool bUpSideDown)
+{
+	FILE *infile = fopen(fname, "rb");
+	if (infile == nullptr)
+	{
+		LOG("<FAILED> No such file.\n");
+		return false;
+	}
+
+	// BMP Header Information
+	fileheader hf;
+	bitmapinfoheader hInfo;
+	size_t nRead = fread(&hf, sizeof(fileheader), 1, infile);
+	if (nRead != 1 || hf.signature[0] != 'B' || hf.signature[1] != 'M')
+	{
+		LOG("<FAILED> Not BMP file.\n");
+		fclose(infile);
+		return false;
+	}
+	nRead = fread(&hInfo, sizeof(bitmapinfoheader), 1, infile);
+
+	const int w = hInfo.width;
+	const int h = hInfo.height;
+	const int bytesperpixel = hInfo.bitsperpixel >> 3;
+	if (nRead != 1 || w <= 0 || h <= 0 || (bytesperpixel != 1 && bytesperpixel != 3 && bytesperpixel != 4) ||
+		nChannel < 1 || nChannel > 3)
+	{
+		LOG("<FAILED> Unsupported BMP format.\n");
+		fclose(infile);
+		return false;
+	}
+
+	const int nLine = ((w * bytesperpixel) + 3) & ~3;
+	uchar *img_tmp = new uchar[(size_t)nLine * h];
+	fseek(infile, hf.fileoffset_to_pixelarray, SEEK_SET);
+	nRead = fread(img_tmp, sizeof(uchar), (size_t)nLine * h, infile);
+	fclose(infile);
+	if (nRead != (size_t)nLine * h)
+	{
+		LOG("<FAILED> Truncated BMP pixel array.\n");
+		delete[] img_tmp;
+		return false;
+	}
+
+	// byte offset of each plane in a pixel, -1 for the gray average.
+	int offset[3];
+	for (int c = 0; c < nChannel; c++)
+		offset[c] = (bytesperpixel == 1) ? 0 : (nChannel == 1) ? -1 : 2 - c;
+
+	// coefficient tables of imgScaleBilinear; the same size keeps the pixels.
+	const bool bScale = (w != neww || h != newh);
+	// a source of one pixel in width or height has no right or lower neighbour.
+	std::vector<int> xi(neww), yi(newh), xstep(neww);
+	std::vector<float> fx(neww), fy(newh);
+	for (int x = 0; x < neww; x++)
+	{
+		float gx = bScale ? (x / (float)neww) * (w - 1) : x;
+		xi[x] = (int)gx;
+		fx[x] = gx - xi[x];
+		xstep[x] = (xi[x] + 1 < w) ? bytesperpixel : 0;
+	}
+	for (int y = 0; y < newh; y++)
+	{
+		float gy = bScale ? (y / (float)newh) * (h - 1) : y;
+		yi[y] = (int)gy;
+		fy[y] = gy - yi[y];
+	}
+
+#ifdef _OPENMP
+#pragma omp parallel for firstprivate(nLine, bytesperpixel, bScale, bUpSideDown)
+#endif
+	for (int y = 0; y < newh; y++)
+	{
+		int r0 = yi[y];
+		int r1 = bScale ? (std::min)(r0 + 1, h - 1) : r0;
+		if (bUpSideDown)
+		{
+			r0 = h - 1 - r0;
+			r1 = h - 1 - r1;
+		}
+		const uchar *row0 = img_tmp + (size_t)r0 * nLine;
+		const uchar *row1 = img_tmp + (size_t)r1 * nLine;
+		const float dy = fy[y];
+
+		for (int c = 0; c < nChannel; c++)
+		{
+			const int off = offset[c];
+			uchar *out = dst[c] + (size_t)y * neww;
+
+			for (int x = 0; x < neww; x++)
+			{
+				const uchar *p00 = row0 + xi[x] * bytesperpixel;
+				if (!bScale)
+				{
+					out[x] = (off < 0) ? (p00[0] + p00[1] + p00[2]) / 3 : p00[off];
+					continue;
+				}
+				const uchar *p01 = p00 + xstep[x];
+				const uchar *p10 = row1 + xi[x] * bytesperpixel;
+				const uchar *p11 = p10 + xstep[x];
+
+				uint32_t a00, a01, a10, a11;
+				if (off < 0)
+				{
+					a00 = (p00[0] + p00[1] + p00[2]) / 3;
+					a01 = (p01[0] + p01[1] + p01[2]) / 3;
+					a10 = (p10[0] + p10[1] + p10[2]) / 3;
+					a11 = (p11[0] + p11[1] + p11[2]) / 3;
+				}
+				else
+				{
+					a00 = p00[off];
+					a01 = p01[off];
+					a10 = p10[off];
+					a11 = p11[off];
+				}
+
+				float dx = fx[x];
+				float w1 = (1 - dx) * (1 - dy);
+				float w2 = dx * (1 - dy);
+				float w3 = (1 - dx) * dy;
+				float w4 = dx * dy;
+
+				out[x] = int(a00 * w1 + a01 * w2 + a10 * w3 + a11 * w4);
+			}
+		}
+	}
+
+	delete[] img_tmp;
+	return true;
+}
+
 bool Openholo::getImgSize(int & w, int & h, int & bytesperpixel, const char * fname)
 {
 	char szExtension[FILENAME_MAX] = { 0, };
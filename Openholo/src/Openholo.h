@@ -332,6 +332,24 @@ protected:
 	*/
 	bool loadAsImgUpSideDown(const char* fname, uchar* dst);
 
+	/**
+	* @brief Function for loading image files resampled to the given size in a single pass
+	* @details The pixel array is read once, and every output row is converted and interpolated
+	*  (as imgScaleBilinear) from the two source rows it needs, through per-column and per-row
+	*  coefficient tables. Output rows are computed in parallel, and no intermediate image is made.
+	* @param[in] fname Input file name.
+	* @param[out] dst nChannel planes of neww * newh bytes. One channel is the gray average of a color
+	*  image, otherwise the planes are red, green, blue. A grayscale image is copied into every plane.
+	* @param[in] nChannel Number of planes, 1 to 3.
+	* @param[in] neww Width to replace.
+	* @param[in] newh Height to replace.
+	* @param[in] bUpSideDown If true, output image data upside down as loadAsImgUpSideDown.
+	* @return Type: <B>bool</B>\n
+	*				If the function succeeds, the return value is <B>true</B>.\n
+	*				If the function fails, the return value is <B>false</B>.
+	*/
+	bool loadAsImgResampled(const char* fname, uchar** dst, int nChannel, int neww, int newh, bool bUpSideDown = true);
+
 	/**
 	* @brief Function for getting the image size
 	* @param[out] w Image size - width.
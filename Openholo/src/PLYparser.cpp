@@ -46,6 +46,98 @@
 #include "PLYparser.h"
 #include "sys.h"
 #include <typeinfo>
+#include <numeric>
+#ifndef _MSC_VER
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#endif
+
+namespace {
+	// read-only memory map of a whole file.
+	class MappedFile {
+	public:
+		MappedFile() : data(nullptr), size(0) {}
+		~MappedFile() { unmap(); }
+
+		bool map(const std::string& fileName)
+		{
+			unmap();
+#ifdef _MSC_VER
+			hFile = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+			if (hFile == INVALID_HANDLE_VALUE)
+				return false;
+			LARGE_INTEGER len;
+			if (!GetFileSizeEx(hFile, &len) || len.QuadPart == 0)
+				return false;
+			hMap = CreateFileMappingA(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+			if (hMap == NULL)
+				return false;
+			data = (const char*)MapViewOfFile(hMap, FILE_MAP_READ, 0, 0, 0);
+			size = (size_t)len.QuadPart;
+#else
+			int fd = open(fileName.c_str(), O_RDONLY);
+			if (fd < 0)
+				return false;
+			struct stat st;
+			if (fstat(fd, &st) != 0 || st.st_size == 0) {
+				close(fd);
+				return false;
+			}
+			void* ptr = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			close(fd);
+			if (ptr == MAP_FAILED)
+				return false;
+			madvise(ptr, (size_t)st.st_size, MADV_SEQUENTIAL);
+			data = (const char*)ptr;
+			size = (size_t)st.st_size;
+#endif
+			return data != nullptr;
+		}
+
+		void unmap()
+		{
+#ifdef _MSC_VER
+			if (data) UnmapViewOfFile(data);
+			if (hMap != NULL) CloseHandle(hMap);
+			if (hFile != INVALID_HANDLE_VALUE) CloseHandle(hFile);
+			hMap = NULL;
+			hFile = INVALID_HANDLE_VALUE;
+#else
+			if (data) munmap((void*)data, size);
+#endif
+			data = nullptr;
+			size = 0;
+		}
+
+		const char* data;
+		size_t size;
+
+	private:
+#ifdef _MSC_VER
+		HANDLE hFile = INVALID_HANDLE_VALUE;
+		HANDLE hMap = NULL;
+#endif
+	};
+
+	// next token of the line [p, end) as a number, false at the end of the line.
+	inline bool nextNumber(const char*& p, const char* end, Real& value)
+	{
+		while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+			p++;
+		if (p >= end)
+			return false;
+		char token[64];
+		int len = 0;
+		while (p < end && *p != ' ' && *p != '\t' && *p != '\r') {
+			if (len < 63) token[len++] = *p;
+			p++;
+		}
+		token[len] = 0;
+		value = strtod(token, nullptr);
+		return true;
+	}
+}
 
 PLYparser::PLYparser()
 {
@@ -784,6 +876,341 @@ bool PLYparser::loadPLY(const std::string& fileName, ulonglong& n_vertices, Face
 	}
 }
 
+Real PLYparser::readBinary(const char* src, Type type, bool swap)
+{
+	char buf[8];
+	int nSize = 0;
+	switch (type) {
+	case Type::INT8: case Type::UINT8: nSize = 1; break;
+	case Type::INT16: case Type::UINT16: nSize = 2; break;
+	case Type::INT32: case Type::UINT32: case Type::FLOAT32: nSize = 4; break;
+	case Type::FLOAT64: nSize = 8; break;
+	default: return 0;
+	}
+	for (int i = 0; i < nSize; i++)
+		buf[i] = swap ? src[nSize - 1 - i] : src[i];
+
+	switch (type) {
+	case Type::INT8: return (Real)*(int8_t*)buf;
+	case Type::UINT8: return (Real)*(uint8_t*)buf;
+	case Type::INT16: { int16_t v; memcpy(&v, buf, 2); return (Real)v; }
+	case Type::UINT16: { uint16_t v; memcpy(&v, buf, 2); return (Real)v; }
+	case Type::INT32: { int32_t v; memcpy(&v, buf, 4); return (Real)v; }
+	case Type::UINT32: { uint32_t v; memcpy(&v, buf, 4); return (Real)v; }
+	case Type::FLOAT32: { float v; memcpy(&v, buf, 4); return (Real)v; }
+	default: { double v; memcpy(&v, buf, 8); return (Real)v; }
+	}
+}
+
+bool PLYparser::loadPLY(const std::string& fileName, ulonglong& n_vertices, Real** vertices, ulonglong& n_faces, uint** indices)
+{
+	std::string inputPath = fileName;
+	if ((inputPath.find(".ply") == std::string::npos) && (inputPath.find(".PLY") == std::string::npos))
+		inputPath.append(".ply");
+
+	MappedFile file;
+	if (!file.map(inputPath)) {
+		LOG("<FAILED> Loading ply file.\n");
+		return false;
+	}
+	const char* begin = file.data;
+	const char* end = file.data + file.size;
+
+	// header
+	bool isBinary = false;
+	bool isBigEndian = false;
+	bool isHeader = false;
+	std::vector<PlyElement> elements;
+	const char* p = begin;
+	for (int nLine = 0; p < end; nLine++) {
+		const char* eol = (const char*)memchr(p, '\n', end - p);
+		if (!eol) eol = end;
+		std::istringstream lineStr(std::string(p, eol));
+		p = (eol < end) ? eol + 1 : end;
+		std::string token;
+		lineStr >> token;
+
+		if (nLine == 0) {
+			if ((token != "ply") && (token != "PLY")) {
+				LOG("<FAILED> Wrong file ext: %s\n", token.c_str());
+				return false;
+			}
+		}
+		else if (token == "format") {
+			std::string str;
+			lineStr >> str;
+			if (str == "binary_little_endian") isBinary = true;
+			else if (str == "binary_big_endian") isBinary = isBigEndian = true;
+		}
+		else if (token == "element") elements.emplace_back(lineStr);
+		else if (token == "property") {
+			if (!elements.size()) {
+				LOG("<FAILED> No Elements defined, file is malformed.\n");
+				return false;
+			}
+			elements.back().properties.emplace_back(lineStr);
+		}
+		else if (token == "end_header") {
+			isHeader = true;
+			break;
+		}
+	}
+	const char* body = p;
+
+	longlong idxE_vertex = -1, idxE_face = -1;
+	int idxP_x = -1, idxP_y = -1, idxP_z = -1, idxP_list = -1;
+	bool ok_vertex = findIdxOfPropertiesAndElement(elements, "vertex", "x", idxE_vertex, idxP_x);
+	ok_vertex = ok_vertex && findIdxOfPropertiesAndElement(elements, "vertex", "y", idxE_vertex, idxP_y);
+	ok_vertex = ok_vertex && findIdxOfPropertiesAndElement(elements, "vertex", "z", idxE_vertex, idxP_z);
+	if (!isHeader || !ok_vertex) {
+		LOG("<FAILED> File is not having vertices data.\n");
+		return false;
+	}
+	bool ok_face = findIdxOfPropertiesAndElement(elements, "face", "vertex_indices", idxE_face, idxP_list);
+	if (!ok_face)
+		ok_face = findIdxOfPropertiesAndElement(elements, "face", "vertex_index", idxE_face, idxP_list);
+	if (!ok_face)
+		idxE_face = -1;
+
+	const longlong nVertex = elements[idxE_vertex].size;
+	const longlong nFace = ok_face ? elements[idxE_face].size : nVertex / 3;
+	if (nVertex <= 0 || nFace <= 0 || nVertex > UINT32_MAX) {
+		LOG("<FAILED> File is not having faces data.\n");
+		return false;
+	}
+
+	std::vector<Real> pos(nVertex * 3);
+	std::vector<uint> tri(ok_face ? nFace * 3 : 0);
+	bool bValid = true;
+
+	if (isBinary)
+	{
+		// elements are walked in order; a fixed-stride element is parsed in parallel.
+		for (size_t idxE = 0; idxE < elements.size() && bValid; ++idxE) {
+			const PlyElement& elem = elements[idxE];
+			bool bFixed = true;
+			longlong stride = 0;
+			for (auto& prop : elem.properties) {
+				if (prop.isList) bFixed = false;
+				stride += PropertyTable[prop.propertyType].first;
+			}
+
+			if (bFixed) {
+				if (end - p < stride * elem.size) {
+					bValid = false;
+					break;
+				}
+				if ((longlong)idxE == idxE_vertex) {
+					std::vector<int> offset(elem.properties.size() + 1, 0);
+					for (size_t k = 0; k < elem.properties.size(); k++)
+						offset[k + 1] = offset[k] + PropertyTable[elem.properties[k].propertyType].first;
+					const Type tX = elem.properties[idxP_x].propertyType;
+					const Type tY = elem.properties[idxP_y].propertyType;
+					const Type tZ = elem.properties[idxP_z].propertyType;
+					const int oX = offset[idxP_x], oY = offset[idxP_y], oZ = offset[idxP_z];
+					const char* src = p;
+					const int n = (int)elem.size;
+#ifdef _OPENMP
+#pragma omp parallel for firstprivate(src, stride, oX, oY, oZ, tX, tY, tZ, isBigEndian)
+#endif
+					for (int i = 0; i < n; i++) {
+						const char* q = src + (longlong)i * stride;
+						pos[i * 3 + 0] = readBinary(q + oX, tX, isBigEndian);
+						pos[i * 3 + 1] = readBinary(q + oY, tY, isBigEndian);
+						pos[i * 3 + 2] = readBinary(q + oZ, tZ, isBigEndian);
+					}
+				}
+				p += stride * elem.size;
+				continue;
+			}
+
+			// list properties make the stride variable.
+			for (longlong e = 0; e < elem.size && bValid; ++e) {
+				for (int idxP = 0; idxP < (int)elem.properties.size(); ++idxP) {
+					const PlyProperty& prop = elem.properties[idxP];
+					const int nSize = PropertyTable[prop.propertyType].first;
+					longlong count = 1;
+					if (prop.isList) {
+						const int nCount = PropertyTable[prop.listType].first;
+						if (end - p < nCount) { bValid = false; break; }
+						count = (longlong)readBinary(p, prop.listType, isBigEndian);
+						p += nCount;
+					}
+					if (count < 0 || end - p < count * nSize) { bValid = false; break; }
+					if ((longlong)idxE == idxE_face && idxP == idxP_list) {
+						if (count != 3) { bValid = false; break; }
+						for (int k = 0; k < 3; k++)
+							tri[e * 3 + k] = (uint)readBinary(p + k * nSize, prop.propertyType, isBigEndian);
+					}
+					else if ((longlong)idxE == idxE_vertex && !prop.isList) {
+						if (idxP == idxP_x) pos[e * 3 + 0] = readBinary(p, prop.propertyType, isBigEndian);
+						else if (idxP == idxP_y) pos[e * 3 + 1] = readBinary(p, prop.propertyType, isBigEndian);
+						else if (idxP == idxP_z) pos[e * 3 + 2] = readBinary(p, prop.propertyType, isBigEndian);
+					}
+					p += count * nSize;
+				}
+			}
+		}
+	}
+	else
+	{
+		// text mode : one line per element instance. The body is split at line breaks, the lines of
+		// each chunk are counted in parallel and the chunks are then parsed in parallel.
+		int nChunk = 1;
+#ifdef _OPENMP
+		nChunk = omp_get_max_threads() * 4;
+#endif
+		const longlong len = end - body;
+		std::vector<const char*> bound(nChunk + 1, end);
+		bound[0] = body;
+		for (int c = 1; c < nChunk; c++) {
+			const char* q = (std::max)(bound[c - 1], body + len * c / nChunk);
+			if (q > body && q < end && q[-1] != '\n') {
+				const char* eol = (const char*)memchr(q, '\n', end - q);
+				q = eol ? eol + 1 : end;
+			}
+			bound[c] = q;
+		}
+
+		std::vector<longlong> firstLine(nChunk + 1, 0);
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+		for (int c = 0; c < nChunk; c++) {
+			longlong n = 0;
+			for (const char* q = bound[c]; q < bound[c + 1]; q++)
+				if (*q == '\n') n++;
+			if (bound[c + 1] == end && bound[c + 1] > bound[c] && end[-1] != '\n')
+				n++;
+			firstLine[c + 1] = n;
+		}
+		std::partial_sum(firstLine.begin(), firstLine.end(), firstLine.begin());
+
+		std::vector<longlong> firstElem(elements.size() + 1, 0);
+		for (size_t idxE = 0; idxE < elements.size(); idxE++)
+			firstElem[idxE + 1] = firstElem[idxE] + elements[idxE].size;
+		if (firstLine[nChunk] < firstElem[elements.size()]) {
+			LOG("<FAILED> Truncated ply file.\n");
+			return false;
+		}
+
+		int nInvalid = 0;
+#ifdef _OPENMP
+#pragma omp parallel for reduction(+:nInvalid)
+#endif
+		for (int c = 0; c < nChunk; c++) {
+			longlong line = firstLine[c];
+			size_t idxE = 0;
+			for (const char* q = bound[c]; q < bound[c + 1]; line++) {
+				const char* eol = (const char*)memchr(q, '\n', bound[c + 1] - q);
+				if (!eol) eol = bound[c + 1];
+				const char* cur = q;
+				q = eol + 1;
+
+				while (idxE < elements.size() && line >= firstElem[idxE + 1])
+					idxE++;
+				if (idxE >= elements.size())
+					break;
+				if ((longlong)idxE != idxE_vertex && (longlong)idxE != idxE_face)
+					continue;
+
+				const PlyElement& elem = elements[idxE];
+				const longlong e = line - firstElem[idxE];
+				Real value;
+				for (int idxP = 0; idxP < (int)elem.properties.size(); ++idxP) {
+					longlong count = 1;
+					if (elem.properties[idxP].isList) {
+						if (!nextNumber(cur, eol, value)) { nInvalid++; break; }
+						count = (longlong)value;
+					}
+					if ((longlong)idxE == idxE_face && idxP == idxP_list) {
+						if (count != 3) { nInvalid++; break; }
+						for (int k = 0; k < 3; k++) {
+							if (!nextNumber(cur, eol, value)) { nInvalid++; break; }
+							tri[e * 3 + k] = (uint)value;
+						}
+						continue;
+					}
+					for (longlong k = 0; k < count; k++) {
+						if (!nextNumber(cur, eol, value)) { nInvalid++; break; }
+						if ((longlong)idxE == idxE_vertex && !elem.properties[idxP].isList) {
+							if (idxP == idxP_x) pos[e * 3 + 0] = value;
+							else if (idxP == idxP_y) pos[e * 3 + 1] = value;
+							else if (idxP == idxP_z) pos[e * 3 + 2] = value;
+						}
+					}
+				}
+			}
+		}
+		bValid = (nInvalid == 0);
+	}
+
+	if (!bValid) {
+		LOG("<FAILED> Malformed ply file, faces must be triangles.\n");
+		return false;
+	}
+
+	if (*vertices != nullptr) delete[] * vertices;
+	if (*indices != nullptr) delete[] * indices;
+
+	if (ok_face) {
+		for (longlong i = 0; i < nFace * 3; i++) {
+			if (tri[i] >= (ulonglong)nVertex) {
+				LOG("<FAILED> Vertex index out of range : %u\n", tri[i]);
+				*vertices = nullptr;
+				*indices = nullptr;
+				return false;
+			}
+		}
+		n_vertices = nVertex;
+		*vertices = new Real[nVertex * 3];
+		memcpy(*vertices, pos.data(), sizeof(Real) * nVertex * 3);
+		n_faces = nFace;
+		*indices = new uint[nFace * 3];
+		memcpy(*indices, tri.data(), sizeof(uint) * nFace * 3);
+		return true;
+	}
+
+	// triangle soup : vertices at equal positions are merged through a sort of the positions.
+	const int nSoup = (int)(nFace * 3);
+	std::vector<int> order(nSoup);
+	std::iota(order.begin(), order.end(), 0);
+	const Real* src = pos.data();
+	oph::parallelSort(order.begin(), order.end(), [src](int a, int b) {
+		const Real* pa = src + a * 3;
+		const Real* pb = src + b * 3;
+		if (pa[0] != pb[0]) return pa[0] < pb[0];
+		if (pa[1] != pb[1]) return pa[1] < pb[1];
+		return pa[2] < pb[2];
+	});
+
+	std::vector<uint> remap(nSoup);
+	std::vector<int> unique;
+	unique.reserve(nSoup);
+	for (int i = 0; i < nSoup; i++) {
+		const Real* cur = src + order[i] * 3;
+		const Real* prev = src + order[(std::max)(i - 1, 0)] * 3;
+		if (i == 0 || cur[0] != prev[0] || cur[1] != prev[1] || cur[2] != prev[2])
+			unique.push_back(order[i]);
+		remap[order[i]] = (uint)(unique.size() - 1);
+	}
+
+	n_vertices = unique.size();
+	*vertices = new Real[n_vertices * 3];
+	Real* dst = *vertices;
+	const int nUnique = (int)n_vertices;
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+	for (int i = 0; i < nUnique; i++)
+		memcpy(dst + i * 3, src + unique[i] * 3, sizeof(Real) * 3);
+
+	n_faces = nFace;
+	*indices = new uint[nSoup];
+	memcpy(*indices, remap.data(), sizeof(uint) * nSoup);
+	return true;
+}
+
 bool PLYparser::savePLY(const std::string& fileName, const ulonglong n_vertices, Face *faces, bool isBinary)
 {
 	if (faces == nullptr) {
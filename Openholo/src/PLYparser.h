@@ -146,6 +146,8 @@ private:
 		const std::string &propertyKeys,
 		longlong &elementIdx,
 		int &propertyIdx);
+
+	static Real readBinary(const char* src, Type type, bool swap);
 	
 public:
 	bool loadPLY(
@@ -173,6 +175,25 @@ public:
 		Face* faces,
 		bool isBinary
 	);
+
+	/**
+	* @brief	Load a triangle mesh as shared vertices and an index buffer.
+	* @details	The file is memory-mapped and its vertices and faces are parsed in parallel.@n
+	*			A 'face' element with a 'vertex_indices' list gives the faces directly. Without it,
+	*			every three vertices form a face, as in the Openholo Triangle Mesh Format, and
+	*			vertices at equal positions are merged.
+	* @param[out] n_vertices	number of shared vertices
+	* @param[out] vertices		positions, x, y, z per vertex
+	* @param[out] n_faces		number of triangles
+	* @param[out] indices		vertex indices, 3 per triangle
+	*/
+	bool loadPLY(
+		const std::string& fileName,
+		ulonglong& n_vertices,
+		Real** vertices,
+		ulonglong& n_faces,
+		uint** indices
+	);
 };
 
 
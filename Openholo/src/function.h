@@ -52,6 +52,10 @@
 
 #include <chrono>
 #include <random>
+#include <algorithm>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 namespace oph
 {
@@ -320,6 +324,60 @@ namespace oph
 		return dist(rand_dev);
 	}
 
+	/**
+	* @brief Get the smallest FFT-friendly length (2^a * 3^b * 5^c * 7^d) which is not less than n.
+	* @param[in] n minimum length.
+	* @return Type: <B>int</B>\n
+	*				The return value is <B>FFT length</B>.
+	*/
+	inline int getOptimalFFTSize(const int n) {
+		if (n <= 1) return 1;
+		for (int len = n; ; len++) {
+			int r = len;
+			while (r % 2 == 0) r /= 2;
+			while (r % 3 == 0) r /= 3;
+			while (r % 5 == 0) r /= 5;
+			while (r % 7 == 0) r /= 7;
+			if (r == 1) return len;
+		}
+	}
+
+	/**
+	* @brief Stable sort of [first, last), with the chunks sorted in parallel and merged pairwise.
+	* @details The order does not depend on the number of threads.
+	* @param[in] first, last random access range.
+	* @param[in] comp comparator.
+	*/
+	template<typename It, typename Compare>
+	inline void parallelSort(It first, It last, Compare comp) {
+		const int n = (int)(last - first);
+		int nChunk = 1;
+#ifdef _OPENMP
+		nChunk = omp_get_max_threads();
+#endif
+		if (nChunk < 2 || n < 4096) {
+			std::stable_sort(first, last, comp);
+			return;
+		}
+		std::vector<int> bound(nChunk + 1);
+		for (int c = 0; c <= nChunk; c++)
+			bound[c] = (int)((long long int)n * c / nChunk);
+
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+		for (int c = 0; c < nChunk; c++)
+			std::stable_sort(first + bound[c], first + bound[c + 1], comp);
+
+		for (int width = 1; width < nChunk; width *= 2) {
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+			for (int c = 0; c < nChunk - width; c += 2 * width)
+				std::inplace_merge(first + bound[c], first + bound[c + width], first + bound[(std::min)(c + 2 * width, nChunk)], comp);
+		}
+	}
+
 	inline void getPhase(oph::Complex<Real>* src, Real* dst, const int& size)
 	{
 		for (int i = 0; i < size; i++) {
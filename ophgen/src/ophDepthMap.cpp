@@ -44,6 +44,7 @@
 //M*/
 
 #include	"ophDepthMap.h"
+#include	"ophFrameSource.h"
 #include	<random>
 #ifdef _WIN64
 #include	<io.h>
@@ -54,9 +55,19 @@
 #include    "sys.h"
 #include	"tinyxml2.h"
 #include	"include.h"
+#ifdef _OPENMP
+#include	<omp.h>
+#endif
 
 ophDepthMap::ophDepthMap()
 	: ophGen()
+	, m_bLayerParallel(false)
+	, m_nLayerParallelMemory(DEPTH_LAYER_PARALLEL_MEMORY)
+	, m_bVideoMode(false)
+	, m_nVideoSize(0)
+	, m_nVideoRefresh(DEPTH_VIDEO_REFRESH)
+	, m_nVideoFrame(0)
+	, m_nVariant(0)
 	, stream_(nullptr)
 	, m_nProgress(0)
 {
@@ -69,12 +80,12 @@ ophDepthMap::ophDepthMap()
 	m_vecRGB.clear();
 
 	// CPU Variables
-	dmap_src = nullptr;
 	depth_index = nullptr;
-	dmap = 0;
 	dstep = 0;
 	dlevel.clear();
 
+	m_dFrameLatency[0] = m_dFrameLatency[1] = m_dFrameLatency[2] = 0;
+
 	setViewingWindow(false);
 	LOG("*** DEPTH MAP : BUILD DATE: %s %s ***\n\n", __DATE__, __TIME__);
 }
@@ -88,6 +99,13 @@ void ophDepthMap::setViewingWindow(bool is_ViewingWindow)
 	this->is_ViewingWindow = is_ViewingWindow;
 }
 
+void ophDepthMap::setVideoMode(bool bVideoMode, uint nRefresh)
+{
+	releaseVideo();
+	m_bVideoMode = bVideoMode;
+	m_nVideoRefresh = nRefresh;
+}
+
 bool ophDepthMap::readConfig(const char * fname)
 {
 	if (!ophGen::readConfig(fname))
@@ -186,6 +204,14 @@ bool ophDepthMap::readConfig(const char * fname)
 		LOG("<FAILED> Not found node : \'%s\' (Boolean) \n", szNodeName);
 		bRet = false;
 	}
+	// option
+	next = xml_node->FirstChildElement("AdaptiveDepthQuantization");
+	if (!next || XML_SUCCESS != next->QueryBoolText(&dm_config_.adaptive_depth_quantization))
+		dm_config_.adaptive_depth_quantization = false;
+	next = xml_node->FirstChildElement("AdaptiveDepthError");
+	if (!next || XML_SUCCESS != next->QueryDoubleText(&dm_config_.adaptive_depth_error))
+		dm_config_.adaptive_depth_error = 0.0;
+
 	sprintf(szNodeName, "FieldLength");
 	next = xml_node->FirstChildElement(szNodeName);
 	if (!next || XML_SUCCESS != next->QueryDoubleText(&dm_config_.fieldLength))
@@ -231,13 +257,6 @@ bool ophDepthMap::readImage(const char* fname, IMAGE_TYPE type)
 	int w, h, bytesperpixel;
 	// get image information
 	bool ret = getImgSize(w, h, bytesperpixel, fname);
-	// load image
-	uchar* pSrc = loadAsImg(fname);
-
-	if (pSrc == nullptr) {
-		LOG("<FAILED> Load image: %s\n", fname);
-		return false;
-	}
 
 	if (type == IMAGE_TYPE::COLOR)
 	{
@@ -245,46 +264,10 @@ bool ophDepthMap::readImage(const char* fname, IMAGE_TYPE type)
 			delete[](*it);
 		m_vecRGB.clear();
 
-		int nSize = ((w * bytesperpixel + 3) & ~3) * h;
-		uchar* pBuf = new uchar[nSize];
-
-		for (int i = 0; i < ch; i++)
-		{
-			// step 1. color relocation
-			if (ch == 1) // rgb to greyscale
-			{
-				if (bytesperpixel != 1)
-					convertToFormatGray8(pSrc, pBuf, w, h, bytesperpixel);
-				else
-					memcpy(pBuf, pSrc, nSize);
-			}
-			else if (ch == bytesperpixel)
-			{
-				// [B0,G0,R0,B1,G1,R1...] -> [R0,R1...] [G0,G1...] [B0,B1...]
-				if (!separateColor(i, w, h, pSrc, pBuf))
-				{
-					LOG("<FAILED> separateColor: %d", i);
-				}
-			}
-			else
-			{
-				memcpy(pBuf, pSrc, nSize);
-			}
-
-			uchar* pDst = new uchar[N];
-
-			if (w != pnX || h != pnY)
-			{
-				imgScaleBilinear(pBuf, pDst, w, h, pnX, pnY);
-			}
-			else
-			{
-				memcpy(pDst, pBuf, N);
-			}
-			m_vecRGB.push_back(pDst);
-		}
-		delete[] pSrc;
-		delete[] pBuf;
+		// decode, separate or gray the colors and resize in one pass.
+		for (uint i = 0; i < ch; i++)
+			m_vecRGB.push_back(new uchar[N]);
+		ret = loadAsImgResampled(fname, m_vecRGB.data(), ch, pnX, pnY, false);
 
 		// 2019-10-14 mwnam
 		m_vecRGBImg[_X] = pnX;
@@ -295,23 +278,18 @@ bool ophDepthMap::readImage(const char* fname, IMAGE_TYPE type)
 		if (depth_img) delete[] depth_img;
 
 		depth_img = new uchar[N];
-		memset(depth_img, 0, N);
-
-		uchar* pBuf = new uchar[((w + 3) & ~3) * h];
-		convertToFormatGray8(pSrc, pBuf, w, h, bytesperpixel);
-
-		if (w != pnX || h != pnY)
-			imgScaleBilinear(pBuf, depth_img, w, h, pnX, pnY);
-		else
-			memcpy(depth_img, pBuf, N);
+		ret = loadAsImgResampled(fname, &depth_img, 1, pnX, pnY, false);
 
-		delete[] pSrc;
-		delete[] pBuf;
 		// 2019-10-14 mwnam
 		m_vecDepthImg[_X] = pnX;
 		m_vecDepthImg[_Y] = pnY;
 	}
-	LOG("Load Image(%s)\n Path: %d\nResolution: %dx%d\nBytePerPixel: %d",
+
+	if (!ret) {
+		LOG("<FAILED> Load image: %s\n", fname);
+		return false;
+	}
+	LOG("Load Image(%s)\n Path: %s\nResolution: %dx%d\nBytePerPixel: %d",
 		type == IMAGE_TYPE::COLOR ? "Color" : "Depth", fname, w, h, bytesperpixel);
 
 	return true;
@@ -372,6 +350,7 @@ bool ophDepthMap::readImageDepth(const char* source_folder, const char* img_name
 	const int pnX = context_.pixel_number[_X];
 	const int pnY = context_.pixel_number[_Y];
 	const int N = pnX * pnY;
+	const int ch = context_.waveNum;
 
 	for (size_t i = 0; i < m_vecRGB.size(); i++)
 	{
@@ -387,50 +366,17 @@ bool ophDepthMap::readImageDepth(const char* source_folder, const char* img_name
 	sprintf(imgPath, "%s/%s.bmp", source_folder, img_name);
 #endif
 
-	int w, h, bytesperpixel;
-	bool ret = getImgSize(w, h, bytesperpixel, imgPath);
+	// decode, separate or gray the colors and resize in one pass.
+	for (int i = 0; i < ch; i++)
+		m_vecRGB.push_back(new uchar[N]);
 
-	// RGB Image
-	oph::uchar* buf = new uchar[w * h * bytesperpixel]; // 1-Dimension left top
-	ret = loadAsImgUpSideDown(imgPath, buf);
-	if (!ret) {
+	if (!loadAsImgResampled(imgPath, m_vecRGB.data(), ch, pnX, pnY, true)) {
 		LOG("<FAILED> Image Load: %s\n", imgPath);
 		LOG("%s : %.5lf (sec)\n", __FUNCTION__, ELAPSED_TIME(begin, CUR_TIME));
 		return false;
 	}
 	LOG(" <SUCCEEDED> Image Load: %s\n", imgPath);
 
-	int ch = context_.waveNum;
-	uchar* img = new uchar[w * h];
-
-	for (int i = 0; i < ch; i++)
-	{
-		if (ch == 1) // rgb img to grayscale
-			convertToFormatGray8(buf, img, w, h, bytesperpixel);
-		else if (ch == bytesperpixel) // rgb img to rgb
-		{
-			separateColor(i, w, h, buf, img);
-		}
-		else // grayscale img to rgb
-		{
-			memcpy(img, buf, sizeof(char) * w * h);
-		}
-
-
-		//resized image
-		uchar *rgb_img = new uchar[N];
-		memset(rgb_img, 0, sizeof(char) * N);
-
-		if (w != pnX || h != pnY)
-			imgScaleBilinear(img, rgb_img, w, h, pnX, pnY);
-		else
-			memcpy(rgb_img, img, sizeof(char) * N);
-
-		m_vecRGB.push_back(rgb_img);
-	}
-	delete[] buf;
-	delete[] img;
-
 	// 2019-10-14 mwnam
 	m_vecRGBImg[_X] = pnX;
 	m_vecRGBImg[_Y] = pnY;
@@ -443,43 +389,21 @@ bool ophDepthMap::readImageDepth(const char* source_folder, const char* img_name
 #else
 	sprintf(dimgPath, "%s/%s.bmp", source_folder, depth_img_name);
 #endif
-	ret = getImgSize(w, h, bytesperpixel, dimgPath);
-	
-	// Depth Image
-	uchar* dbuf = new uchar[w * h * bytesperpixel];
-	ret = loadAsImgUpSideDown(dimgPath, dbuf);
-	if (!ret) {
+
+	if (depth_img) delete[] depth_img;
+	depth_img = new uchar[N];
+
+	if (!loadAsImgResampled(dimgPath, &depth_img, 1, pnX, pnY, true)) {
 		LOG("<FAILED> Image Load: %s\n", dimgPath);
 		LOG("%s : %.5lf (sec)\n", __FUNCTION__, ELAPSED_TIME(begin, CUR_TIME));
 		return false;
 	}
 	LOG(" <SUCCEEDED> Image Load: %s\n", dimgPath);
 
-	// 2019-10-14 mwnam
-	m_vecDepthImg[_X] = w;
-	m_vecDepthImg[_Y] = h;
-
-	uchar* dimg = new uchar[w * h];
-	convertToFormatGray8(dbuf, dimg, w, h, bytesperpixel);
-
-	delete[] dbuf;
-
-	if (depth_img) delete[] depth_img;
-
-	depth_img = new uchar[N];
-	memset(depth_img, 0, sizeof(char) * N);
-
-	if (w != pnX || h != pnY)
-		imgScaleBilinear(dimg, depth_img, w, h, pnX, pnY);
-	else
-		memcpy(depth_img, dimg, sizeof(char) * N);
-
 	// 2019-10-14 mwnam
 	m_vecDepthImg[_X] = pnX;
 	m_vecDepthImg[_Y] = pnY;
 
-	delete[] dimg;
-
 	LOG("%s : %.5lf (sec)\n", __FUNCTION__, ELAPSED_TIME(begin, CUR_TIME));
 	return true;
 }
@@ -520,14 +444,201 @@ Real ophDepthMap::generateHologram()
 		getDepthValues();
 		//if (is_ViewingWindow)
 		//	transVW();
-		calcHoloCPU();
+		if (m_bVideoMode)
+			calcHoloVideoCPU();
+		else
+			calcHoloCPU();
+	}
+	Real elapsed_time = ELAPSED_TIME(begin, CUR_TIME);
+	LOG("Total Elapsed Time: %lf (s)\n", elapsed_time);
+	m_nProgress = 0;
+	return elapsed_time;
+}
+
+Real ophDepthMap::generateFrame(ophFrameSource* source, unsigned int ENCODE_FLAG, int timeout, bool bLatest)
+{
+	if (!source || !source->acquire(timeout, bLatest))
+		return -1.0;
+
+	const uint nChannel = context_.waveNum;
+	if (source->getSize() != context_.pixel_number || source->getChannels() != nChannel)
+	{
+		LOG("<FAILED> Frame (%dx%d, %u channels) does not match the hologram (%dx%d, %u channels).\n",
+			source->getSize()[_X], source->getSize()[_Y], source->getChannels(),
+			context_.pixel_number[_X], context_.pixel_number[_Y], nChannel);
+		source->release();
+		return -1.0;
 	}
+
+	// point the inputs at the slot instead of copying it; the owned buffers are restored afterwards.
+	vector<uchar*> vecRGB;
+	vecRGB.swap(m_vecRGB);
+	uchar* pDepth = depth_img;
+	ivec2 rgbSize = m_vecRGBImg, depthSize = m_vecDepthImg;
+	for (uint ch = 0; ch < nChannel; ch++)
+		m_vecRGB.push_back(source->getColor(ch));
+	depth_img = source->getDepth();
+	m_vecRGBImg = m_vecDepthImg = context_.pixel_number;
+
+	m_dFrameLatency[0] = source->getIngestLatency();
+	m_dFrameLatency[1] = generateHologram();
+
+	m_vecRGB.swap(vecRGB);
+	depth_img = pDepth;
+	m_vecRGBImg = rgbSize;
+	m_vecDepthImg = depthSize;
+	source->release();
+
+	auto begin = CUR_TIME;
+	encoding(ENCODE_FLAG);
+	m_dFrameLatency[2] = ELAPSED_TIME(begin, CUR_TIME);
+
+	LOG("%s : frame %llu, ingest %.5lf, compute %.5lf, encode %.5lf (sec)\n", __FUNCTION__,
+		source->getFrameNumber(), m_dFrameLatency[0], m_dFrameLatency[1], m_dFrameLatency[2]);
+	return m_dFrameLatency[0] + m_dFrameLatency[1] + m_dFrameLatency[2];
+}
+
+Real ophDepthMap::generateHologramVariants(uint nVariant)
+{
+	auto begin = CUR_TIME;
+	if (nVariant == 0)
+		return 0.0;
+	if (m_mode & MODE_GPU)
+		LOG("Random phase variants are generated on the CPU.\n");
+
+	resetBuffer();
+	convertImage();
+	m_vecEncodeSize = context_.pixel_number;
+	initCPU();
+	prepareInputdataCPU();
+	getDepthValues();
+	calcHoloVariantsCPU(nVariant);
+
 	Real elapsed_time = ELAPSED_TIME(begin, CUR_TIME);
 	LOG("Total Elapsed Time: %lf (s)\n", elapsed_time);
 	m_nProgress = 0;
 	return elapsed_time;
 }
 
+void ophDepthMap::calcHoloVariantsCPU(uint nVariant)
+{
+	auto begin = CUR_TIME;
+
+	const uint pnX = context_.pixel_number[_X];
+	const uint pnY = context_.pixel_number[_Y];
+	const long long int N = pnX * pnY;
+	const uint nChannel = context_.waveNum;
+	size_t depth_sz = dm_config_.render_depth.size();
+
+	releaseVariants();
+	m_nVariant = nVariant;
+	for (uint v = 0; v < nVariant * nChannel; v++)
+	{
+		Complex<Real> *H = new Complex<Real>[N];
+		memset(H, 0, sizeof(Complex<Real>) * N);
+		m_vecVariantH.push_back(H);
+	}
+
+	// one engine for all phases; oph::rand reseeds from the clock on every call.
+	std::random_device rd;
+	std::mt19937_64 engine(((unsigned long long)rd() << 32) | rd());
+	std::uniform_real_distribution<Real> dist(0.0, 1.0);
+	vector<Complex<Real>> phase(nVariant);
+
+	Complex<Real> *input = new Complex<Real>[N];
+	Complex<Real> *spec = new Complex<Real>[N];
+
+	fftInit2D(context_.pixel_number, OPH_FORWARD, OPH_ESTIMATE);
+
+	for (uint ch = 0; ch < nChannel; ch++)
+	{
+		Real lambda = context_.wave_length[ch];
+		Real k = context_.k = (2 * M_PI / lambda);
+		const uchar *rgb = m_vecRGB[ch];
+
+		for (size_t i = 0; i < depth_sz; i++)
+		{
+			int dtr = dm_config_.render_depth[i];
+			if (depth_fill[dtr])
+			{
+				memset(input, 0, sizeof(Complex<Real>) * N);
+				memset(spec, 0, sizeof(Complex<Real>) * N);
+				Real temp_depth = (is_ViewingWindow) ? dlevel_transform[dtr - 1] : dlevel[dtr - 1];
+
+				Complex<Real> carrier_phase_delay(0, k * -temp_depth);
+				carrier_phase_delay.exp();
+
+				const uint *pixel = &depth_pixel[depth_offset[dtr]];
+				const long long int nPixel = depth_offset[dtr + 1] - depth_offset[dtr];
+#ifdef _OPENMP
+#pragma omp parallel for firstprivate(carrier_phase_delay)
+#endif
+				for (long long int j = 0; j < nPixel; j++)
+				{
+					uint idx = pixel[j];
+					input[idx] = carrier_phase_delay * (Real(rgb[idx]) / 255.0);
+				}
+
+				propagateLayer(input, spec, lambda, temp_depth, getBandLimitedASMSize(lambda, temp_depth, input));
+
+				for (uint v = 0; v < nVariant; v++)
+				{
+					phase[v][_RE] = 0.0;
+					phase[v][_IM] = 2 * M_PI * dist(engine);
+					phase[v].exp();
+				}
+
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+				for (long long int j = 0; j < N; j++)
+				{
+					const Complex<Real> s = spec[j];
+					for (uint v = 0; v < nVariant; v++)
+						m_vecVariantH[v * nChannel + ch][j] += phase[v] * s;
+				}
+			}
+			m_nProgress = (int)((Real)(ch * depth_sz + i) * 100 / (depth_sz * nChannel));
+		}
+		memcpy(complex_H[ch], m_vecVariantH[ch], sizeof(Complex<Real>) * N);
+	}
+	delete[] input;
+	delete[] spec;
+	fftFree();
+	LOG("%s : %u variants, %.5lf (sec)\n", __FUNCTION__, nVariant, ELAPSED_TIME(begin, CUR_TIME));
+}
+
+Complex<Real>* ophDepthMap::getVariantField(uint idx, uint ch)
+{
+	const uint nChannel = m_nVariant ? (uint)m_vecVariantH.size() / m_nVariant : 0;
+	if (idx >= m_nVariant || ch >= nChannel)
+		return nullptr;
+	return m_vecVariantH[idx * nChannel + ch];
+}
+
+bool ophDepthMap::selectVariant(uint idx)
+{
+	if (idx >= m_nVariant)
+		return false;
+
+	const long long int N = context_.pixel_number[_X] * context_.pixel_number[_Y];
+	const uint nChannel = (uint)m_vecVariantH.size() / m_nVariant;
+	if (nChannel != context_.waveNum)
+		return false;
+
+	for (uint ch = 0; ch < nChannel; ch++)
+		memcpy(complex_H[ch], m_vecVariantH[idx * nChannel + ch], sizeof(Complex<Real>) * N);
+	return true;
+}
+
+void ophDepthMap::releaseVariants()
+{
+	for (size_t i = 0; i < m_vecVariantH.size(); i++)
+		delete[] m_vecVariantH[i];
+	m_vecVariantH.clear();
+	m_nVariant = 0;
+}
+
 void ophDepthMap::encoding(unsigned int ENCODE_FLAG)
 {
 	//ophGen::encoding(ENCODE_FLAG);
@@ -619,6 +730,14 @@ void ophDepthMap::getDepthValues()
 		else
 			changeDepthQuanGPU();
 	}
+
+	if (dm_config_.adaptive_depth_quantization)
+	{
+		if (m_mode & MODE_GPU)
+			LOG("<FAILED> Adaptive depth quantization is supported on the CPU only.\n");
+		else
+			adaptDepthQuanCPU();
+	}
 	LOG("%s : %.5lf (sec)\n", __FUNCTION__, ELAPSED_TIME(begin, CUR_TIME));
 }
 
@@ -638,39 +757,12 @@ void ophDepthMap::initCPU()
 	const uint pnX = context_.pixel_number[_X];
 	const uint pnY = context_.pixel_number[_Y];
 	const uint N = pnX * pnY;
-	const uint nChannel = context_.waveNum;
 
 	dlevel.clear();
 
-	for (vector<Real *>::iterator it = m_vecImgSrc.begin(); it != m_vecImgSrc.end(); it++)
-	{
-		delete[](*it);
-	}
-	m_vecImgSrc.clear();
-	for (vector<int *>::iterator it = m_vecAlphaMap.begin(); it != m_vecAlphaMap.end(); it++)
-	{
-		delete[](*it);
-	}
-	m_vecAlphaMap.clear();
-
-	for (uint ch = 0; ch < nChannel; ch++)
-	{
-		Real *img_src = new Real[N];
-		int *alpha_map = new int[N];
-
-		m_vecImgSrc.push_back(img_src);
-		m_vecAlphaMap.push_back(alpha_map);
-	}
-
-	if (dmap_src) delete[] dmap_src;
-	dmap_src = new Real[N];
-
 	if (depth_index) delete[] depth_index;
 	depth_index = new uint[N];
 
-	if (dmap) delete[] dmap;
-	dmap = new Real[N];
-
 	fftw_cleanup();
 }
 
@@ -678,9 +770,6 @@ bool ophDepthMap::prepareInputdataCPU()
 {
 	auto begin = CUR_TIME;
 	const long long int N = context_.pixel_number[_X] * context_.pixel_number[_Y];
-	const uint nChannel = context_.waveNum;
-
-	memset(depth_index, 0, sizeof(uint) * N);
 
 	if (depth_img == nullptr) // not used depth
 	{
@@ -688,29 +777,17 @@ bool ophDepthMap::prepareInputdataCPU()
 		memset(depth_img, 0, N);
 	}
 
-	Real gapDepth = dm_config_.far_depthmap - dm_config_.near_depthmap;
-	Real nearDepth = dm_config_.near_depthmap;
-
-	for (uint ch = 0; ch < nChannel; ch++)
+	// the layers read the 8-bit RGB & depth images directly; only the default quantization is set here.
+	if (dm_config_.change_depth_quantization == 0)
 	{
+		const uint nDefault = dm_config_.default_depth_quantization;
 #ifdef _OPENMP
-#pragma omp parallel for firstprivate(gapDepth, nearDepth)
+#pragma omp parallel for firstprivate(nDefault)
 #endif
 		for (long long int k = 0; k < N; k++)
-		{
-			m_vecImgSrc[ch][k] = Real(m_vecRGB[ch][k]) / 255.0; // RGB IMG
-			m_vecAlphaMap[ch][k] = (m_vecRGB[ch][k] > 0 ? 1 : 0); // RGB IMG
+			depth_index[k] = nDefault - depth_img[k];
 
-			// once
-			if (ch == 0)
-			{
-				dmap_src[k] = Real(depth_img[k]) / 255.0; // DEPTH IMG
-				dmap[k] = (1 - dmap_src[k]) * gapDepth + nearDepth;
-				if (dm_config_.change_depth_quantization == 0) {
-					depth_index[k] = dm_config_.default_depth_quantization - depth_img[k];
-				}
-			}
-		}
+		sortDepthIndexCPU();
 	}
 
 	LOG("%s : %.5lf (sec)\n", __FUNCTION__, ELAPSED_TIME(begin, CUR_TIME));
@@ -728,25 +805,236 @@ void ophDepthMap::changeDepthQuanCPU()
 	
 	double nearv = dlevel[0];
 	double half_step = dstep / 2.0;
-	depth_fill.clear();
-	depth_fill.resize(dm_config_.render_depth.size() + 1, 0);
 	Real locDstep = dstep;
+	Real gapDepth = far_depth - near_depth;
+
+	// the depth image has 256 values, so quantize through a lookup table.
+	uint lut[256];
+	for (int v = 0; v < 256; v++)
+	{
+		Real dmap = (1 - Real(v) / 255.0) * gapDepth + near_depth;
+		int idx = int(((dmap - nearv) + half_step) / locDstep);
+		lut[v] = idx + 1;
+	}
+
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+	for (long long int i = 0; i < N; i++)
+		depth_index[i] = lut[depth_img[i]];
+
+	sortDepthIndexCPU();
+
+	LOG("%s : %.5lf (sec)\n", __FUNCTION__, ELAPSED_TIME(begin, CUR_TIME));
+}
+
+void ophDepthMap::adaptDepthQuanCPU()
+{
+	auto begin = CUR_TIME;
+	const long long int N = context_.pixel_number[_X] * context_.pixel_number[_Y];
+	const uint nChannel = context_.waveNum;
+	const int nBin = 256;
+	const uint maxLevel = max(dm_config_.num_of_depth, 1u);
+	const Real gapDepth = dm_config_.far_depthmap - dm_config_.near_depthmap;
+	const Real nearDepth = dm_config_.near_depthmap;
+
+	// histogram of the visible pixels; black pixels do not contribute to the hologram.
+	vector<Real> hist(nBin, 0);
+	for (long long int i = 0; i < N; i++)
+	{
+		bool bVisible = false;
+		for (uint ch = 0; ch < nChannel && !bVisible; ch++)
+			bVisible = m_vecRGB[ch][i] != 0;
+		if (bVisible)
+			hist[depth_img[i]]++;
+	}
+
+	vector<Real> z(nBin);
+	Real total = 0;
+	for (int b = 0; b < nBin; b++)
+	{
+		z[b] = (1 - b / 255.0) * gapDepth + nearDepth;
+		total += hist[b];
+	}
+	if (total == 0) return;
+
+	// occupied uniform layers, the baseline FFT count.
+	uint nUniform = 0;
+	for (size_t i = 0; i < dm_config_.render_depth.size(); i++)
+	{
+		int dtr = dm_config_.render_depth[i];
+		if (dtr >= 0 && dtr < (int)depth_fill.size() && depth_fill[dtr])
+			nUniform++;
+	}
+
+	// z is descending with the bin, so cell j is the bin range [bound[j], bound[j + 1]).
+	vector<Real> level;
+	vector<int> bound;
+	Real rms = 0;
+	auto lloydMax = [&](uint K) {
+		// start from the quantiles of the histogram.
+		level.assign(K, 0);
+		bound.assign(K + 1, nBin);
+		bound[0] = 0;
+		Real acc = 0;
+		uint j = 1;
+		for (int b = 0; b < nBin && j < K; b++)
+		{
+			acc += hist[b];
+			while (j < K && acc >= total * j / K)
+				bound[j++] = b + 1;
+		}
+
+		for (int iter = 0; iter < 100; iter++)
+		{
+			// centroids of the cells.
+			for (uint k = 0; k < K; k++)
+			{
+				Real w = 0, wz = 0;
+				for (int b = bound[k]; b < bound[k + 1]; b++)
+				{
+					w += hist[b];
+					wz += hist[b] * z[b];
+				}
+				if (w > 0)
+					level[k] = wz / w;
+				else if (bound[k] < nBin)
+					level[k] = z[min(bound[k], nBin - 1)];
+				else
+					level[k] = z[nBin - 1];
+			}
+			// nearest-level boundaries.
+			bool bChanged = false;
+			for (uint k = 1; k < K; k++)
+			{
+				Real mid = (level[k - 1] + level[k]) / 2;
+				int b = bound[k - 1];
+				while (b < nBin && z[b] > mid) b++;
+				if (b != bound[k])
+				{
+					bound[k] = b;
+					bChanged = true;
+				}
+			}
+			if (!bChanged) break;
+		}
+
+		Real err = 0;
+		for (uint k = 0; k < K; k++)
+			for (int b = bound[k]; b < bound[k + 1]; b++)
+				err += hist[b] * (z[b] - level[k]) * (z[b] - level[k]);
+		rms = sqrt(err / total);
+	};
+
+	uint nOccupied = 0;
+	for (int b = 0; b < nBin; b++)
+		if (hist[b] > 0) nOccupied++;
+
+	uint K = min(maxLevel, nOccupied);
+	if (dm_config_.adaptive_depth_error > 0)
+	{
+		for (K = 1; K < min(maxLevel, nOccupied); K++)
+		{
+			lloydMax(K);
+			if (rms <= dm_config_.adaptive_depth_error) break;
+		}
+	}
+	lloydMax(K);
+
+	// levels ordered near to far, as the uniform 'dlevel'.
+	vector<uint> binLevel(nBin);
+	dlevel.clear();
+	for (uint k = 0; k < K; k++)
+	{
+		uint idx = K - k;
+		dlevel.insert(dlevel.begin(), level[k]);
+		for (int b = bound[k]; b < bound[k + 1]; b++)
+			binLevel[b] = idx;
+	}
+	if (is_ViewingWindow)
+		transVW();
 
 #ifdef _OPENMP
-#pragma omp parallel for firstprivate(nearv, half_step, locDstep)
+#pragma omp parallel for
 #endif
 	for (long long int i = 0; i < N; i++)
+		depth_index[i] = binLevel[depth_img[i]];
+
+	sortDepthIndexCPU();
+
+	uint nAdaptive = 0;
+	for (size_t i = 0; i < dm_config_.render_depth.size(); i++)
 	{
-		int idx = int(((dmap[i] - nearv) + half_step) / locDstep);
-		depth_index[i] = idx + 1;
-		depth_fill[idx + 1] = 1;
+		int dtr = dm_config_.render_depth[i];
+		if (dtr >= 0 && dtr < (int)depth_fill.size() && depth_fill[dtr])
+			nAdaptive++;
 	}
 
+	LOG("%s : %u layers (uniform %u), %u fewer FFTs per channel, RMS depth error %e\n",
+		__FUNCTION__, nAdaptive, nUniform, nUniform > nAdaptive ? nUniform - nAdaptive : 0, rms);
 	LOG("%s : %.5lf (sec)\n", __FUNCTION__, ELAPSED_TIME(begin, CUR_TIME));
 }
 
+void ophDepthMap::sortDepthIndexCPU()
+{
+	const long long int N = context_.pixel_number[_X] * context_.pixel_number[_Y];
+
+	uint max_index = 0;
+	for (size_t i = 0; i < dm_config_.render_depth.size(); i++)
+		max_index = max(max_index, (uint)dm_config_.render_depth[i]);
+	for (long long int i = 0; i < N; i++)
+		max_index = max(max_index, depth_index[i]);
+
+	depth_offset.assign(max_index + 2, 0);
+	for (long long int i = 0; i < N; i++)
+		depth_offset[depth_index[i] + 1]++;
+	for (uint d = 0; d <= max_index; d++)
+		depth_offset[d + 1] += depth_offset[d];
+
+	vector<uint> pos(depth_offset.begin(), depth_offset.end() - 1);
+	depth_pixel.resize(N);
+	for (long long int i = 0; i < N; i++)
+		depth_pixel[pos[depth_index[i]]++] = (uint)i;
+
+	depth_fill.assign(max_index + 1, 0);
+	for (uint d = 0; d <= max_index; d++)
+		depth_fill[d] = depth_offset[d + 1] > depth_offset[d] ? 1 : 0;
+}
+
 void ophDepthMap::calcHoloCPU()
 {
+	calcHoloCPU(0, dm_config_.render_depth.size());
+}
+
+bool ophDepthMap::prepareTiles(uint /*flag*/)
+{
+	if (m_vecRGB.empty())
+		return false;
+
+	resetBuffer();
+	convertImage();
+	m_vecEncodeSize = context_.pixel_number;
+	initCPU();
+	prepareInputdataCPU();
+	getDepthValues();
+	return true;
+}
+
+bool ophDepthMap::generateTiles(uint begin, uint end)
+{
+	if (end <= begin || end > dm_config_.render_depth.size())
+		return false;
+
+	calcHoloCPU(begin, end);
+	return true;
+}
+
+void ophDepthMap::calcHoloCPU(size_t start, size_t end)
+{
+#ifdef _OPENMP
+	if (m_bLayerParallel && omp_get_max_threads() > 1 && end - start > 1 && calcHoloLayerParallel(start, end))
+		return;
+#endif
 	auto begin = CUR_TIME;
 
 	const uint pnX = context_.pixel_number[_X];
@@ -765,10 +1053,9 @@ void ophDepthMap::calcHoloCPU()
 	{
 		Real lambda = context_.wave_length[ch];
 		Real k = context_.k = (2 * M_PI / lambda);
-		Real *img_src = m_vecImgSrc[ch];
-		int *alpha_map = m_vecAlphaMap[ch];
+		const uchar *rgb = m_vecRGB[ch];
 
-		for (size_t i = 0; i < depth_sz; i++)
+		for (size_t i = start; i < end; i++)
 		{
 			int dtr = dm_config_.render_depth[i];
 			if (depth_fill[dtr])
@@ -780,19 +1067,22 @@ void ophDepthMap::calcHoloCPU()
 				GetRandomPhaseValue(rand_phase_val, bRandomPhase);
 
 				Complex<Real> carrier_phase_delay(0, k * -temp_depth);
-				carrier_phase_delay.exp();				
+				carrier_phase_delay.exp();
+				Complex<Real> phase = rand_phase_val * carrier_phase_delay;
+
+				// scatter only the pixels of this depth.
+				const uint *pixel = &depth_pixel[depth_offset[dtr]];
+				const long long int nPixel = depth_offset[dtr + 1] - depth_offset[dtr];
 #ifdef _OPENMP
-#pragma omp parallel for firstprivate(dtr, rand_phase_val, carrier_phase_delay)
+#pragma omp parallel for firstprivate(phase)
 #endif
-				for (long long int j = 0; j < N; j++)
+				for (long long int j = 0; j < nPixel; j++)
 				{
-					input[j][_RE] = img_src[j] * alpha_map[j] * ((int)depth_index[j] == dtr ? 1.0 : 0.0);
-					input[j] *= rand_phase_val * carrier_phase_delay;
+					uint idx = pixel[j];
+					input[idx] = phase * (Real(rgb[idx]) / 255.0);
 				}
 
-				fft2(input, input, pnX, pnY, OPH_FORWARD, false);
-				AngularSpectrumMethod(input, complex_H[ch], lambda, temp_depth);
-
+				propagateLayer(input, complex_H[ch], lambda, temp_depth, getBandLimitedASMSize(lambda, temp_depth, input));
 			}
 			m_nProgress = (int)((Real)(ch * depth_sz + i) * 100 / (depth_sz * nChannel));
 		}
@@ -803,9 +1093,424 @@ void ophDepthMap::calcHoloCPU()
 	LOG("%s : %.5lf (sec)\n", __FUNCTION__, ELAPSED_TIME(begin, CUR_TIME));
 }
 
+void ophDepthMap::propagateLayer(Complex<Real>* input, Complex<Real>* dst, Real lambda, Real depth, const ivec2& size)
+{
+	const uint pnX = context_.pixel_number[_X];
+	const uint pnY = context_.pixel_number[_Y];
+	const long long int N = pnX * pnY;
+
+	if (size == context_.pixel_number)
+	{
+		fft2(input, input, pnX, pnY, OPH_FORWARD, false);
+		AngularSpectrumMethod(input, dst, lambda, depth, true);
+	}
+	else
+	{
+		// the layer would wrap onto the hologram: propagate on the padded grid.
+		BandLimitedASM(input, input, lambda, depth, size);
+		fft2(input, input, pnX, pnY, OPH_FORWARD, false);
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+		for (long long int j = 0; j < N; j++)
+			dst[j] += input[j];
+	}
+}
+
+void ophDepthMap::calcHoloVideoCPU()
+{
+	auto begin = CUR_TIME;
+
+	const uint pnX = context_.pixel_number[_X];
+	const uint pnY = context_.pixel_number[_Y];
+	const long long int N = pnX * pnY;
+	const uint nChannel = context_.waveNum;
+	const bool bRandomPhase = GetRandomPhase();
+
+	// the kept frame is only valid for the same hologram size and wavelengths.
+	bool bValid = (m_nVideoSize == N) && (m_vecVideoH.size() == nChannel);
+	for (uint ch = 0; bValid && ch < nChannel; ch++)
+		bValid = (m_vecVideoLambda[ch] == context_.wave_length[ch]);
+	if (!bValid)
+	{
+		releaseVideo();
+		m_nVideoSize = N;
+		m_vecVideoLayer.resize(nChannel);
+		for (uint ch = 0; ch < nChannel; ch++)
+		{
+			m_vecVideoH.push_back(new Complex<Real>[N]);
+			memset(m_vecVideoH[ch], 0, sizeof(Complex<Real>) * N);
+			m_vecVideoLambda.push_back(context_.wave_length[ch]);
+		}
+	}
+
+	// rounding errors of the differences build up in the kept spectrum, so it is
+	// regenerated from scratch every m_nVideoRefresh frames.
+	const bool bRefresh = (m_nVideoRefresh > 0) && (m_nVideoFrame % m_nVideoRefresh == 0);
+	m_nVideoFrame++;
+
+	// depth indices rendered in this frame.
+	size_t nDepth = depth_offset.size() - 1;
+	vector<bool> render(nDepth, false);
+	for (size_t i = 0; i < dm_config_.render_depth.size(); i++)
+	{
+		int dtr = dm_config_.render_depth[i];
+		if (dtr > 0 && dtr < (int)nDepth && depth_fill[dtr])
+			render[dtr] = true;
+	}
+
+	std::random_device rd;
+	std::mt19937_64 engine(((unsigned long long)rd() << 32) | rd());
+	std::uniform_real_distribution<Real> dist(0.0, 1.0);
+
+	Complex<Real> *input = new Complex<Real>[N];
+	vector<VideoLayer> next;
+	vector<bool> changed;
+	uint nPropagation = 0;
+	uint nChanged = 0;
+	uint nTotal = 0;
+	bool bRegenerated = false;
+
+	fftInit2D(context_.pixel_number, OPH_FORWARD, OPH_ESTIMATE);
+
+	for (uint ch = 0; ch < nChannel; ch++)
+	{
+		Real lambda = context_.wave_length[ch];
+		Real k = context_.k = (2 * M_PI / lambda);
+		const uchar *rgb = m_vecRGB[ch];
+		vector<VideoLayer> &layers = m_vecVideoLayer[ch];
+		Complex<Real> *H = m_vecVideoH[ch];
+
+		// the random phase of a layer is drawn once, from one generator.
+		while (layers.size() < nDepth)
+		{
+			VideoLayer layer;
+			layer.depth = 0;
+			layer.size = context_.pixel_number;
+			layer.rand_phase = Complex<Real>(1, 0);
+			if (bRandomPhase)
+			{
+				layer.rand_phase[_RE] = 0.0;
+				layer.rand_phase[_IM] = 2 * M_PI * dist(engine);
+				layer.rand_phase.exp();
+			}
+			layers.push_back(layer);
+		}
+
+		// masked images of this frame, compared exactly with the kept ones.
+		size_t nLayer = layers.size();
+		next.resize(nLayer);
+		changed.assign(nLayer, false);
+		uint nCost = 0;
+		uint nLayerTotal = 0;
+		for (size_t dtr = 1; dtr < nLayer; dtr++)
+		{
+			VideoLayer &cur = next[dtr];
+			const VideoLayer &old = layers[dtr];
+			cur.pixel.clear();
+			cur.value.clear();
+			cur.depth = 0;
+			if (dtr < nDepth && render[dtr])
+			{
+				cur.depth = (is_ViewingWindow) ? dlevel_transform[dtr - 1] : dlevel[dtr - 1];
+				for (uint j = depth_offset[dtr]; j < depth_offset[dtr + 1]; j++)
+				{
+					uint idx = depth_pixel[j];
+					Real val = Real(rgb[idx]) / 255.0;
+					if (val == 0) continue;
+					cur.pixel.push_back(idx);
+					cur.value.push_back(val);
+				}
+			}
+			if (!cur.pixel.empty()) nLayerTotal++;
+
+			changed[dtr] = !(cur.pixel == old.pixel && cur.value == old.value &&
+				(cur.pixel.empty() || cur.depth == old.depth));
+			if (changed[dtr])
+				nCost += (!cur.pixel.empty() && !old.pixel.empty() && cur.depth != old.depth) ? 2 : 1;
+		}
+		nTotal += nLayerTotal;
+
+		// regenerating costs one propagation per layer. It is also cheaper once most layers
+		// change, e.g. when the depth levels move.
+		if (bRefresh || (nCost > 0 && nCost >= nLayerTotal))
+		{
+			memset(H, 0, sizeof(Complex<Real>) * N);
+			for (size_t dtr = 1; dtr < nLayer; dtr++)
+			{
+				layers[dtr].pixel.clear();
+				layers[dtr].value.clear();
+				changed[dtr] = !next[dtr].pixel.empty();
+			}
+			bRegenerated = true;
+		}
+
+		for (size_t dtr = 1; dtr < nLayer; dtr++)
+		{
+			if (!changed[dtr]) continue;
+			VideoLayer &cur = next[dtr];
+			VideoLayer &old = layers[dtr];
+			Complex<Real> rand_phase = old.rand_phase;
+
+			// add the new layer and subtract the old one. The propagation is linear, so a layer
+			// staying at the same distance and FFT size needs a single propagation of the difference.
+			memset(input, 0, sizeof(Complex<Real>) * N);
+			cur.size = context_.pixel_number;
+			if (!cur.pixel.empty())
+			{
+				Complex<Real> carrier_phase_delay(0, k * -cur.depth);
+				carrier_phase_delay.exp();
+				Complex<Real> phase = rand_phase * carrier_phase_delay;
+				for (size_t j = 0; j < cur.pixel.size(); j++)
+					input[cur.pixel[j]] = phase * cur.value[j];
+				cur.size = getBandLimitedASMSize(lambda, cur.depth, input);
+			}
+			if (!old.pixel.empty())
+			{
+				bool bSame = cur.pixel.empty() || (cur.depth == old.depth && cur.size == old.size);
+				if (!bSame)
+				{
+					propagateLayer(input, H, lambda, cur.depth, cur.size);
+					memset(input, 0, sizeof(Complex<Real>) * N);
+					nPropagation++;
+				}
+				Complex<Real> carrier_phase_delay(0, k * -old.depth);
+				carrier_phase_delay.exp();
+				Complex<Real> phase = rand_phase * carrier_phase_delay;
+				for (size_t j = 0; j < old.pixel.size(); j++)
+					input[old.pixel[j]] -= phase * old.value[j];
+				propagateLayer(input, H, lambda, old.depth, old.size);
+			}
+			else
+				propagateLayer(input, H, lambda, cur.depth, cur.size);
+			nPropagation++;
+
+			old.depth = cur.depth;
+			old.size = cur.size;
+			old.pixel.swap(cur.pixel);
+			old.value.swap(cur.value);
+			nChanged++;
+
+			m_nProgress = (int)((Real)(ch * nLayer + dtr) * 100 / (nLayer * nChannel));
+		}
+		memcpy(complex_H[ch], H, sizeof(Complex<Real>) * N);
+	}
+	delete[] input;
+	fftFree();
+	LOG("%s : %u of %u layers updated with %u propagations%s\n", __FUNCTION__, nChanged, nTotal, nPropagation,
+		bRegenerated ? ", regenerated" : "");
+	LOG("%s : %.5lf (sec)\n", __FUNCTION__, ELAPSED_TIME(begin, CUR_TIME));
+}
+
+void ophDepthMap::releaseVideo()
+{
+	for (size_t ch = 0; ch < m_vecVideoH.size(); ch++)
+		delete[] m_vecVideoH[ch];
+	m_vecVideoH.clear();
+	m_vecVideoLayer.clear();
+	m_vecVideoLambda.clear();
+	m_nVideoSize = 0;
+	m_nVideoFrame = 0;
+}
+
+bool ophDepthMap::calcHoloLayerParallel(size_t start, size_t end)
+{
+	auto begin = CUR_TIME;
+
+	const uint pnX = context_.pixel_number[_X];
+	const uint pnY = context_.pixel_number[_Y];
+	const long long int N = pnX * pnY;
+	const uint nChannel = context_.waveNum;
+	const int nLayer = (int)(end - start);
+	const bool bRandomPhase = GetRandomPhase();
+
+	// the padded FFT buffer must hold the largest layer, which covers the whole hologram at most.
+	long long int nBuffer = N;
+	for (uint ch = 0; ch < nChannel; ch++)
+	{
+		for (size_t i = start; i < end; i++)
+		{
+			int dtr = dm_config_.render_depth[i];
+			if (!depth_fill[dtr]) continue;
+			Real temp_depth = (is_ViewingWindow) ? dlevel_transform[dtr - 1] : dlevel[dtr - 1];
+			ivec2 size = getBandLimitedASMSize(context_.wave_length[ch], temp_depth);
+			nBuffer = (std::max)(nBuffer, (long long int)size[_X] * size[_Y]);
+		}
+	}
+
+	// every worker holds one padded FFT buffer and two hologram-sized buffers.
+	const unsigned long long nWorkerMemory = sizeof(fftw_complex) * nBuffer + sizeof(Complex<Real>) * N * 2;
+#ifdef _OPENMP
+	int nWorker = (std::min)(omp_get_max_threads(), nLayer);
+#else
+	int nWorker = 1;
+#endif
+	if ((unsigned long long)nWorker * nWorkerMemory > m_nLayerParallelMemory)
+		nWorker = (int)(m_nLayerParallelMemory / nWorkerMemory);
+	if (nWorker < 2)
+	{
+		LOG("%s : %llu MB per worker exceeds the memory budget, layers are propagated one by one\n",
+			__FUNCTION__, nWorkerMemory >> 20);
+		return false;
+	}
+
+	vector<fftw_complex *> work(nWorker);
+	vector<Complex<Real> *> input(nWorker);
+	vector<Complex<Real> *> acc(nWorker);
+	for (int w = 0; w < nWorker; w++)
+	{
+		work[w] = (fftw_complex *)fftw_malloc(sizeof(fftw_complex) * nBuffer);
+		input[w] = new Complex<Real>[N];
+		acc[w] = new Complex<Real>[N];
+	}
+
+	// planning is not thread-safe, so every worker shares single-threaded in-place plans made
+	// under the critical section below. The padded sizes depend on the extent of each layer.
+	std::map<std::pair<int, int>, std::pair<fftw_plan, fftw_plan>> mapPlan;
+#ifdef _OPENMP
+	fftw_plan_with_nthreads(1);
+#endif
+	const fftw_plan planFwd = fftw_plan_dft_2d(pnY, pnX, work[0], work[0], FFTW_FORWARD, FFTW_ESTIMATE);
+
+	// the random phases are drawn up front from one generator; oph::rand reseeds from the clock.
+	std::random_device rd;
+	std::mt19937_64 engine(((unsigned long long)rd() << 32) | rd());
+	std::uniform_real_distribution<Real> dist(0.0, 1.0);
+	vector<Complex<Real>> rand_phase(nLayer, Complex<Real>(1, 0));
+
+	int nDone = 0;
+	for (uint ch = 0; ch < nChannel; ch++)
+	{
+		Real lambda = context_.wave_length[ch];
+		Real k = context_.k = (2 * M_PI / lambda);
+		const uchar *rgb = m_vecRGB[ch];
+
+		if (bRandomPhase)
+		{
+			for (int l = 0; l < nLayer; l++)
+			{
+				rand_phase[l][_RE] = 0.0;
+				rand_phase[l][_IM] = 2 * M_PI * dist(engine);
+				rand_phase[l].exp();
+			}
+		}
+
+#ifdef _OPENMP
+#pragma omp parallel num_threads(nWorker) firstprivate(lambda, k)
+#endif
+		{
+#ifdef _OPENMP
+			const int tid = omp_get_thread_num();
+#else
+			const int tid = 0;
+#endif
+			fftw_complex *buf = work[tid];
+			Complex<Real> *in = input[tid];
+			Complex<Real> *spec = acc[tid];
+			memset(spec, 0, sizeof(Complex<Real>) * N);
+
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+			for (int l = 0; l < nLayer; l++)
+			{
+				int dtr = dm_config_.render_depth[start + l];
+				if (depth_fill[dtr])
+				{
+					Real temp_depth = (is_ViewingWindow) ? dlevel_transform[dtr - 1] : dlevel[dtr - 1];
+
+					Complex<Real> carrier_phase_delay(0, k * -temp_depth);
+					carrier_phase_delay.exp();
+
+					Complex<Real> phase = rand_phase[l] * carrier_phase_delay;
+					const uint *pixel = &depth_pixel[depth_offset[dtr]];
+					const long long int nPixel = depth_offset[dtr + 1] - depth_offset[dtr];
+
+					memset(in, 0, sizeof(Complex<Real>) * N);
+					for (long long int j = 0; j < nPixel; j++)
+					{
+						uint idx = pixel[j];
+						in[idx] = phase * (Real(rgb[idx]) / 255.0);
+					}
+
+					ivec2 size = getBandLimitedASMSize(lambda, temp_depth, in);
+					bool bPadded = !(size == context_.pixel_number);
+					if (bPadded)
+					{
+						std::pair<fftw_plan, fftw_plan> plan;
+#ifdef _OPENMP
+#pragma omp critical (ophDepthMapPlan)
+#endif
+						{
+							auto it = mapPlan.find(std::make_pair(size[_X], size[_Y]));
+							if (it == mapPlan.end())
+							{
+								fftw_plan fwd = fftw_plan_dft_2d(size[_Y], size[_X], buf, buf, FFTW_FORWARD, FFTW_ESTIMATE);
+								fftw_plan bwd = fftw_plan_dft_2d(size[_Y], size[_X], buf, buf, FFTW_BACKWARD, FFTW_ESTIMATE);
+								it = mapPlan.insert(std::make_pair(std::make_pair(size[_X], size[_Y]), std::make_pair(fwd, bwd))).first;
+							}
+							plan = it->second;
+						}
+						BandLimitedASM(in, in, lambda, temp_depth, size, buf, plan.first, plan.second);
+					}
+
+					// same as fft2(in, in, pnX, pnY, OPH_FORWARD, false) on this worker's buffer
+					fftShift(pnX, pnY, in, reinterpret_cast<Complex<Real> *>(buf));
+					fftw_execute_dft(planFwd, buf, buf);
+					fftShift(pnX, pnY, reinterpret_cast<Complex<Real> *>(buf), in);
+
+					if (bPadded)
+					{
+						for (long long int j = 0; j < N; j++)
+							spec[j] += in[j];
+					}
+					else
+						accumulateAngularSpectrum(in, spec, lambda, temp_depth, true);
+				}
+#ifdef _OPENMP
+#pragma omp atomic
+#endif
+				nDone++;
+				m_nProgress = (int)((Real)nDone * 100 / (nLayer * nChannel));
+			}
+		}
+
+		// reduce the private accumulators into the hologram spectrum.
+		Complex<Real> *H = complex_H[ch];
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+		for (long long int j = 0; j < N; j++)
+		{
+			for (int w = 0; w < nWorker; w++)
+				H[j] += acc[w][j];
+		}
+	}
+#ifdef _OPENMP
+	fftw_plan_with_nthreads(omp_get_max_threads());
+#endif
+
+	fftw_destroy_plan(planFwd);
+	for (auto it = mapPlan.begin(); it != mapPlan.end(); it++)
+	{
+		fftw_destroy_plan(it->second.first);
+		fftw_destroy_plan(it->second.second);
+	}
+	for (int w = 0; w < nWorker; w++)
+	{
+		fftw_free(work[w]);
+		delete[] input[w];
+		delete[] acc[w];
+	}
+	LOG("%s : %.5lf (sec)\n", __FUNCTION__, ELAPSED_TIME(begin, CUR_TIME));
+	return true;
+}
+
 void ophDepthMap::ophFree(void)
 {
+	releaseVariants();
 	ophGen::ophFree();
+	releaseVideo();
 	if (depth_img) {
 		delete[] depth_img;
 		depth_img = nullptr;
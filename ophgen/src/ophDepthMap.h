@@ -50,12 +50,19 @@
 #include <cufft.h>
 #include "include.h"
 
+class ophFrameSource;
+
 //Build Option : Multi Core Processing (OpenMP)
 #ifdef _OPENMP
 #include <omp.h>
 #endif
 using namespace oph;
 
+/// Default memory budget (bytes) of the layer-parallel buffers of all threads.
+#define DEPTH_LAYER_PARALLEL_MEMORY (4ULL << 30)
+/// Default number of frames between two regenerations of the video mode spectrum.
+#define DEPTH_VIDEO_REFRESH 30
+
 
 /**
 * @addtogroup depthmap
@@ -162,8 +169,65 @@ public:
 	*/
 	Real generateHologram(void);
 
+	/**
+	* @brief Generate holograms of the same frame that differ only in the random phase of the layers.
+	* @details The random phase is one scalar per layer, so every variant is a different combination
+	*	of the same propagated layer spectra. Each layer is propagated once and added to all variants
+	*	with its own random phase per variant, so nVariant holograms cost one set of FFTs plus one
+	*	multiply-add per variant and layer. Runs on the CPU.
+	*	Variant 0 is copied into complex_H, the others are selected with selectVariant.
+	* @param nVariant : number of holograms, for example to time-multiplex for speckle reduction
+	* @return implement time (sec)
+	* @see selectVariant, getVariantField
+	*/
+	Real generateHologramVariants(uint nVariant);
+
+	/**
+	* @brief Number of variants of the last generateHologramVariants.
+	*/
+	uint getVariantCount(void) { return m_nVariant; }
+
+	/**
+	* @brief Complex field of a variant.
+	* @param idx : variant index
+	* @param ch : channel index
+	*/
+	Complex<Real>* getVariantField(uint idx, uint ch);
+
+	/**
+	* @brief Copy a variant into complex_H, for example before encoding.
+	* @param idx : variant index
+	*/
+	bool selectVariant(uint idx);
+
 	virtual void encoding(unsigned int ENCODE_FLAG);
 	virtual void encoding(unsigned int ENCODE_FLAG, unsigned int SSB_PASSBAND);
+
+	/**
+	* @brief Generate and encode the hologram of the next frame of a shared memory frame source.
+	* @details The color and depth planes are read in place from the slot of the frame, which is
+	*  handed back to the producer as soon as the hologram is computed, before the encoding.
+	*  The frame size and channel count must match the resolution and wavelength count.
+	* @param source : attached frame source
+	* @param ENCODE_FLAG : encoding method
+	* @param timeout : msec to wait for a frame, -1 to wait forever
+	* @param bLatest : if true, skip to the newest pending frame
+	* @return total time (sec) from the commit of the frame, or a negative value if no frame was generated.
+	* @see ophFrameSource, getFrameLatency
+	*/
+	Real generateFrame(ophFrameSource* source, unsigned int ENCODE_FLAG, int timeout = -1, bool bLatest = true);
+
+	/**
+	* @brief Latency (sec) of the last generateFrame.
+	* @param ingest : from the commit of the frame by the producer until it was acquired
+	* @param compute : hologram generation
+	* @param encode : encoding
+	*/
+	void getFrameLatency(Real& ingest, Real& compute, Real& encode) {
+		ingest = m_dFrameLatency[0];
+		compute = m_dFrameLatency[1];
+		encode = m_dFrameLatency[2];
+	}
 	
 	/**
 	* @brief Set the value of a variable is_ViewingWindow(true or false)
@@ -176,6 +240,38 @@ public:
 	*/
 	void setViewingWindow(bool is_ViewingWindow);
 
+	/**
+	* @brief Set the layer-parallel mode of the CPU generation.
+	* @details In the layer-parallel mode every OpenMP thread propagates whole depth layers with
+	*	single-threaded FFT plans into a private spectrum accumulator, and the accumulators are
+	*	summed at the end. It scales better than multithreaded FFTs of one layer at a time,
+	*	at the cost of two hologram-sized buffers and one padded FFT buffer per thread.
+	*	The number of threads is capped so that these buffers fit in the memory budget.
+	*	If fewer than two fit, the layers are propagated one by one.
+	* @param bLayerParallel : true to propagate the depth layers in parallel
+	* @param nMemoryBudget : bytes the buffers of all threads may take, DEPTH_LAYER_PARALLEL_MEMORY by default
+	*/
+	void setLayerParallel(bool bLayerParallel, unsigned long long nMemoryBudget = DEPTH_LAYER_PARALLEL_MEMORY) {
+		m_bLayerParallel = bLayerParallel;
+		m_nLayerParallelMemory = nMemoryBudget;
+	}
+	bool isLayerParallel(void) { return m_bLayerParallel; }
+
+	/**
+	* @brief Set the video mode of the CPU generation.
+	* @details In the video mode the masked image of every depth layer is kept with
+	*	the spectrum of the previous frame. Only the layers whose pixels, values or distance changed
+	*	are propagated, as the difference between the new and the old layer, and added to the kept spectrum.
+	*	The random phase of a layer is drawn once and reused, so it does not change the layer
+	*	from frame to frame. The spectrum is regenerated from scratch every nRefresh frames, and
+	*	whenever updating the changed layers would take as many propagations as regenerating it.
+	*	Turning the mode on or off drops the kept frame.
+	* @param bVideoMode : true to reuse the unchanged layers of the previous frame
+	* @param nRefresh : frames between two regenerations, 0 to regenerate only when it is cheaper
+	*/
+	void setVideoMode(bool bVideoMode, uint nRefresh = DEPTH_VIDEO_REFRESH);
+	bool isVideoMode(void) { return m_bVideoMode; }
+
 	ivec2 getRGBImgSize() { return m_vecRGBImg; };
 	ivec2 getDepthImgSize() { return m_vecDepthImg; };
 
@@ -210,6 +306,16 @@ public:
 		for(int i = 1; i <= (int)numofdepth; i++)
 			dm_config_.render_depth.push_back(i);
 	}
+	/**
+	* @brief Set the histogram-adaptive depth quantization.
+	* @param bAdaptive : true to place the depth levels with Lloyd-Max on the depth histogram
+	* @param maxError : RMS depth error bound in meters. If > 0, the fewest levels meeting it are used.
+	* @see adaptDepthQuanCPU
+	*/
+	inline void setAdaptiveDepthQuantization(bool bAdaptive, Real maxError = 0.0) {
+		dm_config_.adaptive_depth_quantization = bAdaptive;
+		dm_config_.adaptive_depth_error = maxError;
+	}
 	inline void setRGBImageBuffer(int idx, unsigned char* buffer, unsigned long long size)
 	{
 		if (idx < 0 || idx > 2) return;
@@ -250,6 +356,17 @@ public:
 	inline unsigned char* getDepthImageBuffer() { return depth_img; }
 
 	inline const OphDepthMapConfig& getConfig() { return dm_config_; }
+
+	/**
+	* @brief Tile-distributed generation splits the render depths.
+	* @see ophDistributed
+	*/
+	virtual uint getTileUnits(void) { return (uint)dm_config_.render_depth.size(); }
+	virtual bool prepareTiles(uint flag);
+	/**
+	* @brief Accumulate the angular spectrum of the render depths [begin, end) on the CPU.
+	*/
+	virtual bool generateTiles(uint begin, uint end);
 	
 private:
 	/**
@@ -268,7 +385,7 @@ private:
 
 	/**
 	* @brief Preprocess input image & depth map data for the CPU implementation.
-	* @details Prepare variables, m_vecImgSrc, dmap_src_, m_vecAlphaMap, depth_index_.
+	* @details Prepare the variable depth_index_. The layers read the 8-bit images m_vecRGB & depth_img directly.
 	* @return true if input data are sucessfully prepared, flase otherwise.
 	*/
 	bool prepareInputdataCPU();
@@ -294,6 +411,22 @@ private:
 	*/
 	void changeDepthQuanCPU();
 
+	/**
+	* @brief Bucket the pixel indices by 'depth_index_' with a counting sort.
+	* @details Fills 'depth_offset' and 'depth_pixel', so the pixels of depth d are
+	*  depth_pixel[depth_offset[d]] ... depth_pixel[depth_offset[d + 1] - 1], and marks the
+	*  non-empty depths in 'depth_fill'.
+	*/
+	void sortDepthIndexCPU();
+
+	/**
+	* @brief Re-quantize the depth map with levels placed from its histogram on the CPU.
+	* @details Runs Lloyd-Max on the histogram of the 8-bit depth map over the visible pixels,
+	*  with num_of_depth levels, or with the fewest levels that keep the RMS depth error within
+	*  'adaptive_depth_error'. Replaces 'dlevel' & 'depth_index_', so only occupied levels remain.
+	*/
+	void adaptDepthQuanCPU();
+
 	/**
 	* @brief Quantize depth map on the GPU, when the number of depth quantization is not the default value (i.e. change_depth_quantization == 1 ).
 	* @details Calculate the value of 'depth_index_gpu'.
@@ -319,6 +452,50 @@ private:
 	* @see fftInit2D, GetRandomPhase, GetRandomPhaseValue, fft2, AngularSpectrumMethod, fftFree
 	*/
 	void calcHoloCPU();
+
+	/**
+	* @brief Accumulate the render depths [start, end) of 'render_depth' on the CPU.
+	* @see calcHoloCPU
+	*/
+	void calcHoloCPU(size_t start, size_t end);
+
+	/**
+	* @brief Layer-parallel calcHoloCPU over the render depths [start, end).
+	* @return Type: <B>bool</B>\n
+	*				<B>false</B> if fewer than two workers fit in the memory budget, nothing is generated then.
+	* @see setLayerParallel, accumulateAngularSpectrum
+	*/
+	bool calcHoloLayerParallel(size_t start, size_t end);
+
+	/**
+	* @brief calcHoloCPU of nVariant random phase variants, which propagates every layer once.
+	* @see generateHologramVariants
+	*/
+	void calcHoloVariantsCPU(uint nVariant);
+
+	/**
+	* @brief Release the fields of the random phase variants.
+	*/
+	void releaseVariants();
+
+	/**
+	* @brief Video mode calcHoloCPU, which propagates the changed layers only.
+	* @see setVideoMode
+	*/
+	void calcHoloVideoCPU();
+
+	/**
+	* @brief Propagate one depth layer to the hologram plane and accumulate its spectrum in dst.
+	* @details The input buffer is overwritten. fftInit2D must have been called.
+	*	A size equal to the hologram takes the unpadded band-limited spectral path.
+	* @param size Padded FFT size of the layer from getBandLimitedASMSize.
+	*/
+	void propagateLayer(Complex<Real>* input, Complex<Real>* dst, Real lambda, Real depth, const ivec2& size);
+
+	/**
+	* @brief Release the layers and the spectrum kept by the video mode.
+	*/
+	void releaseVideo();
 	
 	/**
 	* @brief Main method for generating a hologram on the GPU.
@@ -347,6 +524,9 @@ protected:
 
 private:
 	bool					is_ViewingWindow;
+	bool					m_bLayerParallel;					///< propagate the depth layers in parallel on the CPU.
+	unsigned long long		m_nLayerParallelMemory;				///< memory budget (bytes) of the layer-parallel buffers.
+	bool					m_bVideoMode;						///< reuse the unchanged layers of the previous frame.
 	unsigned char*			depth_img;
 	vector<uchar*>			m_vecRGB;
 	ivec2					m_vecRGBImg;
@@ -355,12 +535,10 @@ private:
 	unsigned char*			dimg_src_gpu;						///< GPU variable - depth map data, values are from 0 to 255.
 	Real*					depth_index_gpu;					///< GPU variable - quantized depth map data.
 	
-	vector<Real *>			m_vecImgSrc;
-	vector<int *>			m_vecAlphaMap;
-	Real*					dmap_src;							///< CPU variable - depth map data, values are from 0 to 1.
 	uint*					depth_index;						///< CPU variable - quantized depth map data.
 	vector<short>			depth_fill;
-	Real*					dmap;								///< CPU variable - physical distances of depth map.
+	vector<uint>			depth_offset;						///< CPU variable - first entry of each depth in depth_pixel.
+	vector<uint>			depth_pixel;						///< CPU variable - pixel indices sorted by depth_index.
 
 	Real					dstep;								///< the physical increment of each depth map layer.
 	vector<Real>			dlevel;								///< the physical value of all depth map layer.
@@ -368,6 +546,26 @@ private:
 
 	OphDepthMapConfig		dm_config_;							///< structure variable for depthmap hologram configuration.
 
+	/**
+	* @brief A depth layer of the previous frame, kept by the video mode.
+	*/
+	struct VideoLayer {
+		Real				depth;								///< physical distance the layer was propagated to.
+		ivec2				size;								///< padded FFT size the layer was propagated with.
+		Complex<Real>		rand_phase;							///< random phase of the layer, drawn once.
+		vector<uint>		pixel;								///< pixel indices of the layer.
+		vector<Real>		value;								///< masked image values of the layer.
+	};
+	vector<vector<VideoLayer>>	m_vecVideoLayer;				///< [channel][depth index] layers of the previous frame.
+	vector<Complex<Real> *>	m_vecVideoH;						///< spectrum of the previous frame per channel.
+	vector<Real>			m_vecVideoLambda;					///< wavelengths the kept spectrum was made with.
+	long long int			m_nVideoSize;						///< pixel count of the kept spectrum.
+	uint					m_nVideoRefresh;					///< frames between two regenerations of the kept spectrum.
+	uint					m_nVideoFrame;						///< frames since the kept spectrum was dropped.
+
+	uint					m_nVariant;							///< number of random phase variants.
+	vector<Complex<Real> *>	m_vecVariantH;						///< [variant * channel] fields of the variants.
+
 	cufftDoubleComplex* u_o_gpu_;
 	cufftDoubleComplex* u_complex_gpu_;
 	cufftDoubleComplex* k_temp_d_;
@@ -375,6 +573,7 @@ private:
 	cudaStream_t	stream_;
 
 	uint m_nProgress;
+	Real m_dFrameLatency[3];										///< ingest, compute & encode time of the last frame.
 };
 
 #endif //>__ophDepthMap_h
\ No newline at end of file
@@ -0,0 +1,648 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  By downloading, copying, installing or using the software you agree to this license.
+//  If you do not agree to this license, do not download, install, copy or use the software.
+//
+//
+//                           License Agreement
+//                For Open Source Digital Holographic Library
+//
+// Openholo library is free software;
+// you can redistribute it and/or modify it under the terms of the BSD 2-Clause license.
+//
+// Copyright (C) 2017-2024, Korea Electronics Technology Institute. All rights reserved.
+// E-mail : contact.openholo@gmail.com
+// Web : http://www.openholo.org
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+//  1. Redistribution's of source code must retain the above copyright notice,
+//     this list of conditions and the following disclaimer.
+//
+//  2. Redistribution's in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+// This software is provided by the copyright holders and contributors "as is" and
+// any express or implied warranties, including, but not limited to, the implied
+// warranties of merchantability and fitness for a particular purpose are disclaimed.
+// In no event shall the copyright holder or contributors be liable for any direct,
+// indirect, incidental, special, exemplary, or consequential damages
+// (including, but not limited to, procurement of substitute goods or services;
+// loss of use, data, or profits; or business interruption) however caused
+// and on any theory of liability, whether in contract, strict liability,
+// or tort (including negligence or otherwise) arising in any way out of
+// the use of this software, even if advised of the possibility of such damage.
+//
+// This software contains opensource software released under GNU Generic Public License,
+// NVDIA Software License Agreement, or CUDA supplement to Software License Agreement.
+// Check whether software you use contains licensed software.
+//
+//M*/
+
+#include "ophDistributed.h"
+#include "sys.h"
+
+#ifndef _WIN64
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <netdb.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <random>
+
+extern char **environ;
+#endif
+
+#define DIST_MAGIC			0x4F504844	// "OPHD"
+#define DIST_SHM_HEADER		64			// token of the shared memory object, keeps the field aligned
+#define DIST_TIMEOUT		60000		// msec to wait for workers and messages
+
+enum DIST_MSG {
+	DIST_HELLO = 1,		// worker -> coordinator : a = units, b = field size
+	DIST_SETUP,			// coordinator -> worker : flag = generator flag, a = slot, b = token, bytes = shm name
+	DIST_READY,			// worker -> coordinator : flag = prepared, a = shm attached
+	DIST_TILE,			// coordinator -> worker : units [a, b)
+	DIST_RESULT,		// worker -> coordinator : units [a, b), bytes = rows sent over the socket
+	DIST_FINISH,		// coordinator -> worker : no more tiles
+	DIST_DONE			// worker -> coordinator : bytes = summed field sent over the socket
+};
+
+struct DistMessage {
+	uint32_t magic;
+	uint32_t type;
+	uint32_t flag;
+	uint32_t reserved;
+	int64_t a;
+	int64_t b;
+	uint64_t bytes;
+};
+
+#ifndef _WIN64
+static bool sendAll(int fd, const void* buf, size_t size);
+static bool recvAll(int fd, void* buf, size_t size);
+static bool sendMessage(int fd, uint32_t type, uint32_t flag, int64_t a, int64_t b, uint64_t bytes = 0);
+static bool recvMessage(int fd, DistMessage& msg, int timeout = -1);
+#endif
+
+ophDistributed::ophDistributed(ophGen* gen)
+	: m_pGen(gen)
+	, m_nListen(-1)
+	, m_nPort(0)
+{
+}
+
+ophDistributed::~ophDistributed(void)
+{
+#ifndef _WIN64
+	if (m_nListen >= 0)
+		close(m_nListen);
+#endif
+	release();
+}
+
+bool ophDistributed::listen(int port)
+{
+#ifdef _WIN64
+	LOG("<FAILED> Tile-distributed generation is not supported on Windows.\n");
+	return false;
+#else
+	if (m_nListen >= 0)
+		close(m_nListen);
+
+	m_nListen = socket(AF_INET, SOCK_STREAM, 0);
+	if (m_nListen < 0) {
+		LOG("<FAILED> socket: %s\n", strerror(errno));
+		return false;
+	}
+	int on = 1;
+	setsockopt(m_nListen, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+	sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	addr.sin_port = htons((uint16_t)port);
+
+	socklen_t len = sizeof(addr);
+	if (bind(m_nListen, (sockaddr *)&addr, sizeof(addr)) < 0 ||
+		::listen(m_nListen, SOMAXCONN) < 0 ||
+		getsockname(m_nListen, (sockaddr *)&addr, &len) < 0)
+	{
+		LOG("<FAILED> Listen on port %d: %s\n", port, strerror(errno));
+		close(m_nListen);
+		m_nListen = -1;
+		return false;
+	}
+	m_nPort = ntohs(addr.sin_port);
+	LOG("Coordinator listens on port %d\n", m_nPort);
+	return true;
+#endif
+}
+
+bool ophDistributed::spawnWorkers(int nWorker, const char* path, const std::vector<std::string>& args)
+{
+#ifdef _WIN64
+	LOG("<FAILED> Tile-distributed generation is not supported on Windows.\n");
+	return false;
+#else
+	if (m_nListen < 0 && !listen())
+		return false;
+
+	char szPort[16] = { 0, };
+	sprintf(szPort, "%d", m_nPort);
+
+	// argv and envp are built before fork, the child only calls execve.
+	std::vector<std::string> vecArg;
+	vecArg.push_back(path);
+	vecArg.insert(vecArg.end(), args.begin(), args.end());
+	vecArg.push_back("127.0.0.1");
+	vecArg.push_back(szPort);
+	std::vector<char*> argv;
+	for (size_t i = 0; i < vecArg.size(); i++)
+		argv.push_back(const_cast<char*>(vecArg[i].c_str()));
+	argv.push_back(nullptr);
+
+	std::vector<std::string> vecEnv;
+	for (char** env = environ; *env; env++)
+		vecEnv.push_back(*env);
+	if (getenv("OMP_NUM_THREADS") == nullptr)
+	{
+		long nCore = sysconf(_SC_NPROCESSORS_ONLN);
+		long nThread = nCore / nWorker;
+		vecEnv.push_back("OMP_NUM_THREADS=" + std::to_string(nThread > 0 ? nThread : 1));
+	}
+	std::vector<char*> envp;
+	for (size_t i = 0; i < vecEnv.size(); i++)
+		envp.push_back(const_cast<char*>(vecEnv[i].c_str()));
+	envp.push_back(nullptr);
+
+	for (int i = 0; i < nWorker; i++)
+	{
+		pid_t pid = fork();
+		if (pid < 0) {
+			LOG("<FAILED> fork: %s\n", strerror(errno));
+			return false;
+		}
+		if (pid == 0) {
+			close(m_nListen);
+			execve(path, argv.data(), envp.data());
+			_exit(127);
+		}
+		m_vecPID.push_back(pid);
+	}
+	LOG("Spawned %d workers: %s\n", nWorker, path);
+	return true;
+#endif
+}
+
+Real ophDistributed::generateHologram(uint flag, int nWorker, int nTile)
+{
+#ifdef _WIN64
+	LOG("<FAILED> Tile-distributed generation is not supported on Windows.\n");
+	return -1.0;
+#else
+	auto begin = CUR_TIME;
+	const uint units = m_pGen->getTileUnits();
+	const bool bRows = m_pGen->isTileRows();
+	const OphConfig& context = m_pGen->getContext();
+	const long long int N = (long long int)context.pixel_number[_X] * context.pixel_number[_Y];
+	const uint nChannel = context.waveNum;
+	const long long int nField = N * nChannel;
+	const long long int nRow = bRows ? N / units : 0;
+
+	if (units == 0 || (bRows && N % units != 0)) {
+		LOG("<FAILED> The generator does not support tile-distributed generation.\n");
+		return -1.0;
+	}
+	if (m_nListen < 0 && !listen())
+		return -1.0;
+	if (!m_pGen->prepareTiles(flag))
+		return -1.0;
+
+	if (nWorker < 1) nWorker = 1;
+	if (nTile <= 0) nTile = bRows ? nWorker * 8 : nWorker;
+	if (nTile > (int)units) nTile = (int)units;
+
+	LOG("**************************************************\n");
+	LOG("          Generate Hologram (Distributed)         \n");
+	LOG("1) Number of Workers : %d\n", nWorker);
+	LOG("2) Number of Tiles : %d of %u %s\n", nTile, units, bRows ? "rows" : "slabs");
+	LOG("**************************************************\n");
+
+	// complex field in shared memory: the hologram for rows, one slot per worker for slabs.
+	static int nShm = 0;
+	char szShm[64] = { 0, };
+	sprintf(szShm, "/ophdist.%d.%d", (int)getpid(), nShm++);
+	const long long int nSlot = bRows ? 1 : nWorker;
+	const size_t shmSize = DIST_SHM_HEADER + sizeof(Complex<Real>) * nField * nSlot;
+
+	int shmFd = shm_open(szShm, O_CREAT | O_EXCL | O_RDWR, 0600);
+	void* pShm = MAP_FAILED;
+	if (shmFd >= 0 && ftruncate(shmFd, shmSize) == 0)
+		pShm = mmap(nullptr, shmSize, PROT_READ | PROT_WRITE, MAP_SHARED, shmFd, 0);
+	if (pShm == MAP_FAILED) {
+		LOG("<FAILED> Shared memory %s: %s\n", szShm, strerror(errno));
+		if (shmFd >= 0) {
+			close(shmFd);
+			shm_unlink(szShm);
+		}
+		return -1.0;
+	}
+	std::random_device rd;
+	const uint64_t token = ((uint64_t)rd() << 32) | rd();
+	memcpy(pShm, &token, sizeof(token));
+	Complex<Real>* shared = reinterpret_cast<Complex<Real>*>((char *)pShm + DIST_SHM_HEADER);
+
+	Complex<Real>** complex_H = m_pGen->getComplexField();
+	for (uint ch = 0; ch < nChannel; ch++)
+		memset(complex_H[ch], 0, sizeof(Complex<Real>) * N);
+
+	struct Worker {
+		int fd;
+		bool attached;
+		bool done;
+	};
+	std::vector<Worker> workers;
+	bool bRet = true;
+	int nextTile = 0;
+	int nDoneTile = 0;
+
+	// accept workers
+	while ((int)workers.size() < nWorker)
+	{
+		pollfd pfd = { m_nListen, POLLIN, 0 };
+		if (poll(&pfd, 1, DIST_TIMEOUT) <= 0) {
+			LOG("<FAILED> %d of %d workers connected.\n", (int)workers.size(), nWorker);
+			bRet = false;
+			break;
+		}
+		int fd = accept(m_nListen, nullptr, nullptr);
+		if (fd < 0)
+			continue;
+		int on = 1;
+		setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+		DistMessage msg;
+		if (!recvMessage(fd, msg, DIST_TIMEOUT) || msg.type != DIST_HELLO ||
+			msg.a != (int64_t)units || msg.b != nField) {
+			LOG("<FAILED> Worker with a different scene or config is rejected.\n");
+			close(fd);
+			continue;
+		}
+		uint64_t len = strlen(szShm);
+		if (!sendMessage(fd, DIST_SETUP, flag, (int64_t)workers.size(), (int64_t)token, len) ||
+			!sendAll(fd, szShm, len)) {
+			close(fd);
+			continue;
+		}
+		Worker worker = { fd, false, false };
+		workers.push_back(worker);
+	}
+
+	// hand out tiles until every worker is done
+	int nActive = bRet ? (int)workers.size() : 0;
+	std::vector<pollfd> pfds(workers.size());
+	Complex<Real>* payload = nullptr;
+
+	while (bRet && nActive > 0)
+	{
+		for (size_t i = 0; i < workers.size(); i++) {
+			pfds[i].fd = workers[i].done ? -1 : workers[i].fd;
+			pfds[i].events = POLLIN;
+			pfds[i].revents = 0;
+		}
+		if (poll(pfds.data(), pfds.size(), -1) < 0) {
+			if (errno == EINTR) continue;
+			bRet = false;
+			break;
+		}
+
+		for (size_t i = 0; bRet && i < workers.size(); i++)
+		{
+			if (workers[i].done || !(pfds[i].revents & (POLLIN | POLLHUP | POLLERR)))
+				continue;
+
+			Worker& worker = workers[i];
+			DistMessage msg;
+			if (!recvMessage(worker.fd, msg)) {
+				LOG("<FAILED> Worker %d disconnected.\n", (int)i);
+				bRet = false;
+				break;
+			}
+
+			if (msg.type == DIST_READY) {
+				if (!msg.flag) {
+					LOG("<FAILED> Worker %d could not prepare the scene.\n", (int)i);
+					bRet = false;
+					break;
+				}
+				worker.attached = msg.a != 0;
+			}
+			else if (msg.type == DIST_RESULT) {
+				// rows of a remote worker: [ch][row] in the order of the channels
+				if (msg.bytes > 0) {
+					long long int nTileRow = (msg.b - msg.a) * nRow;
+					if (!bRows || msg.bytes != sizeof(Complex<Real>) * nTileRow * nChannel) {
+						bRet = false;
+						break;
+					}
+					for (uint ch = 0; bRet && ch < nChannel; ch++)
+						bRet = recvAll(worker.fd, shared + ch * N + msg.a * nRow, sizeof(Complex<Real>) * nTileRow);
+					if (!bRet) break;
+				}
+				nDoneTile++;
+			}
+			else if (msg.type == DIST_DONE) {
+				if (msg.bytes > 0) {
+					if (bRows || msg.bytes != sizeof(Complex<Real>) * nField) {
+						bRet = false;
+						break;
+					}
+					if (!payload) payload = new Complex<Real>[nField];
+					if (!recvAll(worker.fd, payload, sizeof(Complex<Real>) * nField)) {
+						bRet = false;
+						break;
+					}
+					for (uint ch = 0; ch < nChannel; ch++) {
+						Complex<Real>* src = payload + ch * N;
+						Complex<Real>* dst = complex_H[ch];
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+						for (long long int k = 0; k < N; k++)
+							dst[k] += src[k];
+					}
+				}
+				worker.done = true;
+				nActive--;
+				continue;
+			}
+			else {
+				bRet = false;
+				break;
+			}
+
+			// next tile, or finish
+			if (nextTile < nTile) {
+				int64_t b0 = (int64_t)units * nextTile / nTile;
+				int64_t b1 = (int64_t)units * (nextTile + 1) / nTile;
+				nextTile++;
+				bRet = sendMessage(worker.fd, DIST_TILE, 0, b0, b1);
+			}
+			else
+				bRet = sendMessage(worker.fd, DIST_FINISH, 0, 0, 0);
+		}
+	}
+	if (payload) delete[] payload;
+
+	for (size_t i = 0; i < workers.size(); i++)
+		close(workers[i].fd);
+
+	// assemble complex_H
+	if (bRet)
+	{
+		if (bRows) {
+			for (uint ch = 0; ch < nChannel; ch++)
+				memcpy(complex_H[ch], shared + ch * N, sizeof(Complex<Real>) * N);
+		}
+		else {
+			for (size_t i = 0; i < workers.size(); i++) {
+				if (!workers[i].attached) continue;
+				Complex<Real>* slot = shared + i * nField;
+				for (uint ch = 0; ch < nChannel; ch++) {
+					Complex<Real>* src = slot + ch * N;
+					Complex<Real>* dst = complex_H[ch];
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+					for (long long int k = 0; k < N; k++)
+						dst[k] += src[k];
+				}
+			}
+		}
+	}
+
+	munmap(pShm, shmSize);
+	close(shmFd);
+	shm_unlink(szShm);
+	release();
+
+	if (!bRet) {
+		LOG("<FAILED> Distributed generation: %d of %d tiles done.\n", nDoneTile, nTile);
+		return -1.0;
+	}
+
+	Real elapsed_time = ELAPSED_TIME(begin, CUR_TIME);
+	LOG("Total Elapsed Time: %lf (s)\n", elapsed_time);
+	return elapsed_time;
+#endif
+}
+
+bool ophDistributed::runWorker(ophGen* gen, const char* host, int port)
+{
+#ifdef _WIN64
+	LOG("<FAILED> Tile-distributed generation is not supported on Windows.\n");
+	return false;
+#else
+	auto begin = CUR_TIME;
+	const uint units = gen->getTileUnits();
+	const bool bRows = gen->isTileRows();
+	const OphConfig& context = gen->getContext();
+	const long long int N = (long long int)context.pixel_number[_X] * context.pixel_number[_Y];
+	const uint nChannel = context.waveNum;
+	const long long int nField = N * nChannel;
+	const long long int nRow = units ? N / units : 0;
+
+	char szPort[16] = { 0, };
+	sprintf(szPort, "%d", port);
+	addrinfo hints, *res = nullptr;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	if (getaddrinfo(host, szPort, &hints, &res) != 0) {
+		LOG("<FAILED> Unknown coordinator: %s\n", host);
+		return false;
+	}
+	int fd = -1;
+	for (addrinfo* ai = res; ai; ai = ai->ai_next) {
+		fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+		if (fd < 0) continue;
+		if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) break;
+		close(fd);
+		fd = -1;
+	}
+	freeaddrinfo(res);
+	if (fd < 0) {
+		LOG("<FAILED> Connect to %s:%d\n", host, port);
+		return false;
+	}
+	int on = 1;
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+	bool bRet = false;
+	DistMessage msg;
+	char szShm[64] = { 0, };
+	void* pShm = MAP_FAILED;
+	size_t shmSize = 0;
+	Complex<Real>* shared = nullptr;
+	Complex<Real>** complex_H = gen->getComplexField();
+	int nTile = 0;
+
+	if (!sendMessage(fd, DIST_HELLO, 0, units, nField) ||
+		!recvMessage(fd, msg, DIST_TIMEOUT) || msg.type != DIST_SETUP || msg.bytes >= sizeof(szShm) ||
+		!recvAll(fd, szShm, msg.bytes))
+	{
+		LOG("<FAILED> Rejected by the coordinator.\n");
+		close(fd);
+		return false;
+	}
+	const long long int slot = msg.a;
+	const uint64_t token = (uint64_t)msg.b;
+	bool bPrepared = gen->prepareTiles(msg.flag);
+
+	// the shared memory exists only on the host of the coordinator.
+	int shmFd = shm_open(szShm, O_RDWR, 0600);
+	if (shmFd >= 0) {
+		struct stat st;
+		if (fstat(shmFd, &st) == 0 && st.st_size > DIST_SHM_HEADER) {
+			shmSize = st.st_size;
+			pShm = mmap(nullptr, shmSize, PROT_READ | PROT_WRITE, MAP_SHARED, shmFd, 0);
+		}
+		close(shmFd);
+	}
+	if (pShm != MAP_FAILED) {
+		uint64_t check = 0;
+		memcpy(&check, pShm, sizeof(check));
+		size_t need = DIST_SHM_HEADER + sizeof(Complex<Real>) * nField * (bRows ? 1 : slot + 1);
+		if (check == token && shmSize >= need)
+			shared = reinterpret_cast<Complex<Real>*>((char *)pShm + DIST_SHM_HEADER);
+		if (!bRows && shared)
+			shared += slot * nField;
+	}
+
+	if (sendMessage(fd, DIST_READY, bPrepared ? 1 : 0, shared ? 1 : 0, 0) && bPrepared)
+	{
+		LOG("Worker %lld connected to %s:%d (%s)\n", slot, host, port, shared ? "shared memory" : "socket");
+		while (recvMessage(fd, msg))
+		{
+			if (msg.type == DIST_TILE)
+			{
+				if (!gen->generateTiles((uint)msg.a, (uint)msg.b))
+					break;
+				nTile++;
+
+				bool bSent = true;
+				if (bRows) {
+					long long int nTileRow = (msg.b - msg.a) * nRow;
+					if (shared) {
+						for (uint ch = 0; ch < nChannel; ch++)
+							memcpy(shared + ch * N + msg.a * nRow, complex_H[ch] + msg.a * nRow, sizeof(Complex<Real>) * nTileRow);
+						bSent = sendMessage(fd, DIST_RESULT, 0, msg.a, msg.b);
+					}
+					else {
+						bSent = sendMessage(fd, DIST_RESULT, 0, msg.a, msg.b, sizeof(Complex<Real>) * nTileRow * nChannel);
+						for (uint ch = 0; bSent && ch < nChannel; ch++)
+							bSent = sendAll(fd, complex_H[ch] + msg.a * nRow, sizeof(Complex<Real>) * nTileRow);
+					}
+				}
+				else
+					bSent = sendMessage(fd, DIST_RESULT, 0, msg.a, msg.b);
+				if (!bSent)
+					break;
+			}
+			else if (msg.type == DIST_FINISH)
+			{
+				if (bRows)
+					bRet = sendMessage(fd, DIST_DONE, 0, 0, 0);
+				else if (shared) {
+					for (uint ch = 0; ch < nChannel; ch++)
+						memcpy(shared + ch * N, complex_H[ch], sizeof(Complex<Real>) * N);
+					bRet = sendMessage(fd, DIST_DONE, 0, 0, 0);
+				}
+				else {
+					bRet = sendMessage(fd, DIST_DONE, 0, 0, 0, sizeof(Complex<Real>) * nField);
+					for (uint ch = 0; bRet && ch < nChannel; ch++)
+						bRet = sendAll(fd, complex_H[ch], sizeof(Complex<Real>) * N);
+				}
+				break;
+			}
+			else
+				break;
+		}
+	}
+
+	if (pShm != MAP_FAILED)
+		munmap(pShm, shmSize);
+	close(fd);
+
+	LOG("Worker %lld: %d tiles, %s : %lf (s)\n", slot, nTile, bRet ? "done" : "<FAILED>", ELAPSED_TIME(begin, CUR_TIME));
+	return bRet;
+#endif
+}
+
+void ophDistributed::release(void)
+{
+#ifndef _WIN64
+	for (size_t i = 0; i < m_vecPID.size(); i++) {
+		int status = 0;
+		waitpid(m_vecPID[i], &status, 0);
+		if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+			LOG("<FAILED> Worker process %d exited with %d\n", m_vecPID[i], status);
+	}
+#endif
+	m_vecPID.clear();
+}
+
+#ifndef _WIN64
+static bool sendAll(int fd, const void* buf, size_t size)
+{
+	const char* p = (const char*)buf;
+	while (size > 0) {
+		ssize_t n = send(fd, p, size, MSG_NOSIGNAL);
+		if (n < 0 && errno == EINTR) continue;
+		if (n <= 0) return false;
+		p += n;
+		size -= n;
+	}
+	return true;
+}
+
+static bool recvAll(int fd, void* buf, size_t size)
+{
+	char* p = (char*)buf;
+	while (size > 0) {
+		ssize_t n = recv(fd, p, size, 0);
+		if (n < 0 && errno == EINTR) continue;
+		if (n <= 0) return false;
+		p += n;
+		size -= n;
+	}
+	return true;
+}
+
+static bool sendMessage(int fd, uint32_t type, uint32_t flag, int64_t a, int64_t b, uint64_t bytes)
+{
+	DistMessage msg = { DIST_MAGIC, type, flag, 0, a, b, bytes };
+	return sendAll(fd, &msg, sizeof(msg));
+}
+
+static bool recvMessage(int fd, DistMessage& msg, int timeout)
+{
+	if (timeout >= 0) {
+		pollfd pfd = { fd, POLLIN, 0 };
+		if (poll(&pfd, 1, timeout) <= 0)
+			return false;
+	}
+	return recvAll(fd, &msg, sizeof(msg)) && msg.magic == DIST_MAGIC;
+}
+#endif
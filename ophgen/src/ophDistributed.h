@@ -0,0 +1,163 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  By downloading, copying, installing or using the software you agree to this license.
+//  If you do not agree to this license, do not download, install, copy or use the software.
+//
+//
+//                           License Agreement
+//                For Open Source Digital Holographic Library
+//
+// Openholo library is free software;
+// you can redistribute it and/or modify it under the terms of the BSD 2-Clause license.
+//
+// Copyright (C) 2017-2024, Korea Electronics Technology Institute. All rights reserved.
+// E-mail : contact.openholo@gmail.com
+// Web : http://www.openholo.org
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+//  1. Redistribution's of source code must retain the above copyright notice,
+//     this list of conditions and the following disclaimer.
+//
+//  2. Redistribution's in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+// This software is provided by the copyright holders and contributors "as is" and
+// any express or implied warranties, including, but not limited to, the implied
+// warranties of merchantability and fitness for a particular purpose are disclaimed.
+// In no event shall the copyright holder or contributors be liable for any direct,
+// indirect, incidental, special, exemplary, or consequential damages
+// (including, but not limited to, procurement of substitute goods or services;
+// loss of use, data, or profits; or business interruption) however caused
+// and on any theory of liability, whether in contract, strict liability,
+// or tort (including negligence or otherwise) arising in any way out of
+// the use of this software, even if advised of the possibility of such damage.
+//
+// This software contains opensource software released under GNU Generic Public License,
+// NVDIA Software License Agreement, or CUDA supplement to Software License Agreement.
+// Check whether software you use contains licensed software.
+//
+//M*/
+
+#ifndef __ophDistributed_h
+#define __ophDistributed_h
+
+#include "ophGen.h"
+
+using namespace oph;
+
+/**
+* @ingroup gen
+* @brief Tile-distributed hologram generation over several processes.
+* @details The coordinator splits the work units of a generator into tiles and hands them out
+*  to worker processes, one tile at a time, over TCP. Work units are
+*  - hologram rows for ophPointCloud. Each tile owns its rows, so nothing is summed.
+*  - points for ophWRP and render depths for ophDepthMap. Every tile contributes to the whole
+*    hologram through an FFT, so the contributions of all workers are summed.
+*  .
+*  The coordinator assembles complex_H in a POSIX shared memory object. Workers on the same host
+*  map it and write their results in place; workers on other hosts send them over the socket.
+*  Every worker loads the same scene and config as the coordinator and only reads it.
+*  Workers run as separate processes (not forked copies of the coordinator), so every worker has
+*  its own OpenMP and FFTW thread pools.
+*
+*  Coordinator, with 4 local workers running the same program:
+*  @code
+*	ophPointCloud* gen = new ophPointCloud();
+*	gen->readConfig(cfg); gen->loadPointCloud(ply);
+*	ophDistributed dist(gen);
+*	dist.listen();
+*	dist.spawnWorkers(4, argv[0], { "--worker" });
+*	dist.generateHologram(PC_DIFF_RS, 4);
+*	gen->encoding(ophGen::ENCODE_PHASE);
+*  @endcode
+*  Worker, started as "program --worker <host> <port>":
+*  @code
+*	ophPointCloud* gen = new ophPointCloud();
+*	gen->readConfig(cfg); gen->loadPointCloud(ply);
+*	return ophDistributed::runWorker(gen, argv[2], atoi(argv[3])) ? 0 : 1;
+*  @endcode
+*  Workers on other hosts are started the same way with the host name of the coordinator.
+*  All processes must run on the same architecture. Only Linux is supported.
+* @see ophGen::getTileUnits, ophGen::prepareTiles, ophGen::generateTiles
+*/
+class GEN_DLL ophDistributed
+{
+public:
+	/**
+	* @brief Constructor
+	* @param[in] gen Generator with the scene and config already loaded.
+	*/
+	explicit ophDistributed(ophGen* gen);
+	~ophDistributed(void);
+
+	/**
+	* @brief Open the coordinator socket.
+	* @param[in] port TCP port, 0 for any free port.
+	* @return Type: <B>bool</B>\n
+	*				If the function succeeds, the return value is <B>true</B>.
+	* @see getPort
+	*/
+	bool listen(int port = 0);
+
+	/**
+	* @brief Get the TCP port of the coordinator socket.
+	*/
+	int getPort(void) { return m_nPort; }
+
+	/**
+	* @brief Start worker processes on this host.
+	* @details Every worker runs path with args followed by "127.0.0.1" and the port of the coordinator.
+	*  Unless OMP_NUM_THREADS is set, every worker gets an equal share of the cores.
+	* @param[in] nWorker Number of worker processes.
+	* @param[in] path Executable of the worker.
+	* @param[in] args Arguments of the worker.
+	* @return Type: <B>bool</B>\n
+	*				If the function succeeds, the return value is <B>true</B>.
+	*/
+	bool spawnWorkers(int nWorker, const char* path, const std::vector<std::string>& args);
+
+	/**
+	* @brief Generate the hologram of the generator with the workers.
+	* @details Waits until nWorker workers, spawned or started by hand, are connected.
+	*  The result is stored in complex_H of the generator.
+	* @param[in] flag Generator specific flag, the diffraction flag of ophPointCloud.
+	* @param[in] nWorker Number of workers to wait for.
+	* @param[in] nTile Number of tiles. 0 selects 8 tiles per worker for hologram rows,
+	*  and 1 tile per worker for summed contributions.
+	* @return Type: <B>Real</B>\n
+	*				Elapsed time (sec), or a negative value if the generation failed.
+	*/
+	Real generateHologram(uint flag, int nWorker, int nTile = 0);
+
+	/**
+	* @brief Worker main loop.
+	* @details Connects to the coordinator and generates tiles until the coordinator finishes.
+	* @param[in] gen Generator with the same scene and config as the coordinator.
+	* @param[in] host Host name or address of the coordinator.
+	* @param[in] port TCP port of the coordinator.
+	* @return Type: <B>bool</B>\n
+	*				If the worker finished without error, the return value is <B>true</B>.
+	*/
+	static bool runWorker(ophGen* gen, const char* host, int port);
+
+private:
+	/**
+	* @brief Wait for the spawned workers.
+	*/
+	void release(void);
+
+private:
+	ophGen*					m_pGen;
+	/// listening socket of the coordinator.
+	int						m_nListen;
+	int						m_nPort;
+	/// spawned worker processes.
+	std::vector<int>		m_vecPID;
+};
+
+#endif // !__ophDistributed_h
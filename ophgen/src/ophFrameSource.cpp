@@ -0,0 +1,395 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  By downloading, copying, installing or using the software you agree to this license.
+//  If you do not agree to this license, do not download, install, copy or use the software.
+//
+//
+//                           License Agreement
+//                For Open Source Digital Holographic Library
+//
+// Openholo library is free software;
+// you can redistribute it and/or modify it under the terms of the BSD 2-Clause license.
+//
+// Copyright (C) 2017-2024, Korea Electronics Technology Institute. All rights reserved.
+// E-mail : contact.openholo@gmail.com
+// Web : http://www.openholo.org
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+//  1. Redistribution's of source code must retain the above copyright notice,
+//     this list of conditions and the following disclaimer.
+//
+//  2. Redistribution's in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+// This software is provided by the copyright holders and contributors "as is" and
+// any express or implied warranties, including, but not limited to, the implied
+// warranties of merchantability and fitness for a particular purpose are disclaimed.
+// In no event shall the copyright holder or contributors be liable for any direct,
+// indirect, incidental, special, exemplary, or consequential damages
+// (including, but not limited to, procurement of substitute goods or services;
+// loss of use, data, or profits; or business interruption) however caused
+// and on any theory of liability, whether in contract, strict liability,
+// or tort (including negligence or otherwise) arising in any way out of
+// the use of this software, even if advised of the possibility of such damage.
+//
+// This software contains opensource software released under GNU Generic Public License,
+// NVDIA Software License Agreement, or CUDA supplement to Software License Agreement.
+// Check whether software you use contains licensed software.
+//
+//M*/
+
+#include "ophFrameSource.h"
+#include "sys.h"
+
+#ifndef _WIN64
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <semaphore.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <atomic>
+#include <new>
+#endif
+
+#define FRAME_MAGIC			0x4F504846	// "OPHF"
+#define FRAME_HEADER		4096		// offset of the first slot, keeps the planes page aligned
+#define FRAME_ALIGN			64			// alignment of every plane
+
+#ifndef _WIN64
+/**
+* @brief Header of the frame ring at the start of the shared memory object.
+* @details Frame n is in slot n % slots. The producer owns the slots of the frames
+*  [written, consumed + slots), the consumer the slots of [consumed, written).
+*/
+struct FrameRing {
+	std::atomic<uint32_t> magic;		// set last by the producer, once the header is valid
+	uint32_t width;
+	uint32_t height;
+	uint32_t channels;
+	uint32_t slots;
+	uint32_t reserved;
+	uint64_t plane;						// bytes per plane
+	uint64_t slotSize;					// bytes per slot, (channels + 1) planes
+	std::atomic<uint64_t> written;		// frames committed by the producer
+	std::atomic<uint64_t> consumed;		// frames released by the consumer
+	int64_t timestamp[FRAME_MAX_SLOT];	// CLOCK_MONOTONIC (nsec) of the commit of each slot
+	sem_t ready;						// posted once per committed frame
+};
+static_assert(sizeof(FrameRing) <= FRAME_HEADER, "frame ring header");
+
+static int64_t monotonicNs(void)
+{
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// the header is written by another process, so it is checked before any slot is addressed.
+static bool isFrameRing(const FrameRing* ring, uint64_t size)
+{
+	if (ring->magic.load(std::memory_order_acquire) != FRAME_MAGIC)
+		return false;
+	if (ring->width == 0 || ring->height == 0 || ring->channels == 0 ||
+		ring->slots == 0 || ring->slots > FRAME_MAX_SLOT || ring->plane == 0 || ring->slotSize == 0)
+		return false;
+	// every product is checked against a quotient, so none of them can overflow.
+	if ((uint64_t)ring->width * ring->height > ring->plane)
+		return false;
+	if (ring->plane > ring->slotSize / (ring->channels + 1ULL))
+		return false;
+	return size >= FRAME_HEADER && ring->slotSize <= (size - FRAME_HEADER) / ring->slots;
+}
+
+static uchar* slotPlane(void* shm, uint64_t frame, uint plane)
+{
+	FrameRing* ring = reinterpret_cast<FrameRing*>(shm);
+	return (uchar *)shm + FRAME_HEADER + (frame % ring->slots) * ring->slotSize + plane * ring->plane;
+}
+#endif
+
+ophFrameSource::ophFrameSource(void)
+	: m_pShm(nullptr)
+	, m_nShmSize(0)
+	, m_vecSize(0, 0)
+	, m_nChannel(0)
+	, m_nAcquired(-1)
+	, m_nFrame(0)
+	, m_nSkipped(0)
+	, m_dLatency(0)
+{
+}
+
+ophFrameSource::~ophFrameSource(void)
+{
+	close();
+}
+
+bool ophFrameSource::open(const char* name)
+{
+#ifdef _WIN64
+	LOG("<FAILED> Shared memory frame source is not supported on Windows.\n");
+	return false;
+#else
+	close();
+
+	int fd = shm_open(name, O_RDWR, 0600);
+	if (fd < 0) {
+		LOG("<FAILED> Shared memory %s: %s\n", name, strerror(errno));
+		return false;
+	}
+	struct stat st;
+	void* pShm = MAP_FAILED;
+	if (fstat(fd, &st) == 0 && st.st_size >= FRAME_HEADER)
+		pShm = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (pShm == MAP_FAILED) {
+		LOG("<FAILED> Shared memory %s is not a frame ring.\n", name);
+		return false;
+	}
+
+	FrameRing* ring = reinterpret_cast<FrameRing*>(pShm);
+	if (!isFrameRing(ring, (uint64_t)st.st_size)) {
+		LOG("<FAILED> Shared memory %s is not a frame ring.\n", name);
+		munmap(pShm, st.st_size);
+		return false;
+	}
+	m_pShm = pShm;
+	m_nShmSize = st.st_size;
+	m_vecSize = ivec2(ring->width, ring->height);
+	m_nChannel = ring->channels;
+	m_nSkipped = 0;
+
+	LOG("Frame source %s : %dx%d, %u channels, %u slots\n", name, m_vecSize[_X], m_vecSize[_Y], m_nChannel, ring->slots);
+	return true;
+#endif
+}
+
+void ophFrameSource::close(void)
+{
+#ifndef _WIN64
+	if (m_pShm) {
+		release();
+		munmap(m_pShm, m_nShmSize);
+		m_pShm = nullptr;
+		m_nShmSize = 0;
+	}
+#endif
+}
+
+bool ophFrameSource::acquire(int timeout, bool bLatest)
+{
+#ifdef _WIN64
+	return false;
+#else
+	if (!m_pShm) return false;
+	release();
+
+	FrameRing* ring = reinterpret_cast<FrameRing*>(m_pShm);
+	timespec until;
+	clock_gettime(CLOCK_REALTIME, &until);
+	until.tv_sec += timeout / 1000;
+	until.tv_nsec += (timeout % 1000) * 1000000L;
+	if (until.tv_nsec >= 1000000000L) {
+		until.tv_sec++;
+		until.tv_nsec -= 1000000000L;
+	}
+
+	uint64_t consumed = ring->consumed.load(std::memory_order_relaxed);
+	uint64_t written = ring->written.load(std::memory_order_acquire);
+	// the semaphore may hold posts of frames taken without waiting; re-check after every wake up.
+	while (written == consumed)
+	{
+		int ret = (timeout < 0) ? sem_wait(&ring->ready) : sem_timedwait(&ring->ready, &until);
+		if (ret != 0 && errno != EINTR)
+			return false;
+		written = ring->written.load(std::memory_order_acquire);
+	}
+
+	if (bLatest && written - consumed > 1) {
+		m_nSkipped += written - 1 - consumed;
+		consumed = written - 1;
+		ring->consumed.store(consumed, std::memory_order_release);
+	}
+	m_nAcquired = (long long int)consumed;
+	m_nFrame = consumed;
+	m_dLatency = (monotonicNs() - ring->timestamp[consumed % ring->slots]) / 1e9;
+	return true;
+#endif
+}
+
+void ophFrameSource::release(void)
+{
+#ifndef _WIN64
+	if (m_pShm && m_nAcquired >= 0) {
+		FrameRing* ring = reinterpret_cast<FrameRing*>(m_pShm);
+		ring->consumed.store(m_nAcquired + 1, std::memory_order_release);
+		m_nAcquired = -1;
+	}
+#endif
+}
+
+uchar* ophFrameSource::getColor(uint ch)
+{
+#ifdef _WIN64
+	return nullptr;
+#else
+	if (m_nAcquired < 0 || ch >= m_nChannel) return nullptr;
+	return slotPlane(m_pShm, m_nAcquired, ch);
+#endif
+}
+
+uchar* ophFrameSource::getDepth(void)
+{
+#ifdef _WIN64
+	return nullptr;
+#else
+	if (m_nAcquired < 0) return nullptr;
+	return slotPlane(m_pShm, m_nAcquired, m_nChannel);
+#endif
+}
+
+ophFrameProducer::ophFrameProducer(void)
+	: m_pShm(nullptr)
+	, m_nShmSize(0)
+	, m_nReserved(-1)
+	, m_nDropped(0)
+{
+	m_szName[0] = '\0';
+}
+
+ophFrameProducer::~ophFrameProducer(void)
+{
+	close();
+}
+
+bool ophFrameProducer::create(const char* name, ivec2 size, uint nChannel, uint nSlot)
+{
+#ifdef _WIN64
+	LOG("<FAILED> Shared memory frame source is not supported on Windows.\n");
+	return false;
+#else
+	close();
+	if (size[_X] <= 0 || size[_Y] <= 0 || nChannel == 0 || nSlot < 2 || nSlot > FRAME_MAX_SLOT ||
+		strlen(name) >= sizeof(m_szName)) {
+		LOG("<FAILED> Wrong frame ring parameters.\n");
+		return false;
+	}
+
+	const uint64_t plane = ((uint64_t)size[_X] * size[_Y] + FRAME_ALIGN - 1) & ~(uint64_t)(FRAME_ALIGN - 1);
+	const uint64_t slotSize = plane * (nChannel + 1);
+	const size_t shmSize = FRAME_HEADER + slotSize * nSlot;
+
+	shm_unlink(name);
+	int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+	void* pShm = MAP_FAILED;
+	if (fd >= 0 && ftruncate(fd, shmSize) == 0)
+		pShm = mmap(nullptr, shmSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (fd >= 0) ::close(fd);
+	if (pShm == MAP_FAILED) {
+		LOG("<FAILED> Shared memory %s: %s\n", name, strerror(errno));
+		if (fd >= 0) shm_unlink(name);
+		return false;
+	}
+
+	FrameRing* ring = new (pShm) FrameRing;
+	ring->width = size[_X];
+	ring->height = size[_Y];
+	ring->channels = nChannel;
+	ring->slots = nSlot;
+	ring->reserved = 0;
+	ring->plane = plane;
+	ring->slotSize = slotSize;
+	ring->written.store(0, std::memory_order_relaxed);
+	ring->consumed.store(0, std::memory_order_relaxed);
+	memset(ring->timestamp, 0, sizeof(ring->timestamp));
+	if (sem_init(&ring->ready, 1, 0) != 0) {
+		LOG("<FAILED> sem_init: %s\n", strerror(errno));
+		munmap(pShm, shmSize);
+		shm_unlink(name);
+		return false;
+	}
+	ring->magic.store(FRAME_MAGIC, std::memory_order_release);
+
+	m_pShm = pShm;
+	m_nShmSize = shmSize;
+	strcpy(m_szName, name);
+	m_nDropped = 0;
+	return true;
+#endif
+}
+
+void ophFrameProducer::close(void)
+{
+#ifndef _WIN64
+	if (m_pShm) {
+		munmap(m_pShm, m_nShmSize);
+		shm_unlink(m_szName);
+		m_pShm = nullptr;
+		m_nShmSize = 0;
+		m_nReserved = -1;
+	}
+#endif
+}
+
+bool ophFrameProducer::beginFrame(void)
+{
+#ifdef _WIN64
+	return false;
+#else
+	if (!m_pShm) return false;
+	if (m_nReserved >= 0) return true;
+
+	FrameRing* ring = reinterpret_cast<FrameRing*>(m_pShm);
+	uint64_t written = ring->written.load(std::memory_order_relaxed);
+	uint64_t consumed = ring->consumed.load(std::memory_order_acquire);
+	if (written - consumed >= ring->slots) {
+		m_nDropped++;
+		return false;
+	}
+	m_nReserved = (long long int)written;
+	return true;
+#endif
+}
+
+bool ophFrameProducer::commitFrame(void)
+{
+#ifdef _WIN64
+	return false;
+#else
+	if (!m_pShm || m_nReserved < 0) return false;
+
+	FrameRing* ring = reinterpret_cast<FrameRing*>(m_pShm);
+	ring->timestamp[m_nReserved % ring->slots] = monotonicNs();
+	ring->written.store(m_nReserved + 1, std::memory_order_release);
+	m_nReserved = -1;
+	sem_post(&ring->ready);
+	return true;
+#endif
+}
+
+uchar* ophFrameProducer::getColor(uint ch)
+{
+#ifdef _WIN64
+	return nullptr;
+#else
+	if (m_nReserved < 0 || ch >= reinterpret_cast<FrameRing*>(m_pShm)->channels) return nullptr;
+	return slotPlane(m_pShm, m_nReserved, ch);
+#endif
+}
+
+uchar* ophFrameProducer::getDepth(void)
+{
+#ifdef _WIN64
+	return nullptr;
+#else
+	if (m_nReserved < 0) return nullptr;
+	return slotPlane(m_pShm, m_nReserved, reinterpret_cast<FrameRing*>(m_pShm)->channels);
+#endif
+}
@@ -0,0 +1,232 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  By downloading, copying, installing or using the software you agree to this license.
+//  If you do not agree to this license, do not download, install, copy or use the software.
+//
+//
+//                           License Agreement
+//                For Open Source Digital Holographic Library
+//
+// Openholo library is free software;
+// you can redistribute it and/or modify it under the terms of the BSD 2-Clause license.
+//
+// Copyright (C) 2017-2024, Korea Electronics Technology Institute. All rights reserved.
+// E-mail : contact.openholo@gmail.com
+// Web : http://www.openholo.org
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+//  1. Redistribution's of source code must retain the above copyright notice,
+//     this list of conditions and the following disclaimer.
+//
+//  2. Redistribution's in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+// This software is provided by the copyright holders and contributors "as is" and
+// any express or implied warranties, including, but not limited to, the implied
+// warranties of merchantability and fitness for a particular purpose are disclaimed.
+// In no event shall the copyright holder or contributors be liable for any direct,
+// indirect, incidental, special, exemplary, or consequential damages
+// (including, but not limited to, procurement of substitute goods or services;
+// loss of use, data, or profits; or business interruption) however caused
+// and on any theory of liability, whether in contract, strict liability,
+// or tort (including negligence or otherwise) arising in any way out of
+// the use of this software, even if advised of the possibility of such damage.
+//
+// This software contains opensource software released under GNU Generic Public License,
+// NVDIA Software License Agreement, or CUDA supplement to Software License Agreement.
+// Check whether software you use contains licensed software.
+//
+//M*/
+
+#ifndef __ophFrameSource_h
+#define __ophFrameSource_h
+
+#include "ophGen.h"
+
+using namespace oph;
+
+#define FRAME_MAX_SLOT		16			// maximum number of slots of a frame ring
+
+/**
+* @ingroup gen
+* @brief Consumer of RGB-D frames in a POSIX shared memory ring buffer.
+* @details A renderer process writes frames with ophFrameProducer into a ring of slots in a
+*  shared memory object, and the hologram process reads them in place, with no file I/O and
+*  no copy. A slot holds one 8-bit plane per color channel followed by the 8-bit depth plane,
+*  in the layout of ophDepthMap::setRGBImageBuffer and ophDepthMap::setDepthImageBuffer.
+*  There is a single producer and a single consumer. When the ring is full, the producer
+*  drops its frame instead of waiting, so a slow consumer never stalls the renderer.
+*
+*  Consumer:
+*  @code
+*	ophDepthMap* gen = new ophDepthMap();
+*	gen->readConfig(cfg);
+*	ophFrameSource source;
+*	source.open("/renderer");
+*	while (gen->generateFrame(&source, ophGen::ENCODE_PHASE) >= 0)
+*		display(gen->getEncodedBuffer(0));
+*  @endcode
+*  Only Linux is supported.
+* @see ophFrameProducer, ophDepthMap::generateFrame
+*/
+class GEN_DLL ophFrameSource
+{
+public:
+	/**
+	* @brief Constructor
+	*/
+	explicit ophFrameSource(void);
+	~ophFrameSource(void);
+
+	/**
+	* @brief Attach to the frame ring created by a producer.
+	* @param[in] name Name of the shared memory object, e.g. "/renderer".
+	* @return Type: <B>bool</B>\n
+	*				If the function succeeds, the return value is <B>true</B>.
+	*/
+	bool open(const char* name);
+
+	/**
+	* @brief Detach from the frame ring.
+	*/
+	void close(void);
+
+	/**
+	* @brief Acquire the next frame.
+	* @details The frame stays valid and is not overwritten until release is called.
+	* @param[in] timeout msec to wait for a frame, -1 to wait forever.
+	* @param[in] bLatest If true, skip the pending frames older than the newest one.
+	* @return Type: <B>bool</B>\n
+	*				If a frame was acquired, the return value is <B>true</B>.
+	*/
+	bool acquire(int timeout = -1, bool bLatest = false);
+
+	/**
+	* @brief Hand the acquired frame back to the producer.
+	*/
+	void release(void);
+
+	bool isOpen(void) { return m_pShm != nullptr; }
+	ivec2 getSize(void) { return m_vecSize; }
+	uint getChannels(void) { return m_nChannel; }
+
+	/**
+	* @brief Color plane of the acquired frame.
+	*/
+	uchar* getColor(uint ch);
+
+	/**
+	* @brief Depth plane of the acquired frame.
+	*/
+	uchar* getDepth(void);
+
+	/**
+	* @brief Sequence number of the acquired frame.
+	*/
+	unsigned long long getFrameNumber(void) { return m_nFrame; }
+
+	/**
+	* @brief Time (sec) from the commit of the acquired frame by the producer until it was acquired.
+	*/
+	Real getIngestLatency(void) { return m_dLatency; }
+
+	/**
+	* @brief Number of frames skipped by acquire with bLatest.
+	*/
+	unsigned long long getSkipped(void) { return m_nSkipped; }
+
+private:
+	void*					m_pShm;
+	size_t					m_nShmSize;
+	ivec2					m_vecSize;
+	uint					m_nChannel;
+	/// frame held by the consumer, or -1.
+	long long int			m_nAcquired;
+	unsigned long long		m_nFrame;
+	unsigned long long		m_nSkipped;
+	Real					m_dLatency;
+};
+
+/**
+* @ingroup gen
+* @brief Producer of RGB-D frames for ophFrameSource, linked into the renderer.
+* @details
+*  @code
+*	ophFrameProducer producer;
+*	producer.create("/renderer", ivec2(1920, 1080), 3);
+*	for (;;) {
+*		if (producer.beginFrame()) {
+*			render(producer.getColor(0), producer.getColor(1), producer.getColor(2), producer.getDepth());
+*			producer.commitFrame();
+*		}
+*	}
+*  @endcode
+* @see ophFrameSource
+*/
+class GEN_DLL ophFrameProducer
+{
+public:
+	/**
+	* @brief Constructor
+	*/
+	explicit ophFrameProducer(void);
+	~ophFrameProducer(void);
+
+	/**
+	* @brief Create the frame ring.
+	* @param[in] name Name of the shared memory object, e.g. "/renderer". An existing object is replaced.
+	* @param[in] size Frame size in pixels, the hologram resolution of the consumer.
+	* @param[in] nChannel Number of color channels, the number of wavelengths of the consumer.
+	* @param[in] nSlot Number of slots, 2 to FRAME_MAX_SLOT.
+	* @return Type: <B>bool</B>\n
+	*				If the function succeeds, the return value is <B>true</B>.
+	*/
+	bool create(const char* name, ivec2 size, uint nChannel, uint nSlot = 3);
+
+	/**
+	* @brief Remove the frame ring.
+	*/
+	void close(void);
+
+	/**
+	* @brief Reserve the next slot to render into.
+	* @return Type: <B>bool</B>\n
+	*				If all slots are held by the consumer, the frame is dropped and the return value is <B>false</B>.
+	*/
+	bool beginFrame(void);
+
+	/**
+	* @brief Publish the reserved slot to the consumer.
+	*/
+	bool commitFrame(void);
+
+	/**
+	* @brief Color plane of the reserved slot.
+	*/
+	uchar* getColor(uint ch);
+
+	/**
+	* @brief Depth plane of the reserved slot.
+	*/
+	uchar* getDepth(void);
+
+	/**
+	* @brief Number of frames dropped by beginFrame.
+	*/
+	unsigned long long getDropped(void) { return m_nDropped; }
+
+private:
+	void*					m_pShm;
+	size_t					m_nShmSize;
+	char					m_szName[64];
+	/// reserved slot, or -1.
+	long long int			m_nReserved;
+	unsigned long long		m_nDropped;
+};
+
+#endif // !__ophFrameSource_h
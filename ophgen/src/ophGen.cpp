@@ -119,9 +119,12 @@ ophGen::ophGen(void)
 	, m_lpNormalized(nullptr)
 	, m_nOldChannel(0)
 	, m_precision(PRECISION::DOUBLE)
+	, m_pBLASMBuffer(nullptr)
+	, m_nBLASMBuffer(0)
 	, m_dFieldLength(0.0)
 	, m_nStream(1)
 	, m_mode(0)
+	, m_vecTileRow(0, 0)
 	, AS(nullptr)
 	, normalized(nullptr)
 	, fftTemp(nullptr)
@@ -139,7 +142,7 @@ ophGen::ophGen(void)
 
 ophGen::~ophGen(void)
 {
-
+	releaseBandLimitedASM();
 }
 
 void ophGen::initialize(void)
@@ -401,6 +404,10 @@ void ophGen::RS_Diffraction(Point src, Complex<Real> *dst, Real lambda, Real dis
 	if (Xbound[_Y] < 0)		Xbound[_Y] = 0;
 	if (Ybound[_X] > pnY) Ybound[_X] = pnY;
 	if (Ybound[_Y] < 0)		Ybound[_Y] = 0;
+	if (m_vecTileRow[_Y] > m_vecTileRow[_X]) {
+		if (Ybound[_X] > m_vecTileRow[_Y]) Ybound[_X] = m_vecTileRow[_Y];
+		if (Ybound[_Y] < m_vecTileRow[_X]) Ybound[_Y] = m_vecTileRow[_X];
+	}
 
 
 	for (int yytr = Ybound[_Y]; yytr < Ybound[_X]; ++yytr)
@@ -485,6 +492,10 @@ void ophGen::Fresnel_Diffraction(Point src, Complex<Real> *dst, Real lambda, Rea
 	if (Xbound[_Y] < 0)		Xbound[_Y] = 0;
 	if (Ybound[_X] > pnY) Ybound[_X] = pnY;
 	if (Ybound[_Y] < 0)		Ybound[_Y] = 0;
+	if (m_vecTileRow[_Y] > m_vecTileRow[_X]) {
+		if (Ybound[_X] > m_vecTileRow[_Y]) Ybound[_X] = m_vecTileRow[_Y];
+		if (Ybound[_Y] < m_vecTileRow[_X]) Ybound[_Y] = m_vecTileRow[_X];
+	}
 
 	for (int yytr = Ybound[_Y]; yytr < Ybound[_X]; ++yytr)
 	{
@@ -594,27 +605,40 @@ void ophGen::Fresnel_FFT(Complex<Real> *src, Complex<Real> *dst, Real lambda, Re
 	delete[] temp3;
 }
 
-void ophGen::AngularSpectrumMethod(Complex<Real> *src, Complex<Real> *dst, Real lambda, Real distance)
+void ophGen::AngularSpectrumMethod(Complex<Real> *src, Complex<Real> *dst, Real lambda, Real distance, bool bBandLimit)
+{
+	context_.ss[_X] = context_.pixel_number[_X] * context_.pixel_pitch[_X];
+	context_.ss[_Y] = context_.pixel_number[_Y] * context_.pixel_pitch[_Y];
+	context_.k = (2 * M_PI / lambda);
+
+	accumulateAngularSpectrum(src, dst, lambda, distance, bBandLimit);
+}
+
+void ophGen::accumulateAngularSpectrum(Complex<Real> *src, Complex<Real> *dst, Real lambda, Real distance, bool bBandLimit)
 {
 	const int pnX = context_.pixel_number[_X];
 	const int pnY = context_.pixel_number[_Y];
 	const int N = pnX * pnY;
 	const Real ppX = context_.pixel_pitch[_X];
 	const Real ppY = context_.pixel_pitch[_Y];
-	const Real ssX = context_.ss[_X] = pnX * ppX;
-	const Real ssY = context_.ss[_Y] = pnY * ppY;
+	const Real ssX = pnX * ppX;
+	const Real ssY = pnY * ppY;
 
 	Real dfx = 1 / ssX;
 	Real dfy = 1 / ssY;
 
-	Real k = context_.k = (2 * M_PI / lambda);
+	Real k = (2 * M_PI / lambda);
 	Real kk = k * k;
 	Real kd = k * distance;
 	Real fx = -1 / (ppX * 2);
 	Real fy = 1 / (ppY * 2);
 
+	// band limit of the transfer function sampled on the unpadded grid
+	Real limitX = bBandLimit ? 1 / (lambda * sqrt(4 * distance * distance * dfx * dfx + 1)) : MAX_DOUBLE;
+	Real limitY = bBandLimit ? 1 / (lambda * sqrt(4 * distance * distance * dfy * dfy + 1)) : MAX_DOUBLE;
+
 #ifdef _OPENMP
-#pragma omp parallel for firstprivate(pnX, dfx, dfy, lambda, kd, kk)
+#pragma omp parallel for firstprivate(pnX, dfx, dfy, lambda, kd, kk, limitX, limitY)
 #endif
 	for (int i = 0; i < N; i++)
 	{
@@ -624,45 +648,212 @@ void ophGen::AngularSpectrumMethod(Complex<Real> *src, Complex<Real> *dst, Real
 		Real fxx = fx + dfx * x;
 		Real fyy = fy - dfy - dfy * y;
 
+		bool prop_mask = ((fxx * fxx + fyy * fyy) < kk) && (fabs(fxx) < limitX) && (fabs(fyy) < limitY);
+		if (!prop_mask) continue;
+
 		Real fxxx = lambda * fxx;
 		Real fyyy = lambda * fyy;
 
-		Real sval = sqrt(1 - (fxxx * fxxx) - (fyyy * fyyy));
-		sval = sval * kd;
+		Real sval = 1 - (fxxx * fxxx) - (fyyy * fyyy);
+		if (sval < 0) continue;
+		sval = sqrt(sval) * kd;
 		Complex<Real> kernel(0, sval);
 		kernel.exp();
 
-		bool prop_mask = ((fxx * fxx + fyy * fyy) < kk) ? true : false;
+		Complex<Real> u_frequency = kernel * src[i];
+		dst[i][_RE] += u_frequency[_RE];
+		dst[i][_IM] += u_frequency[_IM];
+	}
+}
+
+ivec2 ophGen::getBandLimitedASMSize(Real lambda, Real distance, const Complex<Real>* field)
+{
+	const ivec2 pn = context_.pixel_number;
+	const vec2 pp = context_.pixel_pitch;
+	ivec2 begin(0, 0);
+	ivec2 end = pn;
+	ivec2 size;
+
+	if (field != nullptr)
+	{
+		// non-zero extent [begin, end) of the field.
+		vector<int> rowBegin(pn[_Y]), rowEnd(pn[_Y]);
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+		for (int j = 0; j < pn[_Y]; j++)
+		{
+			const Complex<Real> *row = field + (long long int)j * pn[_X];
+			int b = 0, e = pn[_X];
+			while (b < e && row[b].real() == 0 && row[b].imag() == 0) b++;
+			while (e > b && row[e - 1].real() == 0 && row[e - 1].imag() == 0) e--;
+			rowBegin[j] = b;
+			rowEnd[j] = e;
+		}
+		begin = pn;
+		end = ivec2(0, 0);
+		for (int j = 0; j < pn[_Y]; j++)
+		{
+			if (rowBegin[j] == rowEnd[j]) continue;
+			if (rowBegin[j] < begin[_X]) begin[_X] = rowBegin[j];
+			if (rowEnd[j] > end[_X]) end[_X] = rowEnd[j];
+			if (j < begin[_Y]) begin[_Y] = j;
+			end[_Y] = j + 1;
+		}
+		if (end[_Y] == 0) return pn;
+	}
 
-		Complex<Real> u_frequency;
-		if (prop_mask) {
-			u_frequency = kernel * src[i];
-			dst[i][_RE] += u_frequency[_RE];
-			dst[i][_IM] += u_frequency[_IM];
+	for (int axis = _X; axis <= _Y; axis++)
+	{
+		// the field reaches this far from the opposite edge of the hologram and spreads
+		// within the maximum diffraction angle of the pixel pitch. The band limit of an
+		// n-sample grid keeps the spread within n / 2, so reach + spread samples never
+		// wrap onto the hologram, and 2 * reach are always enough.
+		int reach = (std::max)(end[axis], pn[axis] - begin[axis]);
+		int spread = reach;
+		Real sinTheta = lambda / (2 * pp[axis]);
+		if (sinTheta < 1)
+		{
+			Real ratio = fabs(distance) * sinTheta / sqrt(1 - sinTheta * sinTheta) / pp[axis];
+			if (ratio < reach)
+				spread = int(ratio);
 		}
+		size[axis] = (reach + spread > pn[axis]) ? getOptimalFFTSize(reach + spread) : pn[axis];
 	}
+	return size;
 }
 
-void ophGen::conv_fft2(Complex<Real>* src1, Complex<Real>* src2, Complex<Real>* dst, ivec2 size)
+void ophGen::BandLimitedASM(Complex<Real>* src, Complex<Real>* dst, Real lambda, Real distance)
 {
-	int N = size[_X] * size[_Y];
-	if (N <= 0) return;
+	BandLimitedASM(src, dst, lambda, distance, getBandLimitedASMSize(lambda, distance));
+}
 
-	Complex<Real>* src1FT = new Complex<Real>[N];
-	Complex<Real>* src2FT = new Complex<Real>[N];
-	Complex<Real>* dstFT = new Complex<Real>[N];
+void ophGen::BandLimitedASM(Complex<Real>* src, Complex<Real>* dst, Real lambda, Real distance, const ivec2& size)
+{
+	const int nX = size[_X];
+	const int nY = size[_Y];
+	const long long int N = (long long int)nX * nY;
 
-	fft2(src1, src1FT, size[_X], size[_Y], OPH_FORWARD, (bool)OPH_ESTIMATE);
-	fft2(src2, src2FT, size[_X], size[_Y], OPH_FORWARD, (bool)OPH_ESTIMATE);
+	if (m_nBLASMBuffer < N)
+	{
+		if (m_pBLASMBuffer) fftw_free(m_pBLASMBuffer);
+		m_pBLASMBuffer = (fftw_complex *)fftw_malloc(sizeof(fftw_complex) * N);
+		m_nBLASMBuffer = N;
+	}
+	fftw_complex *buf = m_pBLASMBuffer;
 
-	for (int i = 0; i < N; i++)
-		dstFT[i] = src1FT[i] * src2FT[i];
+	// plans are created in-place with FFTW_ESTIMATE, so they do not touch the buffer
+	// and stay valid for any fftw_malloc'ed buffer of at least this size.
+	auto plan = m_mapBLASMPlan.find(std::make_pair(nX, nY));
+	if (plan == m_mapBLASMPlan.end())
+	{
+		fftw_plan fwd = fftw_plan_dft_2d(nY, nX, buf, buf, FFTW_FORWARD, FFTW_ESTIMATE);
+		fftw_plan bwd = fftw_plan_dft_2d(nY, nX, buf, buf, FFTW_BACKWARD, FFTW_ESTIMATE);
+		plan = m_mapBLASMPlan.insert(std::make_pair(std::make_pair(nX, nY), std::make_pair(fwd, bwd))).first;
+	}
+
+	BandLimitedASM(src, dst, lambda, distance, size, buf, plan->second.first, plan->second.second);
+}
 
-	fft2(dstFT, dst, size[_X], size[_Y], OPH_BACKWARD, (bool)OPH_ESTIMATE);
+void ophGen::BandLimitedASM(Complex<Real>* src, Complex<Real>* dst, Real lambda, Real distance, const ivec2& size, fftw_complex* buf, fftw_plan fwd, fftw_plan bwd)
+{
+	const int pnX = context_.pixel_number[_X];
+	const int pnY = context_.pixel_number[_Y];
+	const Real ppX = context_.pixel_pitch[_X];
+	const Real ppY = context_.pixel_pitch[_Y];
+	const int nX = size[_X];
+	const int nY = size[_Y];
+	const long long int N = (long long int)nX * nY;
+	Complex<Real> *temp = reinterpret_cast<Complex<Real> *>(buf);
 
-	delete[] src1FT;
-	delete[] src2FT;
-	delete[] dstFT;
+	// the field sits at the origin; the padded margin absorbs the circular wrap.
+#ifdef _OPENMP
+#pragma omp parallel for firstprivate(pnX, pnY, nX)
+#endif
+	for (int j = 0; j < nY; j++)
+	{
+		Complex<Real> *row = temp + (long long int)j * nX;
+		if (j < pnY)
+		{
+			memcpy(row, &src[(long long int)j * pnX], sizeof(Complex<Real>) * pnX);
+			memset(row + pnX, 0, sizeof(Complex<Real>) * (nX - pnX));
+		}
+		else
+			memset(row, 0, sizeof(Complex<Real>) * nX);
+	}
+
+	fftw_execute_dft(fwd, buf, buf);
+
+	const Real dfx = 1 / (nX * ppX);
+	const Real dfy = 1 / (nY * ppY);
+	const Real v = 1 / (lambda * lambda);
+	const Real z = 2 * M_PI * distance;
+	const Real norm = 1.0 / N;
+	const Real limitX = 1 / (lambda * sqrt(4 * distance * distance * dfx * dfx + 1));
+	const Real limitY = 1 / (lambda * sqrt(4 * distance * distance * dfy * dfy + 1));
+	const Complex<Real> zero(0, 0);
+
+#ifdef _OPENMP
+#pragma omp parallel for firstprivate(nX, nY, dfx, dfy, v, z, norm, limitX, limitY)
+#endif
+	for (int j = 0; j < nY; j++)
+	{
+		Real fy = (j < (nY + 1) / 2 ? j : j - nY) * dfy;
+		Real fyy = fy * fy;
+		Complex<Real> *row = temp + (long long int)j * nX;
+		bool bBandY = fabs(fy) < limitY;
+
+		for (int i = 0; i < nX; i++)
+		{
+			Real fx = (i < (nX + 1) / 2 ? i : i - nX) * dfx;
+			Real sqrtPart = v - fx * fx - fyy;
+
+			if (!bBandY || fabs(fx) >= limitX || sqrtPart < 0)
+			{
+				row[i] = zero;
+				continue;
+			}
+			Complex<Real> prop(0, z * sqrt(sqrtPart));
+			row[i] *= prop.exp() * norm;
+		}
+	}
+
+	fftw_execute_dft(bwd, buf, buf);
+
+#ifdef _OPENMP
+#pragma omp parallel for firstprivate(pnX, nX)
+#endif
+	for (int j = 0; j < pnY; j++)
+	{
+		memcpy(&dst[(long long int)j * pnX], temp + (long long int)j * nX, sizeof(Complex<Real>) * pnX);
+	}
+}
+
+void ophGen::releaseBandLimitedASM(void)
+{
+	for (auto it = m_mapBLASMPlan.begin(); it != m_mapBLASMPlan.end(); it++)
+	{
+		fftw_destroy_plan(it->second.first);
+		fftw_destroy_plan(it->second.second);
+	}
+	m_mapBLASMPlan.clear();
+
+	if (m_pBLASMBuffer) {
+		fftw_free(m_pBLASMBuffer);
+		m_pBLASMBuffer = nullptr;
+	}
+	m_nBLASMBuffer = 0;
+}
+
+void ophGen::conv_fft2(Complex<Real>* src1, Complex<Real>* src2, Complex<Real>* dst, ivec2 size)
+{
+	int N = size[_X] * size[_Y];
+	if (N <= 0) return;
+
+	// keeps the output scale of the three normalized fft2 calls it replaces.
+	ophConvolution conv;
+	if (!conv.init(size)) return;
+	conv.execute(src1, src2, dst, Complex<Real>(1 / ((Real)N * N), 0));
 }
 
 void ophGen::normalize(uint ch)
@@ -1517,68 +1708,7 @@ void ophGen::fresnelPropagation(OphConfig context, Complex<Real>* in, Complex<Re
 
 void ophGen::fresnelPropagation(Complex<Real>* in, Complex<Real>* out, Real distance, uint channel)
 {
-	const int pnX = context_.pixel_number[_X];
-	const int pnY = context_.pixel_number[_Y];
-	const Real ppX = context_.pixel_pitch[_X];
-	const Real ppY = context_.pixel_pitch[_Y];
-	const int pnXY = pnX * pnY;
-	const Real lambda = context_.wave_length[channel];
-	const Real ssX = pnX * ppX * 2;
-	const Real ssY = pnY * ppY * 2;
-	const Real z = 2 * M_PI * distance;
-	const Real v = 1 / (lambda * lambda);
-	const int hpnX = pnX / 2;
-	const int hpnY = pnY / 2;
-	const int pnX2 = pnX * 2;
-	const int pnY2 = pnY * 2;
-
-	Complex<Real>* temp = new Complex<Real>[pnXY * 4];
-	memset(temp, 0, sizeof(Complex<Real>) * pnXY * 4);
-
-#ifdef _OPENMP
-#pragma omp parallel for firstprivate(pnX, pnX2, hpnX, hpnY)
-#endif
-	for (int i = 0; i < pnY; i++)
-	{
-		int src = pnX * i;
-		int dst = pnX2 * (i + hpnY) + hpnX;
-		memcpy(&temp[dst], &in[src], sizeof(Complex<Real>) * pnX);
-	}
-	
-	fft2(temp, temp, pnX2, pnY2, OPH_FORWARD, false);
-	
-#ifdef _OPENMP
-#pragma omp parallel for firstprivate(ssX, ssY, z, v)
-#endif
-	for (int j = 0; j < pnY2; j++)
-	{
-		Real fy = (-pnY + j) / ssY;
-		Real fyy = fy * fy;
-		int iWidth = j * pnX2;
-		for (int i = 0; i < pnX2; i++)
-		{
-			Real fx = (-pnX + i) / ssX;
-			Real fxx = fx * fx;
-
-			Real sqrtPart = sqrt(v - fxx - fyy);
-			Complex<Real> prop(0, z * sqrtPart);
-			temp[iWidth + i] *= prop.exp();
-		}
-	}
-
-	fft2(temp, temp, pnX2, pnY2, OPH_BACKWARD, true);
-
-#ifdef _OPENMP
-#pragma omp parallel for firstprivate(pnX, pnX2, hpnX, hpnY)
-#endif
-	for (int i = 0; i < pnY; i++)
-	{
-		int src = pnX2 * (i + hpnY) + hpnX;
-		int dst = pnX * i;
-		memcpy(&out[dst], &temp[src], sizeof(Complex<Real>) * pnX);
-	}
-	delete[] temp;
-
+	BandLimitedASM(in, out, context_.wave_length[channel], distance);
 }
 
 bool ophGen::Shift(Real x, Real y)
@@ -2184,4 +2314,213 @@ void ophGen::ophFree(void)
 	}
 
 	if (freqW != nullptr) delete[] freqW;
+
+	releaseBandLimitedASM();
+}
+
+ophConvolution::ophConvolution(void)
+	: m_vecSize(0, 0)
+	, m_nSize(0)
+	, m_planFwd(nullptr)
+	, m_planBwd(nullptr)
+	, m_planFwdST(nullptr)
+	, m_planBwdST(nullptr)
+	, m_pOperand(nullptr)
+	, m_bOperand(false)
+{
+}
+
+ophConvolution::~ophConvolution(void)
+{
+	release();
+}
+
+bool ophConvolution::init(ivec2 size)
+{
+	if (size[_X] <= 0 || size[_Y] <= 0) {
+		LOG("<FAILED> Wrong convolution size : %d x %d\n", size[_X], size[_Y]);
+		return false;
+	}
+	if (m_planFwd != nullptr && size == m_vecSize)
+		return true;
+
+	release();
+	m_vecSize = size;
+	m_nSize = (long long int)size[_X] * size[_Y];
+
+#ifdef _OPENMP
+	int nThread = (std::max)(omp_get_max_threads(), omp_get_num_procs());
+#else
+	int nThread = 1;
+#endif
+	m_vecWork.assign(nThread * 2, nullptr);
+	m_pOperand = (fftw_complex *)fftw_malloc(sizeof(fftw_complex) * m_nSize);
+
+	// in-place FFTW_ESTIMATE plans do not touch the buffer and run on any work buffer of this size.
+	fftw_complex *buf = getWork(0);
+	m_planFwd = fftw_plan_dft_2d(size[_Y], size[_X], buf, buf, FFTW_FORWARD, FFTW_ESTIMATE);
+	m_planBwd = fftw_plan_dft_2d(size[_Y], size[_X], buf, buf, FFTW_BACKWARD, FFTW_ESTIMATE);
+#ifdef _OPENMP
+	fftw_plan_with_nthreads(1);
+#endif
+	m_planFwdST = fftw_plan_dft_2d(size[_Y], size[_X], buf, buf, FFTW_FORWARD, FFTW_ESTIMATE);
+	m_planBwdST = fftw_plan_dft_2d(size[_Y], size[_X], buf, buf, FFTW_BACKWARD, FFTW_ESTIMATE);
+#ifdef _OPENMP
+	fftw_plan_with_nthreads(omp_get_max_threads());
+#endif
+	return true;
+}
+
+int ophConvolution::getSlot(bool& bConcurrent)
+{
+#ifdef _OPENMP
+	bConcurrent = omp_in_parallel() != 0;
+	if (!bConcurrent)
+		return 0;
+	// the threads of nested teams share thread numbers, and a team may be larger than
+	// the slots made by init(), so those calls get buffers of their own.
+	const int tid = omp_get_thread_num();
+	if (omp_get_nested() || tid * 2 + 1 >= (int)m_vecWork.size())
+		return -1;
+	return tid;
+#else
+	bConcurrent = false;
+	return 0;
+#endif
+}
+
+fftw_complex* ophConvolution::getWork(int idx)
+{
+	// each slot belongs to one thread, so the lazy allocation does not race.
+	if (m_vecWork[idx] == nullptr)
+		m_vecWork[idx] = (fftw_complex *)fftw_malloc(sizeof(fftw_complex) * m_nSize);
+	return m_vecWork[idx];
+}
+
+void ophConvolution::transform(Complex<Real>* src, fftw_complex* buf, bool bConcurrent)
+{
+	const int nx = m_vecSize[_X];
+	const int ny = m_vecSize[_Y];
+	const int hnx = nx >> 1;
+	const int hny = ny >> 1;
+	Complex<Real> *dst = reinterpret_cast<Complex<Real> *>(buf);
+
+	// same index mapping as Openholo::fftShift, one row at a time.
+#ifdef _OPENMP
+#pragma omp parallel for if(!bConcurrent) firstprivate(nx, ny, hnx, hny)
+#endif
+	for (int j = 0; j < ny; j++)
+	{
+		int tj = j - hny; if (tj < 0) tj += ny;
+		memcpy(&dst[(long long int)tj * nx], &src[(long long int)j * nx + hnx], sizeof(Complex<Real>) * (nx - hnx));
+		memcpy(&dst[(long long int)tj * nx + nx - hnx], &src[(long long int)j * nx], sizeof(Complex<Real>) * hnx);
+	}
+	fftw_execute_dft(bConcurrent ? m_planFwdST : m_planFwd, buf, buf);
+}
+
+void ophConvolution::inverse(fftw_complex* buf, Complex<Real>* dst, bool bConcurrent)
+{
+	const int nx = m_vecSize[_X];
+	const int ny = m_vecSize[_Y];
+	const int hnx = nx >> 1;
+	const int hny = ny >> 1;
+	Complex<Real> *src = reinterpret_cast<Complex<Real> *>(buf);
+
+	fftw_execute_dft(bConcurrent ? m_planBwdST : m_planBwd, buf, buf);
+#ifdef _OPENMP
+#pragma omp parallel for if(!bConcurrent) firstprivate(nx, ny, hnx, hny)
+#endif
+	for (int j = 0; j < ny; j++)
+	{
+		int tj = j - hny; if (tj < 0) tj += ny;
+		memcpy(&dst[(long long int)tj * nx], &src[(long long int)j * nx + hnx], sizeof(Complex<Real>) * (nx - hnx));
+		memcpy(&dst[(long long int)tj * nx + nx - hnx], &src[(long long int)j * nx], sizeof(Complex<Real>) * hnx);
+	}
+}
+
+void ophConvolution::setOperand(Complex<Real>* src)
+{
+	if (m_planFwd == nullptr) {
+		LOG("<FAILED> ophConvolution is not initialized.\n");
+		return;
+	}
+	transform(src, m_pOperand, false);
+	m_bOperand = true;
+}
+
+void ophConvolution::execute(Complex<Real>* src, Complex<Real>* dst, Complex<Real> scale)
+{
+	if (!m_bOperand) {
+		LOG("<FAILED> ophConvolution has no operand.\n");
+		return;
+	}
+	bool bConcurrent = false;
+	int slot = getSlot(bConcurrent);
+	const long long int N = m_nSize;
+	const Complex<Real> factor = scale / (Real)N;
+	fftw_complex *buf = (slot < 0) ? (fftw_complex *)fftw_malloc(sizeof(fftw_complex) * N) : getWork(slot * 2);
+	Complex<Real> *temp = reinterpret_cast<Complex<Real> *>(buf);
+	Complex<Real> *operand = reinterpret_cast<Complex<Real> *>(m_pOperand);
+
+	transform(src, buf, bConcurrent);
+#ifdef _OPENMP
+#pragma omp parallel for if(!bConcurrent) firstprivate(factor)
+#endif
+	for (long long int i = 0; i < N; i++)
+		temp[i] = temp[i] * operand[i] * factor;
+	inverse(buf, dst, bConcurrent);
+
+	if (slot < 0) fftw_free(buf);
+}
+
+void ophConvolution::execute(Complex<Real>* src1, Complex<Real>* src2, Complex<Real>* dst, Complex<Real> scale)
+{
+	if (m_planFwd == nullptr) {
+		LOG("<FAILED> ophConvolution is not initialized.\n");
+		return;
+	}
+	bool bConcurrent = false;
+	int slot = getSlot(bConcurrent);
+	const long long int N = m_nSize;
+	const Complex<Real> factor = scale / (Real)N;
+	fftw_complex *buf1 = (slot < 0) ? (fftw_complex *)fftw_malloc(sizeof(fftw_complex) * N) : getWork(slot * 2);
+	fftw_complex *buf2 = (slot < 0) ? (fftw_complex *)fftw_malloc(sizeof(fftw_complex) * N) : getWork(slot * 2 + 1);
+	Complex<Real> *temp1 = reinterpret_cast<Complex<Real> *>(buf1);
+	Complex<Real> *temp2 = reinterpret_cast<Complex<Real> *>(buf2);
+
+	transform(src1, buf1, bConcurrent);
+	transform(src2, buf2, bConcurrent);
+#ifdef _OPENMP
+#pragma omp parallel for if(!bConcurrent) firstprivate(factor)
+#endif
+	for (long long int i = 0; i < N; i++)
+		temp1[i] = temp1[i] * temp2[i] * factor;
+	inverse(buf1, dst, bConcurrent);
+
+	if (slot < 0) {
+		fftw_free(buf1);
+		fftw_free(buf2);
+	}
+}
+
+void ophConvolution::release(void)
+{
+	if (m_planFwd) fftw_destroy_plan(m_planFwd);
+	if (m_planBwd) fftw_destroy_plan(m_planBwd);
+	if (m_planFwdST) fftw_destroy_plan(m_planFwdST);
+	if (m_planBwdST) fftw_destroy_plan(m_planBwdST);
+	m_planFwd = m_planBwd = m_planFwdST = m_planBwdST = nullptr;
+
+	for (size_t i = 0; i < m_vecWork.size(); i++) {
+		if (m_vecWork[i]) fftw_free(m_vecWork[i]);
+	}
+	m_vecWork.clear();
+
+	if (m_pOperand) {
+		fftw_free(m_pOperand);
+		m_pOperand = nullptr;
+	}
+	m_bOperand = false;
+	m_vecSize = ivec2(0, 0);
+	m_nSize = 0;
 }
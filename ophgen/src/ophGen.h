@@ -180,13 +180,86 @@ public:
 
 	/**
 	* @brief Angular spectrum propagation method.
+	* @details The spectrum is accumulated on the hologram grid without padding.
 	* @param[in] src Each depth plane data.
 	* @param[out] dst complex data.
 	* @param[in] lambda wave length.
 	* @param[in] distance the distance from the object to the hologram plane.
+	* @param[in] bBandLimit If true, the transfer function is band-limited to the frequencies
+	*			the hologram grid samples alias-free. Default false.
 	* @see calcHoloCPU, fft2
 	*/
-	void AngularSpectrumMethod(Complex<Real>* src, Complex<Real>* dst, Real lambda, Real distance);
+	void AngularSpectrumMethod(Complex<Real>* src, Complex<Real>* dst, Real lambda, Real distance, bool bBandLimit = false);
+
+	/**
+	* @brief AngularSpectrumMethod without updating context_, so concurrent workers may call it.
+	* @param[in] src Spectrum of the depth plane.
+	* @param[out] dst Spectrum accumulator.
+	* @param[in] lambda wave length.
+	* @param[in] distance the distance from the object to the hologram plane.
+	* @param[in] bBandLimit If true, the transfer function is band-limited. Default false.
+	*/
+	void accumulateAngularSpectrum(Complex<Real>* src, Complex<Real>* dst, Real lambda, Real distance, bool bBandLimit = false);
+
+	/**
+	* @brief Band-limited angular spectrum propagation.
+	* @details The field is zero padded to getBandLimitedASMSize, propagated with
+	*			the band-limited transfer function and cropped back to the hologram size.
+	*			FFT plans are cached per padded size and reused by later calls.
+	* @param[in] src Input complex field of the hologram size.
+	* @param[out] dst Output complex field of the hologram size. It may be the same buffer as src.
+	* @param[in] lambda wave length.
+	* @param[in] distance propagation distance.
+	* @see getBandLimitedASMSize, releaseBandLimitedASM
+	*/
+	void BandLimitedASM(Complex<Real>* src, Complex<Real>* dst, Real lambda, Real distance);
+
+	/**
+	* @brief Band-limited angular spectrum propagation on a given padded size.
+	* @param[in] src Input complex field of the hologram size.
+	* @param[out] dst Output complex field of the hologram size. It may be the same buffer as src.
+	* @param[in] lambda wave length.
+	* @param[in] distance propagation distance.
+	* @param[in] size Padded FFT size from getBandLimitedASMSize.
+	*/
+	void BandLimitedASM(Complex<Real>* src, Complex<Real>* dst, Real lambda, Real distance, const ivec2& size);
+
+	/**
+	* @brief Band-limited angular spectrum propagation on the caller's resources.
+	* @details Does not touch the cached plans and buffer, so concurrent workers may call it.
+	* @param[in] src Input complex field of the hologram size.
+	* @param[out] dst Output complex field of the hologram size. It may be the same buffer as src.
+	* @param[in] lambda wave length.
+	* @param[in] distance propagation distance.
+	* @param[in] size Padded FFT size from getBandLimitedASMSize.
+	* @param[in] buf fftw_malloc'ed work buffer of at least size elements.
+	* @param[in] fwd In-place forward plan of size.
+	* @param[in] bwd In-place backward plan of size.
+	*/
+	void BandLimitedASM(Complex<Real>* src, Complex<Real>* dst, Real lambda, Real distance, const ivec2& size, fftw_complex* buf, fftw_plan fwd, fftw_plan bwd);
+
+	/**
+	* @brief Smallest alias-free FFT size of the band-limited angular spectrum method.
+	* @details Each axis must hold the reach of the field, its far edge measured from the
+	*			opposite edge of the hologram, plus its lateral spread within the maximum
+	*			diffraction angle of the pixel pitch. The spread never exceeds the reach,
+	*			since the band limit keeps it within half the padded size. The length is rounded up
+	*			to an FFT-friendly size. If the field stays clear of the hologram edges by
+	*			its spread, the hologram size itself is returned and no padding is needed.
+	* @param[in] lambda wave length.
+	* @param[in] distance propagation distance.
+	* @param[in] field Optional input field of the hologram size. Only its non-zero extent is
+	*			taken into account. If nullptr, the field covers the whole hologram.
+	* @return Type: <B>ivec2</B>\n
+	*				Padded FFT size.
+	* @see BandLimitedASM, oph::getOptimalFFTSize
+	*/
+	ivec2 getBandLimitedASMSize(Real lambda, Real distance, const Complex<Real>* field = nullptr);
+
+	/**
+	* @brief Release the cached FFT plans and buffer of the band-limited angular spectrum method.
+	*/
+	void releaseBandLimitedASM(void);
 
 	/**
 	@brief Convolution between Complex arrays which have same size
@@ -344,11 +417,19 @@ private:
 	/// previous number of channel.
 	uint					m_nOldChannel;
 	uint					m_precision;
+	/// FFT plans (forward, backward) of the band-limited angular spectrum method per padded size.
+	std::map<std::pair<int, int>, std::pair<fftw_plan, fftw_plan>> m_mapBLASMPlan;
+	/// Work buffer of the band-limited angular spectrum method.
+	fftw_complex*			m_pBLASMBuffer;
+	/// Number of elements of m_pBLASMBuffer.
+	long long int			m_nBLASMBuffer;
 
 protected:
 	Real					m_dFieldLength;
 	int						m_nStream;
 	unsigned int			m_mode;
+	/// Hologram rows [begin, end) computed by RS_Diffraction and Fresnel_Diffraction, all rows if end <= begin.
+	ivec2					m_vecTileRow;
 
 public:
 	void transVW(int nVertex, Vertex *dst, Vertex *src);
@@ -461,10 +542,12 @@ public:
 	void fresnelPropagation(OphConfig context, Complex<Real>* in, Complex<Real>* out, Real distance);
 	/**
 	* @brief Fresnel propagation
+	* @details Evaluated with BandLimitedASM, padded only as far as the distance requires.
 	* @param[in] in Input complex field
 	* @param[out] out Output complex field
 	* @param[in] distance Propagation distance
 	* @param[in] channel index of channel
+	* @see BandLimitedASM
 	*/
 	void fresnelPropagation(Complex<Real>* in, Complex<Real>* out, Real distance, uint channel);
 protected:
@@ -539,6 +622,40 @@ public:
 	void SetMode(unsigned int mode) { m_mode = mode; }
 	unsigned int GetMode() { return m_mode; }
 
+	/**
+	* @brief Number of work units of tile-distributed generation.
+	* @return Type: <B>uint</B>\n
+	*				Hologram rows or scene slabs of the generator, 0 if it does not support tile-distributed generation.
+	* @see ophDistributed
+	*/
+	virtual uint getTileUnits(void) { return 0; }
+
+	/**
+	* @brief Whether the work units of tile-distributed generation are disjoint hologram rows.
+	* @return Type: <B>bool</B>\n
+	*				<B>true</B> if every unit owns one hologram row.\n
+	*				<B>false</B> if every unit is a scene slab whose contribution to the whole hologram is summed.
+	*/
+	virtual bool isTileRows(void) { return false; }
+
+	/**
+	* @brief Prepare the read-only scene for tile-distributed generation and clear complex_H.
+	* @param[in] flag Generator specific flag, the diffraction flag of ophPointCloud.
+	* @return Type: <B>bool</B>\n
+	*				If the function succeeds, the return value is <B>true</B>.
+	*/
+	virtual bool prepareTiles(uint /*flag*/) { return false; }
+
+	/**
+	* @brief Accumulate the contribution of the work units [begin, end) into complex_H on the CPU.
+	* @param[in] begin First work unit.
+	* @param[in] end One past the last work unit.
+	* @return Type: <B>bool</B>\n
+	*				If the function succeeds, the return value is <B>true</B>.
+	* @see prepareTiles
+	*/
+	virtual bool generateTiles(uint /*begin*/, uint /*end*/) { return false; }
+
 
 
 protected:
@@ -549,6 +666,85 @@ protected:
 	virtual void ophFree(void);
 };
 
+/**
+* @ingroup gen
+* @brief	Circular 2D convolution with a cached operand spectrum
+* @details	setOperand() transforms a fixed operand once, after which every execute() costs one forward FFT,
+*			one multiply and one inverse FFT into the caller's buffer. Operands and results are centered
+*			as in ophGen::conv_fft2, and the inverse transform is normalized.
+*			The plans are shared and each OpenMP thread owns its work buffers, so execute() may be called
+*			from inside a parallel region. Threads without a slot of their own, in nested or larger teams,
+*			allocate temporary buffers for the call.
+*/
+class GEN_DLL ophConvolution
+{
+public:
+	/**
+	* @brief Constructor
+	*/
+	explicit ophConvolution(void);
+
+	/**
+	* @brief Destructor
+	*/
+	~ophConvolution(void);
+
+	/**
+	* @brief Create the plans for the convolution size.
+	* @details Does nothing if the size is unchanged, so the cached operand is kept.
+	*			A different size releases the plans, the buffers and the cached operand.
+	* @param[in] size Matrix size.
+	* @return Type: <B>bool</B>\n
+	*				If the function succeeds, the return value is <B>true</B>.
+	*/
+	bool init(ivec2 size);
+
+	/**
+	* @brief Transform and cache the fixed operand.
+	* @param[in] src Operand of init() size.
+	*/
+	void setOperand(Complex<Real>* src);
+
+	/**
+	* @brief dst = scale * (src * operand), where * is the circular convolution.
+	* @param[in] src Input matrix.
+	* @param[out] dst Output matrix, may be the same as src.
+	* @param[in] scale Complex factor applied to the result.
+	*/
+	void execute(Complex<Real>* src, Complex<Real>* dst, Complex<Real> scale = Complex<Real>(1, 0));
+
+	/**
+	* @brief dst = scale * (src1 * src2) without the cached operand.
+	* @param[in] src1 Convolution matrix 1.
+	* @param[in] src2 Convolution matrix 2.
+	* @param[out] dst Output matrix, may be the same as src1 or src2.
+	* @param[in] scale Complex factor applied to the result.
+	*/
+	void execute(Complex<Real>* src1, Complex<Real>* src2, Complex<Real>* dst, Complex<Real> scale = Complex<Real>(1, 0));
+
+	bool hasOperand(void) { return m_bOperand; }
+	const ivec2& getSize(void) { return m_vecSize; }
+
+	/**
+	* @brief Destroy the plans and free the buffers.
+	*/
+	void release(void);
+
+private:
+	int getSlot(bool& bConcurrent);
+	fftw_complex* getWork(int idx);
+	void transform(Complex<Real>* src, fftw_complex* buf, bool bConcurrent);
+	void inverse(fftw_complex* buf, Complex<Real>* dst, bool bConcurrent);
+
+	ivec2 m_vecSize;
+	long long int m_nSize;
+	fftw_plan m_planFwd, m_planBwd;				/// multi-threaded plans
+	fftw_plan m_planFwdST, m_planBwdST;			/// single-threaded plans for concurrent callers
+	fftw_complex* m_pOperand;					/// uncentered spectrum of the operand
+	std::vector<fftw_complex*> m_vecWork;		/// two work buffers per thread
+	bool m_bOperand;
+};
+
 /**
 * @struct OphPointCloudConfig
 * @brief Configuration for Point Cloud
@@ -609,6 +805,8 @@ struct GEN_DLL OphPointCloudData {
 * @param unsigned int default value of the depth quantization - 256
 * @param unsigned int depth level of input depthmap.
 * @param bool If true, random phase is imposed on each depth layer.
+* @param bool If true, the depth levels are placed from the depth histogram.
+* @param Real RMS depth error bound of the adaptive quantization, 0 to use num_of_depth levels.
 */
 struct GEN_DLL OphDepthMapConfig {
 	/// fieldLength variable for viewing window.
@@ -633,9 +831,15 @@ struct GEN_DLL OphDepthMapConfig {
 	uint				num_of_depth_quantization;
 	/// If true, random phase is imposed on each depth layer.
 	bool				random_phase;
+	/// If true, place at most num_of_depth levels from the depth histogram (Lloyd-Max) instead of uniformly.
+	bool				adaptive_depth_quantization;
+	/// RMS depth error bound of the adaptive quantization in meters.@n
+	/// if > 0, the fewest levels meeting the bound are used, up to num_of_depth.
+	Real				adaptive_depth_error;
 
 	OphDepthMapConfig() :fieldLength(0.0), near_depthmap(0.0), far_depthmap(0.0), num_of_depth(0), change_depth_quantization(false)
-	, default_depth_quantization(0), num_of_depth_quantization(0), random_phase(false) {}
+	, default_depth_quantization(0), num_of_depth_quantization(0), random_phase(false)
+	, adaptive_depth_quantization(false), adaptive_depth_error(0.0) {}
 };
 
 /**
@@ -646,7 +850,13 @@ struct GEN_DLL OphMeshData {
 	/// The number of faces in object
 	ulonglong n_faces = 0;
 	Face* faces;
-	OphMeshData() : faces(nullptr) { n_faces = 0; }
+	/// The number of shared vertices
+	ulonglong n_vertices = 0;
+	/// Shared vertex positions, x, y, z per vertex
+	Real* vertices;
+	/// Vertex indices of the faces, 3 per face
+	uint* indices;
+	OphMeshData() : faces(nullptr), vertices(nullptr), indices(nullptr) { n_faces = 0; n_vertices = 0; }
 };
 
 /**
@@ -82,7 +82,7 @@ Real ophIFTA::generateHologram()
 
 		for (uint ch = 0; ch < nWave; ch++) {
 			uchar *img = new uchar[pnXY];
-			separateColor(ch, pnX, pnY, imgRGB, img);
+			memcpy(img, imgRGB + pnXY * ch, pnXY);
 #ifdef _OPENMP
 #pragma omp parallel for
 #endif
@@ -378,15 +378,24 @@ bool ophIFTA::readImage(const char* fname, bool bRGB)
 			delete[] imgIFTA;
 			imgIFTA = nullptr;
 		}
-		uchar *imgTmp = loadAsImg(fname);
-		imgIFTA = new uchar[pnX * pnY * bytesperpixel];
-		memset(imgIFTA, 0, pnX * pnY * bytesperpixel);
-		imgScaleBilinear(imgTmp, imgIFTA, width, height, pnX, pnY, bytesperpixel);
-
-		delete[] imgTmp;
-
-		if (bRGB) imgRGB = imgIFTA;
-		else imgDepth = imgIFTA;
+		// R, G and B planes for the color image, wavelength ch reading plane ch as separateColor did,
+		// and one gray plane for the depth image.
+		const int nPlane = bRGB ? 3 : 1;
+		const long long int pnXY = pnX * pnY;
+		imgIFTA = new uchar[pnXY * nPlane];
+		vector<uchar *> planes;
+		for (int i = 0; i < nPlane; i++)
+			planes.push_back(imgIFTA + pnXY * i);
+		ret = loadAsImgResampled(fname, planes.data(), nPlane, pnX, pnY, false);
+
+		if (bRGB) {
+			if (imgRGB) delete[] imgRGB;
+			imgRGB = imgIFTA;
+		}
+		else {
+			if (imgDepth) delete[] imgDepth;
+			imgDepth = imgIFTA;
+		}
 	}
 	return ret;
 }
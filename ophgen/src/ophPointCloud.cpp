@@ -52,6 +52,7 @@ ophPointCloud::ophPointCloud(void)
 	: ophGen()
 	, is_ViewingWindow(false)
 	, m_nProgress(0)
+	, m_nTileFlag(PC_DIFF_RS)
 {
 	LOG("*** POINT CLOUD : BUILD DATE: %s %s ***\n\n", __DATE__, __TIME__);
 }
@@ -60,6 +61,7 @@ ophPointCloud::ophPointCloud(const char* pc_file, const char* cfg_file)
 	: ophGen()
 	, is_ViewingWindow(false)
 	, m_nProgress(0)
+	, m_nTileFlag(PC_DIFF_RS)
 {
 	LOG("*** POINT CLOUD : BUILD DATE: %s %s ***\n\n", __DATE__, __TIME__);
 	if (loadPointCloud(pc_file) == -1) LOG("<FAILED> Load point cloud data file(\'%s\')", pc_file);
@@ -250,6 +252,28 @@ void ophPointCloud::encoding(unsigned int ENCODE_FLAG, unsigned int SSB_PASSBAND
 	else if (ENCODE_FLAG == ENCODE_OFFSSB) ophGen::encoding(ENCODE_FLAG, SSB_PASSBAND);
 }
 
+bool ophPointCloud::prepareTiles(uint flag)
+{
+	if (flag != PC_DIFF_RS && flag != PC_DIFF_FRESNEL) {
+		LOG("<FAILED> Wrong parameters.");
+		return false;
+	}
+	m_nTileFlag = flag;
+	resetBuffer();
+	return true;
+}
+
+bool ophPointCloud::generateTiles(uint begin, uint end)
+{
+	if (end <= begin || end > (uint)context_.pixel_number[_Y])
+		return false;
+
+	m_vecTileRow = ivec2(begin, end);
+	genCghPointCloudCPU(m_nTileFlag);
+	m_vecTileRow = ivec2(0, 0);
+	return true;
+}
+
 void ophPointCloud::genCghPointCloudCPU(uint diff_flag)
 {
 	auto begin = CUR_TIME;
@@ -671,6 +671,22 @@ public:
 	* @return pointer of percent
 	*/
 	uint* getProgress() { return &m_nProgress; }		
+
+	/**
+	* @brief Tile-distributed generation splits the hologram into rows.
+	* @see ophDistributed
+	*/
+	virtual uint getTileUnits(void) { return context_.pixel_number[_Y]; }
+	virtual bool isTileRows(void) { return true; }
+	/**
+	* @brief Prepare tile-distributed generation.
+	* @param[in] flag Diffraction flag, PC_DIFF_RS or PC_DIFF_FRESNEL.
+	*/
+	virtual bool prepareTiles(uint flag);
+	/**
+	* @brief Diffract every point into the hologram rows [begin, end) on the CPU.
+	*/
+	virtual bool generateTiles(uint begin, uint end);
 private:
 	/**
 	* @brief Calculate Integral Fringe Pattern of 3D Point Cloud based Computer Generated Holography
@@ -691,6 +707,7 @@ private:
 
 	bool is_ViewingWindow;
 	uint m_nProgress;
+	uint m_nTileFlag;
 	OphPointCloudConfig pc_config_;
 	OphPointCloudData	pc_data_;
 };
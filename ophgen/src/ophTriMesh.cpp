@@ -47,6 +47,11 @@
 #include "tinyxml2.h"
 #include "PLYparser.h"
 #include "sys.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <algorithm>
 
 #define _X1 0
 #define _Y1 1
@@ -65,14 +70,19 @@ ophTri::ophTri(void)
 	, na(nullptr)
 	, nv(nullptr)
 	, angularSpectrum(nullptr)
-	, refAS(nullptr)
 	, rearAS(nullptr)
-	, convol(nullptr)
 	, phaseTerm(nullptr)
 	, is_ViewingWindow(false)
+	, m_bFaceParallel(false)
+	, m_dCullThreshold(0)
+	, m_dSlabThickness(0)
+	, m_dPointLOD(0)
+	, m_dTableRange(0)
+	, m_nTableResolution(32)
+	, m_dTableStep(0)
 	, meshData(nullptr)
-	, tempFreqTermX(nullptr)
-	, tempFreqTermY(nullptr)
+	, textFFT(nullptr)
+	, triMeshArray(nullptr)
 	, streamTriMesh(nullptr)
 	, angularSpectrum_GPU(nullptr)
 	, ffttemp(nullptr)
@@ -91,14 +101,18 @@ bool ophTri::loadMeshData(const char* fileName, const char* ext)
 
 	if (meshData != nullptr)
 	{
+		delete[] meshData->faces;
+		delete[] meshData->vertices;
+		delete[] meshData->indices;
 		delete meshData;
 	}
 
 	meshData = new OphMeshData;
+	triMeshArray = nullptr;
 
 	if (!strcmp(ext, "ply")) {
 		PLYparser meshPLY;
-		if (meshPLY.loadPLY(fileName, meshData->n_faces, &meshData->faces))
+		if (meshPLY.loadPLY(fileName, meshData->n_vertices, &meshData->vertices, meshData->n_faces, &meshData->indices))
 			cout << "Mesh Data Load Finished.." << endl;
 		else
 		{
@@ -111,12 +125,35 @@ bool ophTri::loadMeshData(const char* fileName, const char* ext)
 		return false;
 	}
 
-	triMeshArray = meshData->faces;
-
-	LOG("%s : %.5lf (sec)\n", __FUNCTION__, ELAPSED_TIME(begin, CUR_TIME));
+	LOG("%s : %llu faces, %llu vertices, %.5lf (sec)\n", __FUNCTION__,
+		meshData->n_faces, meshData->n_vertices, ELAPSED_TIME(begin, CUR_TIME));
 	return true;
 }
 
+Face* ophTri::getMeshData()
+{
+	if (triMeshArray == nullptr && meshData != nullptr && meshData->indices != nullptr)
+	{
+		const int N = (int)meshData->n_faces;
+		const Real* vertices = meshData->vertices;
+		const uint* indices = meshData->indices;
+		meshData->faces = new Face[N];
+		memset(meshData->faces, 0, sizeof(Face) * N);
+		Face* faces = meshData->faces;
+
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+		for (int i = 0; i < N; i++) {
+			faces[i].idx = i;
+			for (int k = 0; k < 3; k++)
+				memcpy(faces[i].vertices[k].point.pos, &vertices[indices[i * 3 + k] * 3], sizeof(Point));
+		}
+		triMeshArray = faces;
+	}
+	return triMeshArray;
+}
+
 bool ophTri::readConfig(const char* fname)
 {
 	if (!ophGen::readConfig(fname))
@@ -209,6 +246,23 @@ bool ophTri::readConfig(const char* fname)
 		LOG("<FAILED> Not found node : \'%s\' (Boolean) \n", szNodeName);
 		bRet = false;
 	}
+	// optional
+	next = xml_node->FirstChildElement("SpectralCulling");
+	if (!next || XML_SUCCESS != next->QueryDoubleText(&m_dCullThreshold))
+		m_dCullThreshold = 0;
+	next = xml_node->FirstChildElement("OcclusionSlab");
+	if (!next || XML_SUCCESS != next->QueryDoubleText(&m_dSlabThickness))
+		m_dSlabThickness = 0;
+	next = xml_node->FirstChildElement("PointLOD");
+	if (!next || XML_SUCCESS != next->QueryDoubleText(&m_dPointLOD))
+		m_dPointLOD = 0;
+	next = xml_node->FirstChildElement("SpectrumTableRange");
+	if (!next || XML_SUCCESS != next->QueryDoubleText(&m_dTableRange))
+		m_dTableRange = 0;
+	next = xml_node->FirstChildElement("SpectrumTableResolution");
+	if (!next || XML_SUCCESS != next->QueryIntText(&m_nTableResolution))
+		m_nTableResolution = 32;
+
 	if (textureMapping == true)
 	{
 		sprintf(szNodeName, "TextureSizeX");
@@ -245,10 +299,6 @@ bool ophTri::readConfig(const char* fname)
 
 void ophTri::loadTexturePattern(const char* fileName, const char* ext)
 {
-	int N = context_.pixel_number[_X] * context_.pixel_number[_Y];
-
-	if (tempFreqTermX != nullptr) delete[] tempFreqTermX;
-	if (tempFreqTermY != nullptr) delete[] tempFreqTermY;
 	if (texture.pattern != nullptr) delete[] texture.pattern;
 	if (textFFT != nullptr) delete[] textFFT;
 
@@ -267,10 +317,6 @@ void ophTri::loadTexturePattern(const char* fileName, const char* ext)
 	fft2(texture.dim, texture.pattern, OPH_FORWARD, OPH_ESTIMATE);
 	fftExecute(texture.pattern);
 	fft2(texture.pattern, textFFT, texture.dim[_X], texture.dim[_Y], OPH_FORWARD);
-
-
-	tempFreqTermX = new Real[N];
-	tempFreqTermY = new Real[N];
 }
 
 void ophTri::initializeAS()
@@ -297,24 +343,26 @@ void ophTri::initializeAS()
 	rearAS = new Complex<Real>[pnXY];
 	memset(rearAS, 0, sizeof(Complex<Real>) * pnXY);
 
-	if (refAS != nullptr) {
-		delete[] refAS;
-	}
-	refAS = new Complex<Real>[pnXY];
-	memset(refAS, 0, sizeof(Complex<Real>) * pnXY);
-
 	if (phaseTerm != nullptr) {
 		delete[] phaseTerm;
 	}
 	phaseTerm = new Complex<Real>[pnXY];
 	memset(phaseTerm, 0, sizeof(Complex<Real>) * pnXY);
 
-
-	if (convol != nullptr) {
-		delete[] convol;
+	// the random phase pattern is the same for every face, so its spectrum is computed once.
+	// init keeps the plans and buffers while the hologram size is unchanged.
+	m_conv.init(context_.pixel_number);
+	if (randPhase) {
+		Real PI2 = M_PI * 2;
+#ifdef _OPENMP
+#pragma omp parallel for firstprivate(PI2)
+#endif
+		for (int i = 0; i < pnXY; i++) {
+			Complex<Real> phase(0, PI2 * rand(0.0, 1.0, i));
+			phaseTerm[i] = exp(phase);
+		}
+		m_conv.setOperand(phaseTerm);
 	}
-	convol = new Complex<Real>[pnXY];
-	memset(convol, 0, sizeof(Complex<Real>) * pnXY);
 
 
 	if (no != nullptr) {
@@ -341,8 +389,9 @@ void ophTri::initializeAS()
 void ophTri::objSort(bool isAscending)
 {
 	auto begin = CUR_TIME;
-	int N = meshData->n_faces;
-	Real* centerZ = new Real[N];
+	const int N = meshData->n_faces;
+	vector<Real> centerZ(N);
+	vector<int> order(N);
 
 #ifdef _OPENMP
 #pragma omp parallel for
@@ -352,60 +401,33 @@ void ophTri::objSort(bool isAscending)
 			scaledMeshData[i].vertices[_FIRST].point.pos[_Z] + 
 			scaledMeshData[i].vertices[_SECOND].point.pos[_Z] + 
 			scaledMeshData[i].vertices[_THIRD].point.pos[_Z]) / 3;
+		order[i] = i;
 	}
-	
-	bool bSwap = false;
 
-	Face tmp;
+	// stable, so faces at the same depth keep the file order for any number of threads.
+	const Real* z = centerZ.data();
 	if (isAscending)
-	{
-		while (true)
-		{
-			for (int i = 0; i < N - 1; i++)
-			{
-				bSwap = false;
-				int j = i + 1;
-				if (centerZ[i] > centerZ[j]) {
-					Real tmpZ = centerZ[i];
-					centerZ[i] = centerZ[j];
-					centerZ[j] = tmpZ;
-
-					tmp = scaledMeshData[i];
-					scaledMeshData[i] = scaledMeshData[j];
-					scaledMeshData[j] = tmp;
-					bSwap = true;
-				}
-			}
-			if (!bSwap)
-				break;
-		}
-	}
+		parallelSort(order.begin(), order.end(), [z](int a, int b) { return z[a] < z[b]; });
 	else
-	{
-		while (true)
-		{
-			for (int i = 0; i < N - 1; i++)
-			{
-				bSwap = false;
-				int j = i + 1;
-				if (centerZ[i] < centerZ[j]) {
-					Real tmpZ = centerZ[i];
-					centerZ[i] = centerZ[j];
-					centerZ[j] = tmpZ;
-
-					tmp = scaledMeshData[i];
-					scaledMeshData[i] = scaledMeshData[j];
-					scaledMeshData[j] = tmp;
-					bSwap = true;
-				}
-			}
-			if (!bSwap)
-				break;
-		}
+		parallelSort(order.begin(), order.end(), [z](int a, int b) { return z[a] > z[b]; });
+
+	// one gather of the faces and their vertex indices instead of swapping faces.
+	Face* sorted = new Face[N];
+	vector<uint> sortedVertex(m_vecFaceVertex.size());
+	const bool bIndexed = !sortedVertex.empty();
+#ifdef _OPENMP
+#pragma omp parallel for firstprivate(bIndexed)
+#endif
+	for (int i = 0; i < N; i++) {
+		sorted[i] = scaledMeshData[order[i]];
+		if (bIndexed)
+			memcpy(&sortedVertex[i * 3], &m_vecFaceVertex[order[i] * 3], sizeof(uint) * 3);
 	}
-	delete[] centerZ;
+	delete[] scaledMeshData;
+	scaledMeshData = sorted;
+	m_vecFaceVertex.swap(sortedVertex);
+
 	LOG("<END> %s : %.5lf (sec)\n", __FUNCTION__, ELAPSED_TIME(begin, CUR_TIME));
-	
 }
 
 vec3 vecCross(const vec3& a, const vec3& b)
@@ -424,30 +446,45 @@ vec3 vecCross(const vec3& a, const vec3& b)
 
 void ophTri::triTimeMultiplexing(char* dirName, uint ENCODE_METHOD, Real cenFx, Real cenFy, Real rangeFx, Real rangeFy, Real stepFx, Real stepFy)
 {
+	auto begin = CUR_TIME;
 	TM = true;
-	char strFxFy[30];
-	Complex<Real>* AS = new Complex<Real>[context_.pixel_number[_X] * context_.pixel_number[_Y]];
+
+	const long long int pnXY = context_.pixel_number[_X] * context_.pixel_number[_Y];
+	const uint nChannel = context_.waveNum;
+	const Real lambda0 = context_.wave_length[0];
 
 	int nFx = floor(rangeFx / stepFx);
 	int nFy = floor(rangeFy / stepFy);
-	Real tFx, tFy, tFz;
+	vector<vec3> carrier;
 	for (int iFy = 0; iFy <= nFy; iFy++) {
 		for (int iFx = 0; iFx <= nFx; iFx++) {
+			Real tFx = cenFx - rangeFx / 2 + iFx*stepFx;
+			Real tFy = cenFy - rangeFy / 2 + iFy*stepFy;
+			Real tFz = sqrt(1.0 / lambda0 / lambda0 - tFx*tFx - tFy*tFy);
+			carrier.push_back(vec3(tFx, tFy, tFz));
+		}
+	}
+	const int nCarrier = (int)carrier.size();
+	if (nCarrier == 0)
+		return;
 
-			tFx = cenFx - rangeFx / 2 + iFx*stepFx;
-			tFy = cenFy - rangeFy / 2 + iFy*stepFy;
-			tFz = sqrt(1.0 / context_.wave_length[0] / context_.wave_length[0] - tFx*tFx - tFy*tFy);
-
-			carrierWave[_X] = tFx*context_.wave_length[0];
-			carrierWave[_Y] = tFy*context_.wave_length[0];
-			carrierWave[_Z] = tFz*context_.wave_length[0];
+	char strFxFy[FILENAME_MAX];
+	if (m_mode & MODE_GPU)
+	{
+		// the face cache below is a CPU structure; the GPU generates each carrier in full.
+		for (int i = 0; i < nCarrier; i++)
+		{
+			const vec3& t = carrier[i];
+			carrierWave[_X] = t[_X] * lambda0;
+			carrierWave[_Y] = t[_Y] * lambda0;
+			carrierWave[_Z] = t[_Z] * lambda0;
 
 			generateHologram(SHADING_FLAT);
 
 			setEncodeMethod(ENCODE_METHOD);
 			ophGen::encoding();
 			normalize();
-			sprintf(strFxFy, "%s/holo_%d,%d.bmp", dirName, (int)tFx, (int)tFy);
+			sprintf(strFxFy, "%s/holo_%d,%d.bmp", dirName, (int)t[_X], (int)t[_Y]);
 			save(strFxFy, 8, nullptr, m_vecEncodeSize[_X], m_vecEncodeSize[_Y]);
 
 			fft2(context_.pixel_number, complex_H[0], OPH_FORWARD);
@@ -456,10 +493,162 @@ void ophTri::triTimeMultiplexing(char* dirName, uint ENCODE_METHOD, Real cenFx,
 			setEncodeMethod(ENCODE_AMPLITUDE);
 			ophGen::encoding();
 			normalize();
-			sprintf(strFxFy, "%s/AS_%d,%d.bmp", dirName, (int)tFx, (int)tFy);
+			sprintf(strFxFy, "%s/AS_%d,%d.bmp", dirName, (int)t[_X], (int)t[_Y]);
 			save(strFxFy, 8, nullptr, m_vecEncodeSize[_X], m_vecEncodeSize[_Y]);
 		}
+		LOG("<END> %s : %d carriers, %.5lf (sec)\n", __FUNCTION__, nCarrier, ELAPSED_TIME(begin, CUR_TIME));
+		return;
 	}
+
+	// the mesh pipeline up to the face geometry does not depend on the carrier, so it runs once.
+	resetBuffer();
+	initializeAS();
+	prepareMeshData();
+	objSort(false);
+	findNormals(SHADING_FLAT);
+	buildFaceCache();
+	const int N = (int)m_vecFaceIdx.size();
+
+	vector<Point*> freq(nChannel);
+	for (uint ch = 0; ch < nChannel; ch++)
+	{
+		freq[ch] = new Point[pnXY];
+		calGlobalFrequency(freq[ch], context_.wave_length[ch]);
+	}
+
+#ifdef _OPENMP
+	const int nWorker = occlusion ? 1 : (std::min)(omp_get_max_threads(), nCarrier);
+#else
+	const int nWorker = 1;
+#endif
+	vector<TriWork> work(nWorker);
+	vector<Complex<Real>*> field(nWorker * nChannel);
+	for (int w = 0; w < nWorker; w++)
+	{
+		allocWork(work[w], false);
+		for (uint ch = 0; ch < nChannel; ch++)
+			field[w * nChannel + ch] = new Complex<Real>[pnXY];
+	}
+
+	// a saver thread writes the images while the next carriers are computed.
+	struct SaveJob { std::string path; uchar* src; ivec2 size; };
+	std::deque<SaveJob> jobs;
+	std::mutex mtx;
+	std::condition_variable cv;
+	bool bFinish = false;
+	const size_t nMaxJob = 2 * nWorker + 2;
+
+	std::thread saver([&]() {
+		while (true)
+		{
+			SaveJob job;
+			{
+				std::unique_lock<std::mutex> lock(mtx);
+				cv.wait(lock, [&]() { return bFinish || !jobs.empty(); });
+				if (jobs.empty())
+					break;
+				job = jobs.front();
+				jobs.pop_front();
+			}
+			cv.notify_all();
+			saveAsImg(job.path.c_str(), 8, job.src, job.size[_X], job.size[_Y]);
+			delete[] job.src;
+		}
+	});
+
+	auto queueSave = [&](const char* path) {
+		// the merged or per-channel color output goes through the synchronous save.
+		if (nChannel != 1) {
+			save(path, 8, nullptr, m_vecEncodeSize[_X], m_vecEncodeSize[_Y]);
+			return;
+		}
+		const long long int nSize = (long long int)m_vecEncodeSize[_X] * m_vecEncodeSize[_Y];
+		SaveJob job = { path, new uchar[nSize], m_vecEncodeSize };
+		memcpy(job.src, m_lpNormalized[0], nSize);
+
+		std::unique_lock<std::mutex> lock(mtx);
+		cv.wait(lock, [&]() { return jobs.size() < nMaxJob; });
+		jobs.push_back(job);
+		lock.unlock();
+		cv.notify_all();
+	};
+
+	for (int base = 0; base < nCarrier; base += nWorker)
+	{
+		const int nBatch = (std::min)(nWorker, nCarrier - base);
+
+		// one carrier per thread; the per-pixel loops of each face run serially inside.
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(nBatch) schedule(static, 1)
+#endif
+		for (int b = 0; b < nBatch; b++)
+		{
+			TriWork& w = work[b];
+			w.carrier[_X] = carrier[base + b][_X] * lambda0;
+			w.carrier[_Y] = carrier[base + b][_Y] * lambda0;
+			w.carrier[_Z] = carrier[base + b][_Z] * lambda0;
+
+			for (uint ch = 0; ch < nChannel; ch++)
+			{
+				Complex<Real>* dst = field[b * nChannel + ch];
+				memset(dst, 0, sizeof(Complex<Real>) * pnXY);
+				calPointAS(SHADING_FLAT, freq[ch], context_.wave_length[ch], w.carrier, dst);
+				if (occlusion && !isFaceOcclusion()) {
+					generateSlabAS(SHADING_FLAT, freq[ch], context_.wave_length[ch], dst, w);
+					continue;
+				}
+				for (int j = 0; j < N; j++)
+					calFaceAS(j, SHADING_FLAT, freq[ch], context_.wave_length[ch], dst, w);
+			}
+		}
+
+		for (int b = 0; b < nBatch; b++)
+		{
+			const vec3& t = carrier[base + b];
+			for (uint ch = 0; ch < nChannel; ch++)
+				memcpy(complex_H[ch], field[b * nChannel + ch], sizeof(Complex<Real>) * pnXY);
+
+			setEncodeMethod(ENCODE_METHOD);
+			ophGen::encoding();
+			normalize();
+			sprintf(strFxFy, "%s/holo_%d,%d.bmp", dirName, (int)t[_X], (int)t[_Y]);
+			queueSave(strFxFy);
+
+			fft2(context_.pixel_number, complex_H[0], OPH_FORWARD);
+			fft2(complex_H[0], complex_H[0], context_.pixel_number[_X], context_.pixel_number[_Y], OPH_FORWARD);
+
+			setEncodeMethod(ENCODE_AMPLITUDE);
+			ophGen::encoding();
+			normalize();
+			sprintf(strFxFy, "%s/AS_%d,%d.bmp", dirName, (int)t[_X], (int)t[_Y]);
+			queueSave(strFxFy);
+
+			m_nProgress = (int)((Real)(base + b + 1) * 100 / nCarrier);
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		bFinish = true;
+	}
+	cv.notify_all();
+	saver.join();
+
+	const vec3& last = carrier[nCarrier - 1];
+	carrierWave[_X] = last[_X] * lambda0;
+	carrierWave[_Y] = last[_Y] * lambda0;
+	carrierWave[_Z] = last[_Z] * lambda0;
+
+	for (int w = 0; w < nWorker; w++)
+		releaseWork(work[w]);
+	for (size_t i = 0; i < field.size(); i++)
+		delete[] field[i];
+	for (uint ch = 0; ch < nChannel; ch++)
+		delete[] freq[ch];
+	releaseFaceCache();
+
+	m_nProgress = 0;
+	LOG("<END> %s : %d carriers, %.5lf (sec)\n", __FUNCTION__, nCarrier, ELAPSED_TIME(begin, CUR_TIME));
 }
 
 Real ophTri::generateHologram(uint SHADING_FLAG)
@@ -528,86 +717,384 @@ bool ophTri::generateAS(uint SHADING_FLAG)
 	auto begin = CUR_TIME;
 
 	const long long int pnXY = context_.pixel_number[_X] * context_.pixel_number[_Y];
-	int N = meshData->n_faces;
 
-	Point* freq = new Point[pnXY];
-	Point* fl = new Point[pnXY];
-	Real *freqTermX = new Real[pnXY];
-	Real *freqTermY = new Real[pnXY];
+	if (SHADING_FLAG != SHADING_FLAT && SHADING_FLAG != SHADING_CONTINUOUS) {
+		LOG("<FAILED> WRONG SHADING_FLAG\n");
+		return false;
+	}
 
 	findNormals(SHADING_FLAG);
+	buildFaceCache();
+	int N = (int)m_vecFaceIdx.size();
+
+#ifdef _OPENMP
+	const int nWorker = (m_bFaceParallel && !occlusion) ? (std::min)(omp_get_max_threads(), (std::max)(N, 1)) : 1;
+#else
+	const int nWorker = 1;
+#endif
+	if (m_bFaceParallel && occlusion)
+		LOG("Face-parallel mode is not used with occlusion.\n");
+
+	Point* freq = new Point[pnXY];
+	vector<TriWork> work(nWorker);
 
+	int nDone = 0;
 	for (uint ch = 0; ch < context_.waveNum; ch++)
 	{
-		calGlobalFrequency(freq, context_.wave_length[ch]);		
+		Real lambda = context_.wave_length[ch];
+		calGlobalFrequency(freq, lambda);
+		calPointAS(SHADING_FLAG, freq, lambda, carrierWave, complex_H[ch]);
 
-		for (int j = 0; j < N; j++)
+		if (nWorker == 1)
 		{
-			Face mesh = scaledMeshData[j];
+			if (work[0].fl == nullptr) {
+				allocWork(work[0], false);
+				memcpy(work[0].carrier, carrierWave, sizeof(carrierWave));
+			}
 
-			geometric geom;// = { 0, };
-			//memcpy((void *)&mesh, &scaledMeshData[9 * j], sizeof(Real) * 9);
-			
-			if (!checkValidity(no[j])) // don't care
-				continue;
-			if (!findGeometricalRelations(mesh, no[j], geom))
-				continue;
-			if (!calFrequencyTerm(freq, fl, freqTermX, freqTermY, geom, context_.wave_length[ch]))
+			if (occlusion && !isFaceOcclusion())
+			{
+				generateSlabAS(SHADING_FLAG, freq, lambda, complex_H[ch], work[0]);
+				m_nProgress = ((Real)(ch + 1) / (Real)context_.waveNum) * 100;
 				continue;
+			}
 
-			switch (SHADING_FLAG)
+			for (int j = 0; j < N; j++)
 			{
-			case SHADING_FLAT:
-				refAS_Flat(no[j], freq, mesh, freqTermX, freqTermY, geom, context_.wave_length[ch]);
-				//refAS_Flat(no[j], freq, mesh, freqTermX, freqTermY, geom);
-				break;
-			case SHADING_CONTINUOUS:
-				refAS_Continuous(j, freqTermX, freqTermY);
-				break;
-			default:
-				LOG("<FAILED> WRONG SHADING_FLAG\n");
-				return false;
+				calFaceAS(j, SHADING_FLAG, freq, lambda, complex_H[ch], work[0]);
+				m_nProgress = ((Real)(ch * N + j) / (Real)(N * context_.waveNum)) * 100;
 			}
-			if (!refToGlobal(complex_H[ch], freq, fl, geom))
-				continue;
+			continue;
+		}
+
+		// every worker takes whole faces into its own accumulator; the per-pixel loops run serially inside.
+#ifdef _OPENMP
+#pragma omp parallel num_threads(nWorker) firstprivate(lambda)
+#endif
+		{
+#ifdef _OPENMP
+			const int tid = omp_get_thread_num();
+#else
+			const int tid = 0;
+#endif
+			TriWork& w = work[tid];
+			if (w.fl == nullptr) {
+				allocWork(w, true);
+				memcpy(w.carrier, carrierWave, sizeof(carrierWave));
+			}
+			memset(w.AS, 0, sizeof(Complex<Real>) * pnXY);
 
-			m_nProgress = ((Real)(ch * N + j) / (Real)(N * context_.waveNum)) * 100;
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic, 16)
+#endif
+			for (int j = 0; j < N; j++)
+			{
+				calFaceAS(j, SHADING_FLAG, freq, lambda, w.AS, w);
+#ifdef _OPENMP
+#pragma omp atomic
+#endif
+				nDone++;
+				m_nProgress = ((Real)nDone / (Real)(N * context_.waveNum)) * 100;
+			}
+		}
 
-			//m_nProgress = (int)((Real)j * 100 / ((Real)N));
+		// reduce the private accumulators into the hologram spectrum.
+		Complex<Real> *H = complex_H[ch];
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+		for (long long int i = 0; i < pnXY; i++)
+		{
+			for (int w = 0; w < nWorker; w++)
+				H[i] += work[w].AS[i];
 		}
 	}
-#if 1
+
+	long long int nSample = 0, nCulled = 0;
+	for (int w = 0; w < nWorker; w++)
+	{
+		nSample += work[w].nSample;
+		nCulled += work[w].nCulled;
+		releaseWork(work[w]);
+	}
+	if (nSample > 0)
+		LOG("Spectral culling : %.2lf %% of %lld face samples skipped\n", (Real)nCulled * 100 / nSample, nSample);
+
 	delete[] freq;
-	delete[] fl;
+	releaseFaceCache();
+
+	LOG("<END> %s : %.5lf (sec)\n", __FUNCTION__, ELAPSED_TIME(begin, CUR_TIME));
+
+	return true;
+}
+
+bool ophTri::calFaceAS(int face, uint SHADING_FLAG, Point* frequency, Real lambda, Complex<Real>* dst, TriWork& work)
+{
+	const int idx = m_vecFaceIdx[face];
+	Face mesh = scaledMeshData[idx];
+	geometric& geom = m_vecFaceGeom[face];
+
+	if (!calFrequencyTerm(frequency, work.fl, work.freqTermX, work.freqTermY, geom, lambda, work.carrier))
+		return false;
+
+	// the culled path needs a spectrum that stays local, so no convolution by random phase or occlusion.
+	if (SHADING_FLAG == SHADING_FLAT && m_dCullThreshold > 0 && !randPhase && !isFaceOcclusion() && !textureMapping)
+		return refAS_FlatCulled(no[idx], frequency, geom, lambda, dst, work);
+
+	if (SHADING_FLAG == SHADING_FLAT)
+		refAS_Flat(no[idx], frequency, mesh, geom, lambda, work);
+	else
+		refAS_Continuous(idx, work);
+
+	return refToGlobal(dst, work.refAS, frequency, work.fl, geom);
+}
+
+bool ophTri::generateSlabAS(uint SHADING_FLAG, Point* frequency, Real lambda, Complex<Real>* dst, TriWork& work)
+{
+	auto begin = CUR_TIME;
+	const int pnX = context_.pixel_number[_X];
+	const int pnY = context_.pixel_number[_Y];
+	const long long int pnXY = pnX * pnY;
+	const int hX = pnX >> 1;
+	const int hY = pnY >> 1;
+	const int N = (int)m_vecFaceIdx.size();
+	const Real PI2 = M_PI * 2;
+	const Real norm = 1.0 / pnXY;
+
+	fftw_complex* buf = (fftw_complex *)fftw_malloc(sizeof(fftw_complex) * pnXY);
+	Complex<Real>* field = reinterpret_cast<Complex<Real> *>(buf);
+	fftw_plan toSpace = fftw_plan_dft_2d(pnY, pnX, buf, buf, OPH_BACKWARD, OPH_ESTIMATE);
+	fftw_plan toFreq = fftw_plan_dft_2d(pnY, pnX, buf, buf, OPH_FORWARD, OPH_ESTIMATE);
+	uchar* mask = new uchar[pnXY];
+
+	int nSlab = 0;
+	int first = 0;
+	while (first < N)
+	{
+		// the faces are sorted back to front; a slab collects the faces within its thickness.
+		Real zBack = 0, zFront = 0;
+		int last = first;
+		for (; last < N; last++)
+		{
+			const Face& f = scaledMeshData[m_vecFaceIdx[last]];
+			Real z = (f.vertices[_FIRST].point.pos[_Z] + f.vertices[_SECOND].point.pos[_Z] + f.vertices[_THIRD].point.pos[_Z]) / 3;
+			if (last == first)
+				zBack = z;
+			else if (zBack - z > m_dSlabThickness)
+				break;
+			zFront = z;
+		}
+		const Real zSlab = (zBack + zFront) / 2;
+
+		// silhouette method: remove the field behind the slab where its faces cover it.
+		if (first > 0 && rasterizeSilhouette(first, last, mask))
+		{
+			// back to the slab plane, in the unshifted order of the FFT.
+#ifdef _OPENMP
+#pragma omp parallel for firstprivate(pnX, pnY, hX, hY, zSlab, PI2)
+#endif
+			for (int r = 0; r < pnY; r++)
+			{
+				const long long int row = (long long int)((r + hY) % pnY) * pnX;
+				for (int c = 0; c < pnX; c++)
+				{
+					const long long int i = row + (c + hX) % pnX;
+					Complex<Real> prop(0, PI2 * frequency[i].pos[_Z] * zSlab);
+					field[(long long int)r * pnX + c] = dst[i] * prop.exp();
+				}
+			}
+			fftw_execute(toSpace);
+
+#ifdef _OPENMP
+#pragma omp parallel for firstprivate(pnX, pnY, hX, hY)
+#endif
+			for (int r = 0; r < pnY; r++)
+			{
+				const long long int row = (long long int)((r + hY) % pnY) * pnX;
+				for (int c = 0; c < pnX; c++)
+				{
+					if (!mask[row + (c + hX) % pnX])
+						field[(long long int)r * pnX + c] = 0;
+				}
+			}
+			fftw_execute(toFreq);
+
+			// the masked field goes back to the hologram plane and is taken out of the spectrum.
+#ifdef _OPENMP
+#pragma omp parallel for firstprivate(pnX, pnY, hX, hY, zSlab, PI2, norm)
+#endif
+			for (int r = 0; r < pnY; r++)
+			{
+				const long long int row = (long long int)((r + hY) % pnY) * pnX;
+				for (int c = 0; c < pnX; c++)
+				{
+					const long long int i = row + (c + hX) % pnX;
+					Complex<Real> prop(0, -PI2 * frequency[i].pos[_Z] * zSlab);
+					dst[i] -= field[(long long int)r * pnX + c] * prop.exp() * norm;
+				}
+			}
+		}
+
+		for (int j = first; j < last; j++)
+			calFaceAS(j, SHADING_FLAG, frequency, lambda, dst, work);
+
+		first = last;
+		nSlab++;
+	}
+
+	delete[] mask;
+	fftw_destroy_plan(toSpace);
+	fftw_destroy_plan(toFreq);
+	fftw_free(buf);
+
+	LOG("<END> %s : %d faces in %d slabs, %.5lf (sec)\n", __FUNCTION__, N, nSlab, ELAPSED_TIME(begin, CUR_TIME));
+	return true;
+}
+
+bool ophTri::rasterizeSilhouette(int begin, int end, uchar* mask)
+{
+	const int pnX = context_.pixel_number[_X];
+	const int pnY = context_.pixel_number[_Y];
+	const Real ppX = context_.pixel_pitch[_X];
+	const Real ppY = context_.pixel_pitch[_Y];
+	const int hX = pnX >> 1;
+	const int hY = pnY >> 1;
+	bool bCover = false;
+
+	memset(mask, 0, sizeof(uchar) * pnX * pnY);
+	for (int j = begin; j < end; j++)
+	{
+		const Face& f = scaledMeshData[m_vecFaceIdx[j]];
+
+		// orthographic projection on the centered grid of the transform of encoding().
+		Real px[3], py[3];
+		for (int v = 0; v < 3; v++)
+		{
+			px[v] = hX + f.vertices[v].point.pos[_X] / ppX;
+			py[v] = hY - f.vertices[v].point.pos[_Y] / ppY;
+		}
+		Real area = (px[1] - px[0]) * (py[2] - py[0]) - (px[2] - px[0]) * (py[1] - py[0]);
+		if (area == 0) // edge-on
+			continue;
+		const Real sign = area > 0 ? 1 : -1;
+
+		int x0 = (std::max)(0, (int)ceil((std::min)({ px[0], px[1], px[2] })));
+		int x1 = (std::min)(pnX - 1, (int)floor((std::max)({ px[0], px[1], px[2] })));
+		int y0 = (std::max)(0, (int)ceil((std::min)({ py[0], py[1], py[2] })));
+		int y1 = (std::min)(pnY - 1, (int)floor((std::max)({ py[0], py[1], py[2] })));
+
+		for (int y = y0; y <= y1; y++)
+		{
+			for (int x = x0; x <= x1; x++)
+			{
+				// pixel centers on or inside the three edges
+				Real e0 = ((px[2] - px[1]) * (y - py[1]) - (py[2] - py[1]) * (x - px[1])) * sign;
+				Real e1 = ((px[0] - px[2]) * (y - py[2]) - (py[0] - py[2]) * (x - px[2])) * sign;
+				Real e2 = ((px[1] - px[0]) * (y - py[0]) - (py[1] - py[0]) * (x - px[0])) * sign;
+				if (e0 >= 0 && e1 >= 0 && e2 >= 0) {
+					mask[(long long int)y * pnX + x] = 1;
+					bCover = true;
+				}
+			}
+		}
+	}
+	return bCover;
+}
+
+void ophTri::allocWork(TriWork& work, bool bAccumulate)
+{
+	const long long int pnXY = context_.pixel_number[_X] * context_.pixel_number[_Y];
+
+	work.fl = new Point[pnXY];
+	work.freqTermX = new Real[pnXY];
+	work.freqTermY = new Real[pnXY];
+	work.refAS = new Complex<Real>[pnXY];
+	work.convol = new Complex<Real>[pnXY];
+	work.AS = bAccumulate ? new Complex<Real>[pnXY] : nullptr;
+}
+
+void ophTri::releaseWork(TriWork& work)
+{
+	delete[] work.fl;
+	delete[] work.freqTermX;
+	delete[] work.freqTermY;
+	delete[] work.refAS;
+	delete[] work.convol;
+	delete[] work.AS;
+	work = TriWork();
+}
+
+void ophTri::buildFaceCache()
+{
+	const int N = meshData->n_faces;
+
+	// validity, rotation and shift of each face do not depend on the carrier wave or the channel.
+	m_vecFaceIdx.clear();
+	m_vecFaceGeom.clear();
+	m_vecPointIdx.clear();
+	m_vecPointGeom.clear();
+	m_vecFaceIdx.reserve(N);
+	m_vecFaceGeom.reserve(N);
+
+	const bool bLOD = m_dPointLOD > 0 && !randPhase && !occlusion && !textureMapping;
+	const Real ppX = context_.pixel_pitch[_X];
+	const Real ppY = context_.pixel_pitch[_Y];
+
+	// an axial extent dz dephases the band edge as much as a lateral one of lambda fmax^2 dz pixels.
+	Real lambdaMax = 0;
+	for (uint ch = 0; ch < context_.waveNum; ch++)
+		lambdaMax = (std::max)(lambdaMax, context_.wave_length[ch]);
+	const Real axial = lambdaMax * (0.25 / (ppX * ppX) + 0.25 / (ppY * ppY));
+	for (int j = 0; j < N; j++)
+	{
+		geometric geom;
+		if (!checkValidity(no[j])) // don't care
+			continue;
+		if (!findGeometricalRelations(scaledMeshData[j], no[j], geom))
+			continue;
+		if (bLOD)
+		{
+			const Face& f = scaledMeshData[j];
+			const Real x0 = f.vertices[_FIRST].point.pos[_X], x1 = f.vertices[_SECOND].point.pos[_X], x2 = f.vertices[_THIRD].point.pos[_X];
+			const Real y0 = f.vertices[_FIRST].point.pos[_Y], y1 = f.vertices[_SECOND].point.pos[_Y], y2 = f.vertices[_THIRD].point.pos[_Y];
+			Real sizeX = ((std::max)({ x0, x1, x2 }) - (std::min)({ x0, x1, x2 })) / ppX;
+			Real sizeY = ((std::max)({ y0, y1, y2 }) - (std::min)({ y0, y1, y2 })) / ppY;
+			const Real z0 = f.vertices[_FIRST].point.pos[_Z], z1 = f.vertices[_SECOND].point.pos[_Z], z2 = f.vertices[_THIRD].point.pos[_Z];
+			Real sizeZ = ((std::max)({ z0, z1, z2 }) - (std::min)({ z0, z1, z2 })) * axial;
+			if (sizeX < m_dPointLOD && sizeY < m_dPointLOD && sizeZ < m_dPointLOD) {
+				m_vecPointIdx.push_back(j);
+				m_vecPointGeom.push_back(geom);
+				continue;
+			}
+		}
+		m_vecFaceIdx.push_back(j);
+		m_vecFaceGeom.push_back(geom);
+	}
+	if (bLOD)
+		LOG("Point LOD : %d of %d faces collapsed into point sources\n",
+			(int)m_vecPointIdx.size(), (int)(m_vecPointIdx.size() + m_vecFaceIdx.size()));
+
+	buildSpectrumTable();
+}
+
+void ophTri::releaseFaceCache()
+{
 	delete[] scaledMeshData;
-	delete[] freqTermX;
-	delete[] freqTermY;
-	delete[] refAS;
 	delete[] phaseTerm;
-	delete[] convol;
 	delete[] no;
 	delete[] na;
 	delete[] nv;
 	scaledMeshData = nullptr;
-	refAS = nullptr;
-	phaseTerm = nullptr;
-	convol = nullptr;
-#else
-	for (int i = 0; i < 3; i++) {
-		delete[] freq[i];
-		delete[] fl[i];
-	}
-
-	delete[] freq, fl, scaledMeshData, freqTermX, freqTermY, refAS, phaseTerm, convol;
-	scaledMeshData = nullptr;
-	refAS = nullptr;
 	phaseTerm = nullptr;
-	convol = nullptr;
-#endif
-
-	LOG("<END> %s : %.5lf (sec)\n", __FUNCTION__, ELAPSED_TIME(begin, CUR_TIME));
-
-	return true;
+	no = na = nv = nullptr;
+	m_conv.release();
+
+	vector<int>().swap(m_vecFaceIdx);
+	vector<geometric>().swap(m_vecFaceGeom);
+	vector<int>().swap(m_vecPointIdx);
+	vector<geometric>().swap(m_vecPointGeom);
+	vector<Complex<Real>>().swap(m_vecRefTable);
+	vector<uint>().swap(m_vecFaceVertex);
 }
 
 void ophTri::calGlobalFrequency(Point* frequency, Real lambda)
@@ -685,49 +1172,38 @@ bool ophTri::findNormals(uint SHADING_FLAG)
 	}
 
 	if (SHADING_FLAG == SHADING_CONTINUOUS) {
-		vec3* vertices = new vec3[N * 3];
-		vec3 zeros(0, 0, 0);
-		uint N3 = N * 3;
-		for (uint i = 0; i < N3; i++)
-		{
-			int idxFace = i / 3;
-			int idxVertex = i % 3;
-			std::memcpy(&vertices[i], &scaledMeshData[idxFace].vertices[idxVertex].point, sizeof(Point));
-		}
-
-		//for (uint idx = 0; idx < N * 3; idx++) {
-		//	memcpy(&vertices[idx], &scaledMeshData[idx * 3], sizeof(vec3));
-		//}
-		for (uint idx1 = 0; idx1 < N3; idx1++) {
-			if (vertices[idx1] == zeros)
-				continue;
-			vec3 sum = na[idx1 / 3];
-			uint count = 1;
-			uint* idxes = new uint[N3];
-			idxes[0] = idx1;
-			for (uint idx2 = idx1 + 1; idx2 < N3; idx2++) {
-				if (vertices[idx2] == zeros)
-					continue;
-				if ((vertices[idx1][0] == vertices[idx2][0])
-					&& (vertices[idx1][1] == vertices[idx2][1])
-					&& (vertices[idx1][2] == vertices[idx2][2])) {
-
-					sum += na[idx2 / 3];
-					vertices[idx2] = zeros;
-					idxes[count++] = idx2;
-				}
-			}
-			vertices[idx1] = zeros;
-
-			sum = sum / count;
-			sum = sum / norm(sum);
-			for (uint i = 0; i < count; i++)
-				nv[idxes[i]] = sum;
-
-			delete[] idxes;
+		// faces sharing a vertex average their normals there. The adjacency of the shared
+		// vertices is built by a counting sort of the index buffer.
+		const int nVertex = (int)meshData->n_vertices;
+		const int N3 = N * 3;
+		const uint* idx = m_vecFaceVertex.data();
+		vector<int> first(nVertex + 1, 0);
+		vector<int> adjacent(N3);
+		for (int i = 0; i < N3; i++)
+			first[idx[i] + 1]++;
+		for (int v = 0; v < nVertex; v++)
+			first[v + 1] += first[v];
+		vector<int> fill(first.begin(), first.end() - 1);
+		for (int i = 0; i < N3; i++)
+			adjacent[fill[idx[i]]++] = i / 3;
+
+		vector<vec3> normal(nVertex);
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+		for (int v = 0; v < nVertex; v++) {
+			vec3 sum(0, 0, 0);
+			for (int k = first[v]; k < first[v + 1]; k++)
+				sum += na[adjacent[k]];
+			Real len = norm(sum);
+			normal[v] = (len > 0) ? sum / len : sum;
 		}
 
-		delete[] vertices;
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+		for (int i = 0; i < N3; i++)
+			nv[i] = normal[idx[i]];
 	}
 
 	LOG("<END> %s : %.5lf (sec)\n", __FUNCTION__, ELAPSED_TIME(begin, CUR_TIME));
@@ -809,7 +1285,7 @@ bool ophTri::findGeometricalRelations(Face mesh, vec3 no, geometric& geom)
 
 }
 
-bool ophTri::calFrequencyTerm(Point* frequency, Point* fl, Real *freqTermX, Real *freqTermY, geometric& geom, Real lambda)
+bool ophTri::calFrequencyTerm(Point* frequency, Point* fl, Real *freqTermX, Real *freqTermY, geometric& geom, Real lambda, const Real* carrier)
 {
 	// p.s. only 1 channel
 	const long long int pnXY = context_.pixel_number[_X] * context_.pixel_number[_Y];
@@ -829,7 +1305,7 @@ bool ophTri::calFrequencyTerm(Point* frequency, Point* fl, Real *freqTermX, Real
 	Real carrierWaveLoc[3];
 	Real glRot[9];
 	memcpy(glRot, geom.glRot, sizeof(glRot));
-	memcpy(carrierWaveLoc, carrierWave, sizeof(carrierWaveLoc));
+	memcpy(carrierWaveLoc, carrier, sizeof(carrierWaveLoc));
 
 #ifdef _OPENMP
 #pragma omp parallel for firstprivate(w, ww, glRot, carrierWaveLoc, invLoRot)
@@ -891,23 +1367,231 @@ bool ophTri::calFrequencyTerm(Real** frequency, Real** fl, Real *freqTermX, Real
 	return true;
 }
 
-void ophTri::refAS_Flat(vec3 no, Point* frequency, Face mesh, Real* freqTermX, Real* freqTermY, geometric& geom, Real lambda)
+/**
+* @brief Analytic spectrum of the reference triangle (0,0)-(1,1)-(1,0) at (fx, fy).
+* @details Every special case of a zero fx, fy or fx + fy is evaluated with a safe divisor and
+*	picked by mask, so the per-pixel loop has no branches and only two sincos.
+*/
+static inline void refFlatSpectrum(Real fx, Real fy, Real& re, Real& im)
 {
-	const Real ssX = context_.ss[_X] = context_.pixel_number[_X] * context_.pixel_pitch[_X];
-	const Real ssY = context_.ss[_Y] = context_.pixel_number[_Y] * context_.pixel_pitch[_Y];
-	const long long int pnXY = context_.pixel_number[_X] * context_.pixel_number[_Y];
+	const Real PI2 = M_PI * 2.0;
+	const Real sqPI2 = PI2 * PI2;
+	const Real fs = fx + fy;
+
+	const bool zx = (fx == 0.0);
+	const bool zy = (fy == 0.0);
+	const bool zs = (fs == 0.0);
+
+	// e1 = exp(-i 2pi fx), e2 = exp(-i 2pi (fx + fy))
+	const Real c1 = cos(PI2 * fx), s1 = sin(PI2 * fx);
+	const Real c2 = cos(PI2 * fs), s2 = sin(PI2 * fs);
+
+	const Real ix = 1.0 / (zx ? 1.0 : fx);
+	const Real iy = 1.0 / (zy ? 1.0 : fy);
+	const Real is = 1.0 / (zs ? 1.0 : fs);
+
+	// (e1 - 1) / (sqPI2 fx fy) + (1 - e2) / (sqPI2 fy fs)
+	const Real g1 = ix * iy / sqPI2, g2 = iy * is / sqPI2;
+	Real gre = (c1 - 1.0) * g1 + (1.0 - c2) * g2;
+	Real gim = -s1 * g1 + s2 * g2;
+
+	// fx == -fy : (1 - exp(i 2pi fy)) / (sqPI2 fy^2) + i / (2pi fy), where exp(i 2pi fy) = e1
+	const Real qy = iy * iy / sqPI2;
+	const Real are = (1.0 - c1) * qy;
+	const Real aim = s1 * qy + iy / PI2;
+
+	// fy == 0 : (e1 - 1) / (sqPI2 fx^2) + i e1 / (2pi fx)
+	const Real qx = ix * ix / sqPI2;
+	const Real bre = (c1 - 1.0) * qx + s1 * ix / PI2;
+	const Real bim = -s1 * qx + c1 * ix / PI2;
+
+	// fx == 0 : (1 - exp(-i 2pi fy)) / (sqPI2 fy^2) - i / (2pi fy), where exp(-i 2pi fy) = e2
+	const Real cre = (1.0 - c2) * qy;
+	const Real cim = s2 * qy - iy / PI2;
+
+	gre = zx ? cre : gre;	gim = zx ? cim : gim;
+	gre = zy ? bre : gre;	gim = zy ? bim : gim;
+	gre = (zs && !zy) ? are : gre;	gim = (zs && !zy) ? aim : gim;
+	re = (zx && zy) ? 0.5 : gre;
+	im = (zx && zy) ? 0.0 : gim;
+}
+
+// bilinear lookup of a tabulated spectrum, false outside the table.
+static inline bool refTableLookup(const Complex<Real>* table, int nTable, Real offset, Real res, Real fx, Real fy, Real& re, Real& im)
+{
+	const Real x = (fx + offset) * res;
+	const Real y = (fy + offset) * res;
+	if (!(x >= 0 && y >= 0 && x < nTable - 1 && y < nTable - 1))
+		return false;
+	const int ix = (int)x;
+	const int iy = (int)y;
+	const Real tx = x - ix;
+	const Real ty = y - iy;
+	const Complex<Real>* p0 = table + (long long int)iy * nTable + ix;
+	const Complex<Real>* p1 = p0 + nTable;
+	const Real w00 = (1 - tx) * (1 - ty), w01 = tx * (1 - ty);
+	const Real w10 = (1 - tx) * ty, w11 = tx * ty;
+	re = w00 * p0[0].real() + w01 * p0[1].real() + w10 * p1[0].real() + w11 * p1[1].real();
+	im = w00 * p0[0].imag() + w01 * p0[1].imag() + w10 * p1[0].imag() + w11 * p1[1].imag();
+	return true;
+}
+
+// tabulated reference spectrum, analytic outside the table.
+static inline void refFlatLookup(const Complex<Real>* table, int nTable, Real offset, Real res, Real fx, Real fy, Real& re, Real& im)
+{
+	if (!refTableLookup(table, nTable, offset, res, fx, fy, re, im))
+		refFlatSpectrum(fx, fy, re, im);
+}
+
+// reference spectrum convolved with the texture spectrum, summed directly.
+static inline void texFlatSpectrum(const Complex<Real>* texSpec, int texX, int texY, Real texFreq, Real fx, Real fy, Real& re, Real& im)
+{
+	Complex<Real> sum(0, 0);
+	for (int idxFy = -texY / 2; idxFy < texY / 2; idxFy++) {
+		for (int idxFx = -texX / 2; idxFx < texX / 2; idxFx++) {
+			Real tre, tim;
+			refFlatSpectrum(fx - idxFx * texFreq, fy - idxFy * texFreq, tre, tim);
+			sum += texSpec[idxFx + texX / 2 + (idxFy + texY / 2) * texX] * Complex<Real>(tre, tim);
+		}
+	}
+	re = sum[_RE];
+	im = sum[_IM];
+}
+
+bool ophTri::buildSpectrumTable()
+{
+	vector<Complex<Real>>().swap(m_vecRefTable);
+	if (m_dTableRange <= 0 || m_nTableResolution <= 0)
+		return false;
+	if (textureMapping)
+		return buildTextureTable();
+
+	auto begin = CUR_TIME;
+	const Real step = m_dTableStep = 1.0 / m_nTableResolution;
+	const int center = (int)ceil(m_dTableRange * m_nTableResolution);
+	const int nTable = 2 * center + 1;
+	m_vecRefTable.resize((long long int)nTable * nTable);
+	Complex<Real>* table = m_vecRefTable.data();
+
+	// symmetric samples, so fx + fy is exactly 0 on the anti-diagonal.
+#ifdef _OPENMP
+#pragma omp parallel for firstprivate(nTable, center, step)
+#endif
+	for (int j = 0; j < nTable; j++) {
+		const Real fy = (j - center) * step;
+		for (int i = 0; i < nTable; i++) {
+			Real re, im;
+			refFlatSpectrum((i - center) * step, fy, re, im);
+			table[(long long int)j * nTable + i] = Complex<Real>(re, im);
+		}
+	}
+
+	// |d2F/du2| <= pi^2 and |d2F/dv2| <= pi^2 / 3 over the reference triangle.
+	LOG("<END> %s : %d x %d samples, error < %e of the DC value, %.5lf (sec)\n", __FUNCTION__,
+		nTable, nTable, (4 * M_PI * M_PI / 3) * step * step / 8 / 0.5, ELAPSED_TIME(begin, CUR_TIME));
+	return true;
+}
+
+bool ophTri::buildTextureTable()
+{
+	const int texX = texture.dim[_X];
+	const int texY = texture.dim[_Y];
+	const Real texFreq = texture.freq;
+	if (textFFT == nullptr || texX < 2 || texY < 2 || texFreq <= 0) {
+		LOG("<FAILED> %s : no texture spectrum\n", __FUNCTION__);
+		return false;
+	}
 
+	auto begin = CUR_TIME;
+	// the step divides the texture frequency, so the shifted reference spectra share the grid
+	// and the convolution on it is exact.
+	const int m = (std::max)(1, (int)ceil(texFreq * m_nTableResolution));
+	const Real step = m_dTableStep = texFreq / m;
+	const int center = (int)ceil(m_dTableRange / step);
+	const int nTable = 2 * center + 1;
+
+	// kernel : texture spectrum upsampled by m, input : reference spectrum widened by the kernel.
+	const int kerX = (2 * (texX / 2) - 1) * m + 1;
+	const int kerY = (2 * (texY / 2) - 1) * m + 1;
+	const int inX = nTable + kerX - 1;
+	const int inY = nTable + kerY - 1;
+	const int nX = getOptimalFFTSize(inX);
+	const int nY = getOptimalFFTSize(inY);
+	const long long int nXY = (long long int)nX * nY;
+	// reference sample (0, 0) at input index (offX, offY)
+	const int offX = center + (texX / 2 - 1) * m;
+	const int offY = center + (texY / 2 - 1) * m;
+
+	fftw_complex* in = (fftw_complex *)fftw_malloc(sizeof(fftw_complex) * nXY);
+	fftw_complex* ker = (fftw_complex *)fftw_malloc(sizeof(fftw_complex) * nXY);
+	Complex<Real>* pIn = reinterpret_cast<Complex<Real> *>(in);
+	Complex<Real>* pKer = reinterpret_cast<Complex<Real> *>(ker);
+	fftw_plan toFreq = fftw_plan_dft_2d(nY, nX, in, in, OPH_FORWARD, OPH_ESTIMATE);
+	fftw_plan toFreqKer = fftw_plan_dft_2d(nY, nX, ker, ker, OPH_FORWARD, OPH_ESTIMATE);
+	fftw_plan toSpace = fftw_plan_dft_2d(nY, nX, in, in, OPH_BACKWARD, OPH_ESTIMATE);
+
+	memset(in, 0, sizeof(fftw_complex) * nXY);
+	memset(ker, 0, sizeof(fftw_complex) * nXY);
+#ifdef _OPENMP
+#pragma omp parallel for firstprivate(inX, nX, offX, offY, step)
+#endif
+	for (int j = 0; j < inY; j++) {
+		const Real fy = (j - offY) * step;
+		for (int i = 0; i < inX; i++) {
+			Real re, im;
+			refFlatSpectrum((i - offX) * step, fy, re, im);
+			pIn[(long long int)j * nX + i] = Complex<Real>(re, im);
+		}
+	}
+	for (int idxFy = -texY / 2; idxFy < texY / 2; idxFy++) {
+		for (int idxFx = -texX / 2; idxFx < texX / 2; idxFx++) {
+			const long long int k = (long long int)(idxFy + texY / 2) * m * nX + (idxFx + texX / 2) * m;
+			pKer[k] = textFFT[idxFx + texX / 2 + (idxFy + texY / 2) * texX];
+		}
+	}
+
+	fftw_execute(toFreq);
+	fftw_execute(toFreqKer);
+	const Real norm = 1.0 / nXY;
+#ifdef _OPENMP
+#pragma omp parallel for firstprivate(norm)
+#endif
+	for (long long int i = 0; i < nXY; i++)
+		pIn[i] *= pKer[i] * norm;
+	fftw_execute(toSpace);
+
+	// the valid part of the circular convolution starts after the kernel.
+	m_vecRefTable.resize((long long int)nTable * nTable);
+	Complex<Real>* table = m_vecRefTable.data();
+#ifdef _OPENMP
+#pragma omp parallel for firstprivate(nTable, nX, kerX, kerY)
+#endif
+	for (int j = 0; j < nTable; j++)
+		memcpy(&table[(long long int)j * nTable], &pIn[(long long int)(j + kerY - 1) * nX + kerX - 1], sizeof(Complex<Real>) * nTable);
+
+	fftw_destroy_plan(toFreq);
+	fftw_destroy_plan(toFreqKer);
+	fftw_destroy_plan(toSpace);
+	fftw_free(in);
+	fftw_free(ker);
+
+	LOG("<END> %s : %d x %d samples from a %d x %d convolution, %.5lf (sec)\n", __FUNCTION__,
+		nTable, nTable, nX, nY, ELAPSED_TIME(begin, CUR_TIME));
+	return true;
+}
+
+Complex<Real> ophTri::calShadingFactor(vec3 no, geometric& geom, Real lambda, const Real* carrier)
+{
 	vec3 n = no / norm(no);
 
 	Complex<Real> shadingFactor;
 	Real PI2 = M_PI * 2;
-	Real sqPI2 = PI2 * PI2;
 
 	Complex<Real> term1(0, 0);
 	term1[_IM] = -PI2 / lambda * (
-		carrierWave[_X] * (geom.glRot[0] * geom.glShift[_X] + geom.glRot[3] * geom.glShift[_Y] + geom.glRot[6] * geom.glShift[_Z])
-		+ carrierWave[_Y] * (geom.glRot[1] * geom.glShift[_X] + geom.glRot[4] * geom.glShift[_Y] + geom.glRot[7] * geom.glShift[_Z])
-		+ carrierWave[_Z] * (geom.glRot[2] * geom.glShift[_X] + geom.glRot[5] * geom.glShift[_Y] + geom.glRot[8] * geom.glShift[_Z])
+		carrier[_X] * (geom.glRot[0] * geom.glShift[_X] + geom.glRot[3] * geom.glShift[_Y] + geom.glRot[6] * geom.glShift[_Z])
+		+ carrier[_Y] * (geom.glRot[1] * geom.glShift[_X] + geom.glRot[4] * geom.glShift[_Y] + geom.glRot[7] * geom.glShift[_Z])
+		+ carrier[_Z] * (geom.glRot[2] * geom.glShift[_X] + geom.glRot[5] * geom.glShift[_Y] + geom.glRot[8] * geom.glShift[_Z])
 		);
 
 	if (illumination[_X] == 0 && illumination[_Y] == 0 && illumination[_Z] == 0) {
@@ -919,10 +1603,102 @@ void ophTri::refAS_Flat(vec3 no, Point* frequency, Face mesh, Real* freqTermX, R
 		if (shadingFactor[_RE] * shadingFactor[_RE] + shadingFactor[_IM] * shadingFactor[_IM] < 0)
 			shadingFactor = 0;
 	}
+	return shadingFactor;
+}
+
+bool ophTri::refAS_FlatCulled(vec3 no, Point* frequency, geometric& geom, Real lambda, Complex<Real>* dst, TriWork& work)
+{
+	const long long int pnXY = context_.pixel_number[_X] * context_.pixel_number[_Y];
+	const Real* freqTermX = work.freqTermX;
+	const Real* freqTermY = work.freqTermY;
+	const Point* fl = work.fl;
+
+	Real PI2 = M_PI * 2;
+	Real det = geom.loRot[0] * geom.loRot[3] - geom.loRot[1] * geom.loRot[2];
+
+	if (det == 0)
+		return false;
+	if (det < 0)
+		det = -det;
+
+	// the reference spectrum is 1/2 at the origin; samples whose envelope stays below
+	// sqrt(threshold) of that carry less than the threshold of the peak energy.
+	const Complex<Real> factor = calShadingFactor(no, geom, lambda, work.carrier) / det;
+	const Real limit = sqrt(m_dCullThreshold) * 0.5;
+	geometric g;
+	memcpy(&g, &geom, sizeof(geometric));
+
+	Complex<Real>* refAS = work.refAS;
+	const Complex<Real>* table = m_vecRefTable.empty() ? nullptr : m_vecRefTable.data();
+	const int nTable = (int)sqrt((Real)m_vecRefTable.size() + 0.5);
+	const Real res = 1 / m_dTableStep;
+	const Real offset = (nTable / 2) / res;
+	long long int nCulled = 0;
+#ifdef _OPENMP
+#pragma omp parallel for firstprivate(PI2, limit, factor, nTable, res, offset) reduction(+:nCulled)
+#endif
+	for (long long int i = 0; i < pnXY; i++)
+	{
+		const Real u = freqTermX[i];
+		const Real v = freqTermY[i];
+
+		// divergence theorem over the three edges of the reference triangle:
+		// |F(u, v)| <= sum |k.n| min(L, 1 / (pi |k.t|)) / (2pi |k|^2)
+		// = (|u - v| / a + |u| / b + |v| / c) / (2pi |k|^2), compared without divisions.
+		Real rr = u * u + v * v;
+		Real a = (std::max)(1.0, M_PI * fabs(u + v));
+		Real b = (std::max)(1.0, M_PI * fabs(v));
+		Real c = (std::max)(1.0, M_PI * fabs(u));
+		Real edge = fabs(u - v) * b * c + fabs(u) * a * c + fabs(v) * a * b;
+		if (edge < limit * PI2 * rr * a * b * c) {
+			refAS[i] = 0;
+			nCulled++;
+			continue;
+		}
+
+		Real re, im;
+		if (table)
+			refFlatLookup(table, nTable, offset, res, u, v, re, im);
+		else
+			refFlatSpectrum(u, v, re, im);
+		refAS[i] = Complex<Real>(re, im) * factor;
+	}
+
+#ifdef _OPENMP
+#pragma omp parallel for firstprivate(PI2, g)
+#endif
+	for (long long int i = 0; i < pnXY; i++)
+	{
+		if (frequency[i].pos[_Z] == 0 || (refAS[i][_RE] == 0 && refAS[i][_IM] == 0))
+			continue;
+
+		Complex<Real> term1(0, PI2 * (fl[i].pos[_X] * g.glShift[_X] + fl[i].pos[_Y] * g.glShift[_Y] + fl[i].pos[_Z] * g.glShift[_Z]));
+		Complex<Real> term2(0, 0);
+		term2 = refAS[i] * fl[i].pos[_Z] / frequency[i].pos[_Z] * exp(term1);
+		if (abs(term2) > MIN_DOUBLE)
+			dst[i] += term2;
+	}
+
+	work.nSample += pnXY;
+	work.nCulled += nCulled;
+	return true;
+}
+
+void ophTri::refAS_Flat(vec3 no, Point* frequency, Face mesh, geometric& geom, Real lambda, TriWork& work)
+{
+	Complex<Real>* refAS = work.refAS;
+	Complex<Real>* convol = work.convol;
+	const Real ssX = context_.pixel_number[_X] * context_.pixel_pitch[_X];
+	const Real ssY = context_.pixel_number[_Y] * context_.pixel_pitch[_Y];
+	const long long int pnXY = context_.pixel_number[_X] * context_.pixel_number[_Y];
+
+	Complex<Real> shadingFactor = calShadingFactor(no, geom, lambda, work.carrier);
+	Real PI2 = M_PI * 2;
+
 	Real dfx = 1 / ssX;
 	Real dfy = 1 / ssY;
 
-	if (occlusion) {
+	if (isFaceOcclusion()) {
 		Complex<Real> term1(0, 0);
 		Real dfxy = dfx * dfy;
 
@@ -937,21 +1713,19 @@ void ophTri::refAS_Flat(vec3 no, Point* frequency, Face mesh, Real* freqTermX, R
 			rearAS[i] = angularSpectrum[i] * exp(term1) * dfxy;
 		}
 
-		refASInner_flat(freqTermX, freqTermY);			// refAS main function including texture mapping 
+		refASInner_flat(work.freqTermX, work.freqTermY, refAS);			// refAS main function including texture mapping 
 
 		if (randPhase) {
 #ifdef _OPENMP
-#pragma omp parallel for firstprivate(PI2, shadingFactor)
+#pragma omp parallel for firstprivate(shadingFactor)
 #endif
 			for (int i = 0; i < pnXY; i++) {
-				Complex<Real> phase(0, 0);
-				phase[_IM] = PI2 * rand(0.0, 1.0, i);
-				convol[i] = shadingFactor * exp(phase) - rearAS[i];
+				convol[i] = shadingFactor * phaseTerm[i] - rearAS[i];
 			}
-			conv_fft2_scale(refAS, convol, refAS, context_.pixel_number);
+			m_conv.execute(refAS, convol, refAS);
 		}
 		else {
-			conv_fft2_scale(rearAS, refAS, convol, context_.pixel_number);
+			m_conv.execute(rearAS, refAS, convol);
 #ifdef _OPENMP
 #pragma omp parallel for firstprivate(shadingFactor)
 #endif
@@ -961,19 +1735,11 @@ void ophTri::refAS_Flat(vec3 no, Point* frequency, Face mesh, Real* freqTermX, R
 		}
 	}
 	else {
-		refASInner_flat(freqTermX, freqTermY);			// refAS main function including texture mapping
+		refASInner_flat(work.freqTermX, work.freqTermY, refAS);			// refAS main function including texture mapping
 
 		if (randPhase == true) {
-			Complex<Real> phase(0, 0);
-#ifdef _OPENMP
-#pragma omp parallel for firstprivate(PI2, shadingFactor)
-#endif
-			for (int i = 0; i < pnXY; i++) {
-				Real randVal = rand(0.0, 1.0, i);
-				phase[_IM] = PI2 * randVal;
-				phaseTerm[i] = shadingFactor * exp(phase);
-			}
-			conv_fft2_scale(refAS, phaseTerm, refAS, context_.pixel_number);
+			// (shadingFactor * phaseTerm) convolution, with the phaseTerm spectrum cached in m_conv
+			m_conv.execute(refAS, refAS, shadingFactor);
 		}
 		else {
 #ifdef _OPENMP
@@ -986,93 +1752,72 @@ void ophTri::refAS_Flat(vec3 no, Point* frequency, Face mesh, Real* freqTermX, R
 	}
 }
 
-void ophTri::refASInner_flat(Real* freqTermX, Real* freqTermY)
+void ophTri::refASInner_flat(Real* freqTermX, Real* freqTermY, Complex<Real>* refAS)
 {
 	const long long int pnXY = context_.pixel_number[_X] * context_.pixel_number[_Y];
-	Real PI2 = M_PI * 2.0;
-
-//#ifndef _OPENMP
-//#pragma omp parallel for private(i) 
-//#endif
-	for (int i = 0; i < pnXY; i++) {
-		if (textureMapping == true) {
-			refAS[i] = 0;
-			for (int idxFy = -texture.dim[_Y] / 2; idxFy < texture.dim[_Y] / 2; idxFy++) {
-				for (int idxFx = -texture.dim[_X] / 2; idxFx < texture.dim[_X] / 2; idxFy++) {
-					textFreqX = idxFx * texture.freq;
-					textFreqY = idxFy * texture.freq;
 
-					tempFreqTermX[i] = freqTermX[i] - textFreqX;
-					tempFreqTermY[i] = freqTermY[i] - textFreqY;
+	if (textureMapping == true) {
+		const int texX = texture.dim[_X];
+		const int texY = texture.dim[_Y];
+		const Real texFreq = texture.freq;
+		const Complex<Real>* texSpec = textFFT;
+		const Complex<Real>* table = m_vecRefTable.empty() ? nullptr : m_vecRefTable.data();
+		const int nTable = (int)sqrt((Real)m_vecRefTable.size() + 0.5);
+		const Real res = 1 / m_dTableStep;
+		const Real offset = (nTable / 2) / res;
+
+		// the convolution with the texture spectrum is tabulated by buildTextureTable,
+		// and summed directly outside the table.
+#ifdef _OPENMP
+#pragma omp parallel for firstprivate(texX, texY, texFreq, nTable, res, offset)
+#endif
+		for (long long int i = 0; i < pnXY; i++) {
+			Real re, im;
+			if (!table || !refTableLookup(table, nTable, offset, res, freqTermX[i], freqTermY[i], re, im))
+				texFlatSpectrum(texSpec, texX, texY, texFreq, freqTermX[i], freqTermY[i], re, im);
+			refAS[i][_RE] = re;
+			refAS[i][_IM] = im;
+		}
+		return;
+	}
 
-					if (tempFreqTermX[i] == -tempFreqTermY[i] && tempFreqTermY[i] != 0.0) {
-						refTerm1[_IM] = PI2 * tempFreqTermY[i];
-						refTerm2[_IM] = 1.0;
-						refTemp = ((Complex<Real>)1.0 - exp(refTerm1)) / (4.0 * M_PI*M_PI*tempFreqTermY[i] * tempFreqTermY[i]) + refTerm2 / (PI2*tempFreqTermY[i]);
-						refAS[i] = refAS[i] + textFFT[idxFx + texture.dim[_X] / 2 + (idxFy + texture.dim[_Y] / 2)*texture.dim[_X]] * refTemp;
+	if (!m_vecRefTable.empty()) {
+		const Complex<Real>* table = m_vecRefTable.data();
+		const int nTable = (int)sqrt((Real)m_vecRefTable.size() + 0.5);
+		const Real res = 1 / m_dTableStep;
+		const Real offset = (nTable / 2) / res;
 
-					}
-					else if (tempFreqTermX[i] == tempFreqTermY[i] && tempFreqTermX[i] == 0.0) {
-						refTemp = (Real)(1.0 / 2.0);
-						refAS[i] = refAS[i] + textFFT[idxFx + texture.dim[_X] / 2 + (idxFy + texture.dim[_Y] / 2)*texture.dim[_X]] * refTemp;
-					}
-					else if (tempFreqTermX[i] != 0.0 && tempFreqTermY[i] == 0.0) {
-						refTerm1[_IM] = -PI2 * tempFreqTermX[i];
-						refTerm2[_IM] = 1.0;
-						refTemp = (exp(refTerm1) - (Complex<Real>)1.0) / (PI2*tempFreqTermX[i] * PI2*tempFreqTermX[i]) + (refTerm2 * exp(refTerm1)) / (PI2*tempFreqTermX[i]);
-						refAS[i] = refAS[i] + textFFT[idxFx + texture.dim[_X] / 2 + (idxFy + texture.dim[_Y] / 2)*texture.dim[_X]] * refTemp;
-					}
-					else if (tempFreqTermX[i] == 0.0 && tempFreqTermY[i] != 0.0) {
-						refTerm1[_IM] = PI2 * tempFreqTermY[i];
-						refTerm2[_IM] = 1.0;
-						refTemp = ((Complex<Real>)1.0 - exp(refTerm1)) / (4.0 * M_PI*M_PI*tempFreqTermY[i] * tempFreqTermY[i]) - refTerm2 / (PI2*tempFreqTermY[i]);
-						refAS[i] = refAS[i] + textFFT[idxFx + texture.dim[_X] / 2 + (idxFy + texture.dim[_Y] / 2)*texture.dim[_X]] * refTemp;
-					}
-					else {
-						refTerm1[_IM] = -PI2 * tempFreqTermX[i];
-						refTerm2[_IM] = -PI2 * (tempFreqTermX[i] + tempFreqTermY[i]);
-						refTemp = (exp(refTerm1) - (Complex<Real>)1.0) / (4.0 * M_PI*M_PI*tempFreqTermX[i] * tempFreqTermY[i]) + ((Complex<Real>)1.0 - exp(refTerm2)) / (4.0 * M_PI*M_PI*tempFreqTermY[i] * (tempFreqTermX[i] + tempFreqTermY[i]));
-						refAS[i] = refAS[i] + textFFT[idxFx + texture.dim[_X] / 2 + (idxFy + texture.dim[_Y] / 2)*texture.dim[_X]] * refTemp;
-					}
-				}
-			}
-		}
-		else {
-			if (freqTermX[i] == -freqTermY[i] && freqTermY[i] != 0.0) {
-				refTerm1[_IM] = PI2 * freqTermY[i];
-				refTerm2[_IM] = 1.0;
-				refAS[i] = ((Complex<Real>)1.0 - exp(refTerm1)) / (4.0 * M_PI*M_PI*freqTermY[i] * freqTermY[i]) + refTerm2 / (PI2*freqTermY[i]);
-			}
-			else if (freqTermX[i] == freqTermY[i] && freqTermX[i] == 0.0) {
-				refAS[i] = (Real)(1.0 / 2.0);
-			}
-			else if (freqTermX[i] != 0 && freqTermY[i] == 0.0) {
-				refTerm1[_IM] = -PI2 * freqTermX[i];
-				refTerm2[_IM] = 1.0;
-				refAS[i] = (exp(refTerm1) - (Complex<Real>)1.0) / (PI2 * freqTermX[i] * PI2 * freqTermX[i]) + (refTerm2 * exp(refTerm1)) / (PI2*freqTermX[i]);
-			}
-			else if (freqTermX[i] == 0 && freqTermY[i] != 0.0) {
-				refTerm1[_IM] = PI2 * freqTermY[i];
-				refTerm2[_IM] = 1.0;
-				refAS[i] = ((Complex<Real>)1.0 - exp(refTerm1)) / (PI2 * PI2 * freqTermY[i] * freqTermY[i]) - refTerm2 / (PI2*freqTermY[i]);
-			}
-			else {
-				refTerm1[_IM] = -PI2 * freqTermX[i];
-				refTerm2[_IM] = -PI2 * (freqTermX[i] + freqTermY[i]);
-				refAS[i] = (exp(refTerm1) - (Complex<Real>)1.0) / (PI2 * PI2 * freqTermX[i] * freqTermY[i]) + ((Complex<Real>)1.0 - exp(refTerm2)) / (4.0 * M_PI*M_PI*freqTermY[i] * (freqTermX[i] + freqTermY[i]));
-			}
+#ifdef _OPENMP
+#pragma omp parallel for firstprivate(nTable, res, offset)
+#endif
+		for (long long int i = 0; i < pnXY; i++) {
+			Real re, im;
+			refFlatLookup(table, nTable, offset, res, freqTermX[i], freqTermY[i], re, im);
+			refAS[i][_RE] = re;
+			refAS[i][_IM] = im;
 		}
+		return;
+	}
+
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+	for (long long int i = 0; i < pnXY; i++) {
+		Real re, im;
+		refFlatSpectrum(freqTermX[i], freqTermY[i], re, im);
+		refAS[i][_RE] = re;
+		refAS[i][_IM] = im;
 	}
 }
 
-bool ophTri::refAS_Continuous(uint n, Real* freqTermX, Real* freqTermY)
+bool ophTri::refAS_Continuous(uint n, TriWork& work)
 {
 	const int pnXY = context_.pixel_number[_X] * context_.pixel_number[_Y];
+	const Real* freqTermX = work.freqTermX;
+	const Real* freqTermY = work.freqTermY;
+	Complex<Real>* refAS = work.refAS;
 
-	av = vec3(0.0, 0.0, 0.0);
-	av[0] = nv[3 * n + 0][0] * illumination[0] + nv[3 * n + 0][1] * illumination[1] + nv[3 * n + 0][2] * illumination[2] + 0.1;
-	av[2] = nv[3 * n + 1][0] * illumination[0] + nv[3 * n + 1][1] * illumination[1] + nv[3 * n + 1][2] * illumination[2] + 0.1;
-	av[1] = nv[3 * n + 2][0] * illumination[0] + nv[3 * n + 2][1] * illumination[1] + nv[3 * n + 2][2] * illumination[2] + 0.1;
+	vec3 av = calVertexShading(n);
 
 	Complex<Real> refTerm1(0, 0);
 	Complex<Real> refTerm2(0, 0);
@@ -1136,21 +1881,191 @@ bool ophTri::refAS_Continuous(uint n, Real* freqTermX, Real* freqTermY)
 		refAS[i] = (av[1] - av[0])*D1 + (av[2] - av[1])*D2 + av[0] * D3;
 	}
 	if (randPhase == true) {
-		Complex<Real> phase(0, 0);
-		Real PI2 = M_PI * 2.0;
-		for (int i = 0; i < pnXY; i++) {
-			Real randVal = rand(0.0, 1.0, i);
-			phase[_IM] = PI2 * randVal;
-			phaseTerm[i] = exp(phase);
+		m_conv.execute(refAS, work.convol);
+	}
+
+	return true;
+}
+
+vec3 ophTri::calVertexShading(uint n)
+{
+	vec3 av(0.0, 0.0, 0.0);
+	av[0] = nv[3 * n + 0][0] * illumination[0] + nv[3 * n + 0][1] * illumination[1] + nv[3 * n + 0][2] * illumination[2] + 0.1;
+	av[2] = nv[3 * n + 1][0] * illumination[0] + nv[3 * n + 1][1] * illumination[1] + nv[3 * n + 1][2] * illumination[2] + 0.1;
+	av[1] = nv[3 * n + 2][0] * illumination[0] + nv[3 * n + 2][1] * illumination[1] + nv[3 * n + 2][2] * illumination[2] + 0.1;
+	return av;
+}
+
+bool ophTri::calPointAS(uint SHADING_FLAG, Point* frequency, Real lambda, const Real* carrier, Complex<Real>* dst)
+{
+	const int K = (int)m_vecPointIdx.size();
+	if (K == 0)
+		return false;
+
+	auto begin = CUR_TIME;
+	const int pnX = context_.pixel_number[_X];
+	const int pnY = context_.pixel_number[_Y];
+	const long long int pnXY = pnX * pnY;
+	const Real ppX = context_.pixel_pitch[_X];
+	const Real ppY = context_.pixel_pitch[_Y];
+	const Real PI2 = M_PI * 2;
+	const Real w = 1 / lambda;
+
+	struct Emitter {
+		Real pos[3];
+		Real n[3];
+		Complex<Real> amp;
+	};
+	vector<Emitter> emitter(K);
+
+	// a face smaller than a pixel radiates like its centroid with the DC value of its spectrum.
+#ifdef _OPENMP
+#pragma omp parallel for firstprivate(PI2, w)
+#endif
+	for (int k = 0; k < K; k++)
+	{
+		const int idx = m_vecPointIdx[k];
+		const Face& f = scaledMeshData[idx];
+		geometric& geom = m_vecPointGeom[k];
+		Emitter& e = emitter[k];
+
+		Real dc[3];
+		for (int a = 0; a < 3; a++)
+		{
+			e.pos[a] = (f.vertices[_FIRST].point.pos[a] + f.vertices[_SECOND].point.pos[a] + f.vertices[_THIRD].point.pos[a]) / 3;
+			dc[a] = e.pos[a] - f.vertices[_FIRST].point.pos[a];
+			e.n[a] = geom.glRot[6 + a];
 		}
 
-		conv_fft2_scale(refAS, phaseTerm, convol, context_.pixel_number);
+		Real det = geom.loRot[0] * geom.loRot[3] - geom.loRot[1] * geom.loRot[2];
+		if (det < 0)
+			det = -det;
+
+		Complex<Real> amp;
+		if (SHADING_FLAG == SHADING_FLAT)
+			amp = calShadingFactor(no[idx], geom, lambda, carrier) * 0.5;
+		else {
+			// D1, D2 and D3 of refAS_Continuous at the origin
+			vec3 av = calVertexShading(idx);
+			amp = (av[1] - av[0]) / 3.0 + (av[2] - av[1]) / 5.0 + av[0] / 2.0;
+		}
+
+		// the carrier phase moves from the first vertex to the centroid.
+		Complex<Real> phase(0, PI2 * w * (carrier[_X] * dc[_X] + carrier[_Y] * dc[_Y] + carrier[_Z] * dc[_Z]));
+		e.amp = amp / det * phase.exp();
 	}
 
+	std::sort(emitter.begin(), emitter.end(), [](const Emitter& a, const Emitter& b) { return a.pos[_Z] < b.pos[_Z]; });
+
+	// within a bin, exp(-i 2pi fz dz) ~ exp(-i 2pi dz / lambda) exp(i pi lambda dz (fx^2 + fy^2)), whose
+	// next term lambda^3 f^4 / 8 is kept below 0.05 rad over the band.
+	const Real fmax2 = 0.25 / (ppX * ppX) + 0.25 / (ppY * ppY);
+	const Real dzMax = 0.05 * 8 / (PI2 * lambda * lambda * lambda * fmax2 * fmax2);
+
+	Real* fx = new Real[pnX];
+	Real* fy = new Real[pnY];
+	for (int c = 0; c < pnX; c++)
+		fx[c] = frequency[c].pos[_X];
+	for (int r = 0; r < pnY; r++)
+		fy[r] = frequency[(long long int)r * pnX].pos[_Y];
+
+	const int nChunk = 64;
+	Complex<Real>* sum = new Complex<Real>[pnXY];
+	Complex<Real>* ex = new Complex<Real>[nChunk * pnX];
+	Complex<Real>* exTilt = new Complex<Real>[nChunk * pnX];
+	Complex<Real>* ey = new Complex<Real>[nChunk * pnY];
+	Complex<Real>* eyTilt = new Complex<Real>[nChunk * pnY];
+
+	int nBin = 0;
+	for (int first = 0; first < K; )
+	{
+		int last = first;
+		while (last < K && emitter[last].pos[_Z] - emitter[first].pos[_Z] <= 2 * dzMax)
+			last++;
+		const Real zBin = (emitter[first].pos[_Z] + emitter[last - 1].pos[_Z]) / 2;
+		memset(sum, 0, sizeof(Complex<Real>) * pnXY);
+
+		for (int base = first; base < last; base += nChunk)
+		{
+			const int n = (std::min)(nChunk, last - base);
+
+			// separable factors; the obliquity fl_z / f_z of the face is taken to first order in lambda f.
+#ifdef _OPENMP
+#pragma omp parallel for firstprivate(PI2, w, zBin)
+#endif
+			for (int k = 0; k < n; k++)
+			{
+				const Emitter& e = emitter[base + k];
+				const Real dz = e.pos[_Z] - zBin;
+				const Real fresnel = 0.5 * lambda * dz;
+
+				for (int c = 0; c < pnX; c++)
+				{
+					Complex<Real> t(0, -PI2 * fx[c] * (e.pos[_X] - fresnel * fx[c]));
+					ex[k * pnX + c] = t.exp();
+					exTilt[k * pnX + c] = ex[k * pnX + c] * (lambda * e.n[_X] * fx[c]);
+				}
+
+				Complex<Real> axial(0, -PI2 * dz * w);
+				Complex<Real> amp = e.amp * axial.exp();
+				for (int r = 0; r < pnY; r++)
+				{
+					Complex<Real> t(0, -PI2 * fy[r] * (e.pos[_Y] - fresnel * fy[r]));
+					ey[k * pnY + r] = amp * t.exp();
+					eyTilt[k * pnY + r] = ey[k * pnY + r] * (e.n[_Z] + lambda * e.n[_Y] * fy[r]);
+				}
+			}
+
+#ifdef _OPENMP
+#pragma omp parallel for firstprivate(n)
+#endif
+			for (int r = 0; r < pnY; r++)
+			{
+				Complex<Real>* row = sum + (long long int)r * pnX;
+				for (int k = 0; k < n; k++)
+				{
+					const Real c1re = eyTilt[k * pnY + r].real(), c1im = eyTilt[k * pnY + r].imag();
+					const Real c2re = ey[k * pnY + r].real(), c2im = ey[k * pnY + r].imag();
+					const Complex<Real>* e1 = ex + k * pnX;
+					const Complex<Real>* e2 = exTilt + k * pnX;
+					for (int c = 0; c < pnX; c++)
+					{
+						const Real e1re = e1[c].real(), e1im = e1[c].imag();
+						const Real e2re = e2[c].real(), e2im = e2[c].imag();
+						row[c][_RE] += c1re * e1re - c1im * e1im + c2re * e2re - c2im * e2im;
+						row[c][_IM] += c1re * e1im + c1im * e1re + c2re * e2im + c2im * e2re;
+					}
+				}
+			}
+		}
+
+		// propagation of the bin plane to the hologram
+#ifdef _OPENMP
+#pragma omp parallel for firstprivate(PI2, zBin)
+#endif
+		for (long long int i = 0; i < pnXY; i++)
+		{
+			Complex<Real> prop(0, -PI2 * frequency[i].pos[_Z] * zBin);
+			dst[i] += sum[i] * prop.exp();
+		}
+
+		first = last;
+		nBin++;
+	}
+
+	delete[] fx;
+	delete[] fy;
+	delete[] sum;
+	delete[] ex;
+	delete[] exTilt;
+	delete[] ey;
+	delete[] eyTilt;
+
+	LOG("<END> %s : %d point sources in %d depth bins, %.5lf (sec)\n", __FUNCTION__, K, nBin, ELAPSED_TIME(begin, CUR_TIME));
 	return true;
 }
 
-bool ophTri::refToGlobal(Complex<Real> *dst, Point* frequency, Point* fl, geometric& geom)
+bool ophTri::refToGlobal(Complex<Real> *dst, Complex<Real>* refAS, Point* frequency, Point* fl, geometric& geom)
 {
 	const long long int pnXY = context_.pixel_number[_X] * context_.pixel_number[_Y];
 
@@ -1194,7 +2109,7 @@ bool ophTri::refToGlobal(Complex<Real> *dst, Point* frequency, Point* fl, geomet
 	return true;
 }
 
-bool ophTri::refToGlobal(Real** frequency, Real** fl, geometric& geom)
+bool ophTri::refToGlobal(Complex<Real>* refAS, Real** frequency, Real** fl, geometric& geom)
 {
 	const int pnXY = context_.pixel_number[_X] * context_.pixel_number[_Y];
 
@@ -1249,74 +2164,85 @@ void ophTri::conv_fft2_scale(Complex<Real>* src1, Complex<Real>* src2, Complex<R
 	const int N = size[_X] * size[_Y];
 	if (N <= 0) return;
 
-
-	Complex<Real>* src1FT = new Complex<Real>[N];
-	Complex<Real>* src2FT = new Complex<Real>[N];
-	Complex<Real>* dstFT = new Complex<Real>[N];
-
-
-	fft2(src1, src1FT, size[_X], size[_Y], OPH_FORWARD, (bool)OPH_ESTIMATE);
-
-	fft2(src2, src2FT, size[_X], size[_Y], OPH_FORWARD, (bool)OPH_ESTIMATE);
-
-	Real scale = (Real)N * (Real)N;
-	for (int i = 0; i < N; i++)
-		dstFT[i] = src1FT[i] * src2FT[i] * scale;
-
-	fft2(dstFT, dst, size[_X], size[_Y], OPH_BACKWARD, (bool)OPH_ESTIMATE);
-
-	delete[] src1FT;
-	delete[] src2FT;
-	delete[] dstFT;
+	// m_conv keeps the random phase spectrum of the hologram size, other sizes must not drop it.
+	if (size == m_conv.getSize()) {
+		m_conv.execute(src1, src2, dst);
+		return;
+	}
+	ophConvolution conv;
+	if (!conv.init(size)) return;
+	conv.execute(src1, src2, dst);
 }
 
 void ophTri::prepareMeshData()
 {
 	auto begin = CUR_TIME;
 	const int N = meshData->n_faces;
-	const int N3 = N * 3;
-
+	const int nVertex = (int)meshData->n_vertices;
+	const Real* vertices = meshData->vertices;
+	const uint* indices = meshData->indices;
 
-	Real x_max, x_min, y_max, y_min, z_max, z_min;
-	x_max = y_max = z_max = MIN_DOUBLE;
-	x_min = y_min = z_min = MAX_DOUBLE;
-
-	for (int i = 0; i < N3; i++)
+	// bounding box of the shared vertices, reduced over the threads.
+	Real bmin[3] = { MAX_DOUBLE, MAX_DOUBLE, MAX_DOUBLE };
+	Real bmax[3] = { -MAX_DOUBLE, -MAX_DOUBLE, -MAX_DOUBLE };
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
 	{
-		int idxFace = i / 3;
-		int idxPoint = i % 3;
-
-		if (x_max < triMeshArray[idxFace].vertices[idxPoint].point.pos[_X]) x_max = triMeshArray[idxFace].vertices[idxPoint].point.pos[_X];
-		if (x_min > triMeshArray[idxFace].vertices[idxPoint].point.pos[_X]) x_min = triMeshArray[idxFace].vertices[idxPoint].point.pos[_X];
-		if (y_max < triMeshArray[idxFace].vertices[idxPoint].point.pos[_Y]) y_max = triMeshArray[idxFace].vertices[idxPoint].point.pos[_Y];
-		if (y_min > triMeshArray[idxFace].vertices[idxPoint].point.pos[_Y]) y_min = triMeshArray[idxFace].vertices[idxPoint].point.pos[_Y];
-		if (z_max < triMeshArray[idxFace].vertices[idxPoint].point.pos[_Z]) z_max = triMeshArray[idxFace].vertices[idxPoint].point.pos[_Z];
-		if (z_min > triMeshArray[idxFace].vertices[idxPoint].point.pos[_Z]) z_min = triMeshArray[idxFace].vertices[idxPoint].point.pos[_Z];
+		Real lmin[3] = { MAX_DOUBLE, MAX_DOUBLE, MAX_DOUBLE };
+		Real lmax[3] = { -MAX_DOUBLE, -MAX_DOUBLE, -MAX_DOUBLE };
+#ifdef _OPENMP
+#pragma omp for
+#endif
+		for (int i = 0; i < nVertex; i++) {
+			for (int k = 0; k < 3; k++) {
+				Real v = vertices[i * 3 + k];
+				if (lmin[k] > v) lmin[k] = v;
+				if (lmax[k] < v) lmax[k] = v;
+			}
+		}
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+		{
+			for (int k = 0; k < 3; k++) {
+				if (bmin[k] > lmin[k]) bmin[k] = lmin[k];
+				if (bmax[k] < lmax[k]) bmax[k] = lmax[k];
+			}
+		}
 	}
 
-	Real x_cen = (x_max + x_min) / 2;
-	Real y_cen = (y_max + y_min) / 2;
-	Real z_cen = (z_max + z_min) / 2;
-	vec3 cen(x_cen, y_cen, z_cen);
+	vec3 cen((bmax[_X] + bmin[_X]) / 2, (bmax[_Y] + bmin[_Y]) / 2, (bmax[_Z] + bmin[_Z]) / 2);
 
-	Real x_del = x_max - x_min;
-	Real y_del = y_max - y_min;
-	Real z_del = z_max - z_min;
+	Real x_del = bmax[_X] - bmin[_X];
+	Real y_del = bmax[_Y] - bmin[_Y];
+	Real z_del = bmax[_Z] - bmin[_Z];
 
 	Real del = maxOfArr({ x_del, y_del, z_del });
 
 	vec3 shift = getContext().shift;
 	vec3 locObjSize = objSize;
+
+	// every shared vertex is scaled once, then the faces are expanded from the index buffer.
+	vector<Real> scaled(nVertex * 3);
 #ifdef _OPENMP
 #pragma omp parallel for firstprivate(cen, del, locObjSize, shift)
 #endif
-	for (int i = 0; i < N3; i++)
+	for (int i = 0; i < nVertex; i++)
+	{
+		scaled[i * 3 + _X] = (vertices[i * 3 + _X] - cen[_X]) / del * locObjSize[_X] + shift[_X];
+		scaled[i * 3 + _Y] = (vertices[i * 3 + _Y] - cen[_Y]) / del * locObjSize[_Y] + shift[_Y];
+		scaled[i * 3 + _Z] = (vertices[i * 3 + _Z] - cen[_Z]) / del * locObjSize[_Z] + shift[_Z];
+	}
+
+	m_vecFaceVertex.assign(indices, indices + N * 3);
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+	for (int i = 0; i < N; i++)
 	{
-		int idxFace = i / 3;
-		int idxPoint = i % 3;
-		scaledMeshData[idxFace].vertices[idxPoint].point.pos[_X] = (triMeshArray[idxFace].vertices[idxPoint].point.pos[_X] - cen[_X]) / del * locObjSize[_X] + shift[_X];
-		scaledMeshData[idxFace].vertices[idxPoint].point.pos[_Y] = (triMeshArray[idxFace].vertices[idxPoint].point.pos[_Y] - cen[_Y]) / del * locObjSize[_Y] + shift[_Y];
-		scaledMeshData[idxFace].vertices[idxPoint].point.pos[_Z] = (triMeshArray[idxFace].vertices[idxPoint].point.pos[_Z] - cen[_Z]) / del * locObjSize[_Z] + shift[_Z];
+		for (int k = 0; k < 3; k++)
+			memcpy(scaledMeshData[i].vertices[k].point.pos, &scaled[indices[i * 3 + k] * 3], sizeof(Point));
 	}
 
 	LOG("<END> %s : %.5lf (sec)\n", __FUNCTION__, ELAPSED_TIME(begin, CUR_TIME));
@@ -65,6 +65,22 @@ struct geometric {
 	Real loRot[4] = { 0, };
 };
 
+/**
+* @brief	working buffers of the angular spectrum of one face
+* @details	inner parameters, one set per thread in the face-parallel mode
+*/
+struct TriWork {
+	Point* fl = nullptr;
+	Real* freqTermX = nullptr;
+	Real* freqTermY = nullptr;
+	Complex<Real>* refAS = nullptr;
+	Complex<Real>* convol = nullptr;
+	Complex<Real>* AS = nullptr;			/// private angular spectrum accumulator
+	long long int nSample = 0;				/// samples seen by the spectral culling
+	long long int nCulled = 0;				/// samples skipped by the spectral culling
+	Real carrier[3] = { 0, 0, 1 };			/// carrier wave direction of this pass
+};
+
 /**
 * @brief	texture mapping parameters
 * @details
@@ -143,7 +159,10 @@ public:
 
 
 	//Real* getMeshData() { return triMeshArray; }
-	Face* getMeshData() { return triMeshArray; }
+	/**
+	* @brief Faces of the loaded mesh, expanded from the shared vertices on the first call.
+	*/
+	Face* getMeshData();
 	Complex<Real>* getAngularSpectrum() { return angularSpectrum; }
 	//Real* getScaledMeshData() { return scaledMeshData; }
 	Face* getScaledMeshData() { return scaledMeshData; }
@@ -166,6 +185,7 @@ public:
 	* @brief	Mesh data load
 	* @details	Text file data structure : N*9 / Each row = [x1 y1 z1 x2 y2 z2 x3 y3 z3]
 	* @details	File extension : txt, ply
+	* @details	PLY files are memory-mapped into shared vertices and an index buffer.
 	* @param	ext				File extension
 	* @return bool return false : Failed to load mesh data
 	*			   return true : Success to load mesh data
@@ -201,6 +221,17 @@ public:
 
 	void reconTest(const char* fname);
 
+	/**
+	* @brief Flat-shaded holograms and angular spectra over a sweep of carrier waves.
+	* @details The normals, validity and geometry of the faces are computed once for the whole sweep.
+	*	Carriers are computed in parallel, one per thread, and the images are written by a saver thread.
+	*	Saves dirName/holo_fx,fy.bmp and dirName/AS_fx,fy.bmp for every carrier.
+	* @param dirName : output directory
+	* @param ENCODE_METHOD : encoding method of the holograms
+	* @param cenFx, cenFy : center spatial frequency of the carriers
+	* @param rangeFx, rangeFy : range of the spatial frequency
+	* @param stepFx, stepFy : step of the spatial frequency
+	*/
 	void triTimeMultiplexing(char* dirName, uint ENCODE_METHOD, Real cenFx, Real cenFy, Real rangeFx, Real rangeFy, Real stepFx, Real stepFy);
 
 	/**
@@ -214,6 +245,69 @@ public:
 	*/
 	void setViewingWindow(bool is_ViewingWindow);
 
+	/**
+	* @brief Set the face-parallel mode of the CPU generation.
+	* @details In the face-parallel mode every OpenMP thread takes whole faces with its own working
+	*	buffers and accumulates them into a private angular spectrum, and the accumulators are summed
+	*	at the end. It avoids a fork/join per face on meshes of many small faces, at the cost of
+	*	about six hologram-sized buffers per thread. Not used with occlusion, whose faces depend on
+	*	the order of accumulation.
+	* @param bFaceParallel : true to synthesize the faces in parallel
+	*/
+	void setFaceParallel(bool bFaceParallel) { m_bFaceParallel = bFaceParallel; }
+	bool isFaceParallel(void) { return m_bFaceParallel; }
+
+	/**
+	* @brief Set the spectral-support culling of the flat-shaded faces.
+	* @details Each frequency sample of a face is bounded by an envelope of the reference triangle
+	*	spectrum, and samples whose bound carries less than the threshold of the peak energy are
+	*	skipped. The envelope is an upper bound, so the error of a skipped sample never exceeds it.
+	*	Not used with random phase, per-face occlusion or texture mapping, which spread the spectrum.
+	* @param threshold : relative energy threshold, 0 to evaluate every sample
+	*/
+	void setSpectralCulling(Real threshold) { m_dCullThreshold = threshold; }
+	Real getSpectralCulling(void) { return m_dCullThreshold; }
+
+	/**
+	* @brief Set the depth-slab occlusion of the mesh.
+	* @details The depth-sorted faces are grouped into slabs of the given thickness. Before the faces
+	*	of a slab are added, the field behind them is propagated to the slab plane, masked by the union
+	*	of their silhouettes and propagated back, so a slab costs two FFTs instead of the three of every
+	*	face in the per-face mode. Faces of the same slab do not occlude each other.
+	* @param thickness : slab thickness [m], 0 for the per-face occlusion
+	*/
+	void setOcclusionSlab(Real thickness) { m_dSlabThickness = thickness; }
+	Real getOcclusionSlab(void) { return m_dSlabThickness; }
+
+	/**
+	* @brief Set the level-of-detail collapse of small faces into point sources.
+	* @details Faces whose projected bounding box is smaller than the given number of pixel pitches
+	*	are replaced by a point source at their centroid, with the area, shading and carrier phase of
+	*	the face. The depth extent of a face counts as the lateral size of the same dephasing at the
+	*	band edge. The point sources are accumulated by a kernel separable in x and y, per depth bin,
+	*	and the other faces keep the analytic spectrum.
+	*	Not used with random phase, occlusion or texture mapping.
+	* @param size : projected face size [pixel pitch], 0 to evaluate every face analytically
+	*/
+	void setPointLOD(Real size) { m_dPointLOD = size; }
+	Real getPointLOD(void) { return m_dPointLOD; }
+
+	/**
+	* @brief Set the tabulated reference triangle spectrum of the flat shading.
+	* @details The spectrum of the reference triangle is sampled once on a grid of the frequency
+	*	terms and interpolated bilinearly for every face, instead of evaluated analytically. The
+	*	interpolation error stays below 3.3 / resolution^2 of the DC value, and frequency terms
+	*	outside the range fall back to the analytic spectrum. The table holds
+	*	(2 range resolution + 1)^2 complex samples. With texture mapping, the table holds the
+	*	spectrum convolved with the texture spectrum, and its step is rounded down to divide the
+	*	texture frequency.
+	* @param range : half width of the table in frequency terms [cycles / reference triangle], 0 : off
+	* @param resolution : samples per unit of the frequency terms
+	*/
+	void setSpectrumTable(Real range, int resolution) { m_dTableRange = range; m_nTableResolution = resolution; }
+	Real getSpectrumTableRange(void) { return m_dTableRange; }
+	int getSpectrumTableResolution(void) { return m_nTableResolution; }
+
 	uint* getProgress() { return &m_nProgress; }
 private:
 
@@ -232,15 +326,77 @@ private:
 	* @param[in] lambda : wave length
 	*/
 	void calGlobalFrequency(Point* frequency, Real lambda);
-	bool calFrequencyTerm(Point* frequency, Point* fl, Real* freqTermX, Real* freqTermY, geometric& geom, Real lambda);
+	bool calFrequencyTerm(Point* frequency, Point* fl, Real* freqTermX, Real* freqTermY, geometric& geom, Real lambda, const Real* carrier);
 	bool calFrequencyTerm(Real** frequency, Real** fl, Real* freqTermX, Real* freqTermY, geometric& geom);
-	void refAS_Flat(vec3 na, Point* frequency, Face mesh, Real* freqTermX, Real* freqTermY, geometric& geom, Real lambda);
-	void refASInner_flat(Real* freqTermX, Real* freqTermY);
-	bool refAS_Continuous(uint n, Real* freqTermX, Real* freqTermY);
+	void refAS_Flat(vec3 na, Point* frequency, Face mesh, geometric& geom, Real lambda, TriWork& work);
+	void refASInner_flat(Real* freqTermX, Real* freqTermY, Complex<Real>* refAS);
+	bool refAS_Continuous(uint n, TriWork& work);
 	bool generateAS(uint SHADING_FLAG);
+
+	/**
+	* @brief Accumulate the faces of the cache slab by slab, occluding the field behind each slab.
+	* @see setOcclusionSlab
+	*/
+	bool generateSlabAS(uint SHADING_FLAG, Point* frequency, Real lambda, Complex<Real>* dst, TriWork& work);
+
+	/**
+	* @brief Rasterize the union of the silhouettes of the cached faces [begin, end) on the hologram grid.
+	* @return false if no pixel is covered
+	*/
+	bool rasterizeSilhouette(int begin, int end, uchar* mask);
+	bool isFaceOcclusion(void) { return occlusion && m_dSlabThickness <= 0; }
+
+	/**
+	* @brief Accumulate the faces collapsed into point sources.
+	* @details Within a depth bin the axial phase of a point is expanded to second order in the
+	*	lateral frequency, which makes its spectrum separable; the bin thickness bounds the error.
+	* @see setPointLOD
+	*/
+	bool calPointAS(uint SHADING_FLAG, Point* frequency, Real lambda, const Real* carrier, Complex<Real>* dst);
+	vec3 calVertexShading(uint n);
+
+	/**
+	* @brief Accumulate the angular spectrum of one face.
+	* @param[in] face : index of the face cache
+	* @param[in] frequency : global frequency of the channel
+	* @param[in] lambda : wave length
+	* @param[out] dst : angular spectrum accumulator
+	* @param work : working buffers of the calling thread
+	* @return false if the face does not contribute
+	*/
+	bool calFaceAS(int face, uint SHADING_FLAG, Point* frequency, Real lambda, Complex<Real>* dst, TriWork& work);
+	Complex<Real> calShadingFactor(vec3 no, geometric& geom, Real lambda, const Real* carrier);
+
+	/**
+	* @brief Cache the valid faces and their geometrical relations, which do not depend on the carrier.
+	* @details Requires the normals of findNormals.
+	*/
+	void buildFaceCache();
+	void releaseFaceCache();
+
+	/**
+	* @brief Sample the reference triangle spectrum on the grid of setSpectrumTable.
+	* @return false if the table is off
+	*/
+	bool buildSpectrumTable();
+
+	/**
+	* @brief Tabulate the reference spectrum convolved with the texture spectrum.
+	* @details With a grid step that divides the texture frequency, the convolution on the grid is
+	*	a discrete one, computed by zero-padded FFTs once for all faces.
+	*/
+	bool buildTextureTable();
+
+	/**
+	* @brief Flat-shaded face accumulated only where its spectrum exceeds the culling threshold.
+	* @see setSpectralCulling
+	*/
+	bool refAS_FlatCulled(vec3 no, Point* frequency, geometric& geom, Real lambda, Complex<Real>* dst, TriWork& work);
+	void allocWork(TriWork& work, bool bAccumulate);
+	void releaseWork(TriWork& work);
 	bool findNormals(uint SHADING_FLAG);
-	bool refToGlobal(Complex<Real> *dst, Point* frequency, Point* fl, geometric& geom);
-	bool refToGlobal(Real** frequency, Real** fl, geometric& geom);
+	bool refToGlobal(Complex<Real> *dst, Complex<Real>* refAS, Point* frequency, Point* fl, geometric& geom);
+	bool refToGlobal(Complex<Real>* refAS, Real** frequency, Real** fl, geometric& geom);
 	
 	bool loadMeshText(const char* fileName);
 
@@ -260,20 +416,34 @@ private:
 	vec3* nv;
 
 	Complex<Real>* angularSpectrum;			/// Angular spectrum of the hologram
-	Complex<Real>* refAS;
 
 	/// occlusion
 	Complex<Real>* rearAS;
-	Complex<Real>* convol;
 
 	/// random phase
 	Complex<Real>* phaseTerm;
 
+	/// convolution with the cached spectrum of phaseTerm
+	ophConvolution m_conv;
+
+	/// carrier-independent face cache
+	vector<int> m_vecFaceIdx;				/// valid faces
+	vector<geometric> m_vecFaceGeom;		/// geometrical relations of the valid faces
+	vector<int> m_vecPointIdx;				/// valid faces collapsed into point sources
+	vector<geometric> m_vecPointGeom;		/// geometrical relations of the point sources
+	vector<Complex<Real>> m_vecRefTable;	/// tabulated reference triangle spectrum
+	vector<uint> m_vecFaceVertex;			/// shared vertex indices of scaledMeshData, 3 per face
+
 	bool is_ViewingWindow;
+	bool m_bFaceParallel;					/// synthesize the faces in parallel on the CPU
+	Real m_dCullThreshold;					/// relative energy threshold of the spectral culling
+	Real m_dSlabThickness;					/// depth-slab thickness of the occlusion, 0 : per face
+	Real m_dPointLOD;						/// projected size of the faces collapsed into point sources [pixel pitch]
+	Real m_dTableRange;						/// half width of the spectrum table, 0 : analytic spectrum
+	int m_nTableResolution;					/// samples per unit frequency term of the spectrum table
+	Real m_dTableStep;						/// sample step of the built spectrum table
 
 	OphMeshData* meshData;					/// OphMeshData type data structure pointer
-	Real* tempFreqTermX;
-	Real* tempFreqTermY;
 
 	// calGlobalFrequency()
 	Real dfx, dfy;
@@ -295,23 +465,8 @@ private:
 	Real* invLoRot;
 
 
-	// refAS_Flat() , refAS_Continuous()
-
-	Complex<Real> refTerm1;
-	Complex<Real> refTerm2;
-	Complex<Real> refTerm3;
-
-
-
-	/// continuous shading
-	vec3 av;
-
-
 	/// texture mapping
 	Complex<Real>* textFFT;
-	Real textFreqX;
-	Real textFreqY;
-	Complex<Real> refTemp;
 	uint m_nProgress;
 	const char* meshDataFileName;
 
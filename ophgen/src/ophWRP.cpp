@@ -47,9 +47,28 @@
 #include "sys.h"
 #include "tinyxml2.h"
 
+#define WRP_TILE 64 ///< edge of the WRP tiles, in pixels, each accumulated by a single thread
+
+namespace
+{
+	/// A point as recorded on the WRP: its pixel, clipped window, distance and complex amplitude.
+	struct WRPPoint
+	{
+		int x, y;
+		int beginX, endX;
+		int beginY, endY;
+		Real dz;
+		Complex<Real> amplitude;
+	};
+}
+
 ophWRP::ophWRP(void)
 	: ophGen()
 	, scaledVertex(nullptr)
+	, zmax_(0.0)
+	, zmin_(0.0)
+	, m_pWRPList(nullptr)
+	, m_nWRPList(0)
 {
 	n_points = -1;
 	p_wrp_ = nullptr;
@@ -89,7 +108,8 @@ void ophWRP::autoScaling()
 	vec3 scale = wrp_config_.scale;
 
 #if 1
-	zmax_ = MIN_DOUBLE;
+	zmax_ = -MAX_DOUBLE;
+	zmin_ = MAX_DOUBLE;
 	for (int i = 0; i < n_points; i++)
 	{
 		scaledVertex[i].point.pos[_X] = scaledVertex[i].point.pos[_X] * scale[_X];
@@ -97,6 +117,7 @@ void ophWRP::autoScaling()
 		scaledVertex[i].point.pos[_Z] = scaledVertex[i].point.pos[_Z] * scale[_Z];
 
 		if (zmax_ < scaledVertex[i].point.pos[_Z]) zmax_ = scaledVertex[i].point.pos[_Z];
+		if (zmin_ > scaledVertex[i].point.pos[_Z]) zmin_ = scaledVertex[i].point.pos[_Z];
 	}
 #else
 
@@ -122,6 +143,21 @@ void ophWRP::autoScaling()
 	}
 
 #endif
+
+	// the random phase of every point is drawn once, from a single generator,
+	// and shared by all channels, slabs and tiles.
+	m_vecRandPhase.clear();
+	if (GetRandomPhase())
+	{
+		std::mt19937_64 rand_dev(CUR_TIME_DURATION_MILLI_SEC);
+		std::uniform_real_distribution<Real> dist(0.0, 1.0);
+		m_vecRandPhase.resize(n_points);
+		for (int i = 0; i < n_points; i++)
+		{
+			m_vecRandPhase[i] = Complex<Real>(0, 2 * M_PI * dist(rand_dev));
+			m_vecRandPhase[i].exp();
+		}
+	}
 	LOG("%lf (s)\n", ELAPSED_TIME(begin, CUR_TIME));
 }
 
@@ -221,117 +257,149 @@ bool ophWRP::readConfig(const char* fname)
 	return bRet;
 }
 
-void ophWRP::addPixel2WRP(int x, int y, Complex<Real> temp)
+void ophWRP::calSubWRP(Real wrp_d, Complex<Real>* wrp, const int* index, int count, uint ch)
 {
-	const uint pnX = context_.pixel_number[_X];
-	const uint pnY = context_.pixel_number[_Y];
+	const int pnX = context_.pixel_number[_X];
+	const int pnY = context_.pixel_number[_Y];
+	const Real ppX = context_.pixel_pitch[_X];
+	const Real ppY = context_.pixel_pitch[_Y];
+	const Real lambda = context_.wave_length[ch];
+	const Real k = 2 * M_PI / lambda;
+	const int hpnX = pnX >> 1;
+	const int hpnY = pnY >> 1;
+	const int nTileX = (pnX + WRP_TILE - 1) / WRP_TILE;
+	const int nTileY = (pnY + WRP_TILE - 1) / WRP_TILE;
+	const int nTile = nTileX * nTileY;
+
+	// the active area of a point spans the maximum diffraction angle of the pixel pitch,
+	// beyond it the spherical wave would alias on the WRP.
+	const Real sinX = lambda / (2 * ppX);
+	const Real sinY = lambda / (2 * ppY);
+	const Real tanX = (sinX < 1) ? sinX / sqrt(1 - sinX * sinX) : MAX_DOUBLE;
+	const Real tanY = (sinY < 1) ? sinY / sqrt(1 - sinY * sinY) : MAX_DOUBLE;
+
+	vector<WRPPoint> point(count);
+	const bool bRandomPhase = !m_vecRandPhase.empty();
 
-	if (x >= 0 && x < (int)pnX && y >= 0 && y < (int)pnY) {
-		uint adr = x + y * pnX;
-		if (adr == 0) 
-			std::cout << ".0";
-		p_wrp_[adr] = p_wrp_[adr] + temp;
+#ifdef _OPENMP
+#pragma omp parallel for firstprivate(pnX, pnY, ppX, ppY, hpnX, hpnY, wrp_d, tanX, tanY, bRandomPhase)
+#endif
+	for (int i = 0; i < count; i++)
+	{
+		const int idx = index[i];
+		WRPPoint& pt = point[i];
+		Real dz = wrp_d - scaledVertex[idx].point.pos[_Z];
+		int wX = (int)(std::min)(fabs(dz) * tanX / ppX, (Real)pnX);
+		int wY = (int)(std::min)(fabs(dz) * tanY / ppY, (Real)pnY);
+
+		pt.dz = dz;
+		pt.amplitude = bRandomPhase ? m_vecRandPhase[idx] : Complex<Real>(1, 0);
+		pt.amplitude *= obj_.vertices[idx].color.color[_R + ch];
+		pt.x = (int)(scaledVertex[idx].point.pos[_X] / ppX) + hpnX;
+		pt.y = (int)(scaledVertex[idx].point.pos[_Y] / ppY) + hpnY;
+		pt.beginX = (std::max)(pt.x - wX, 0);
+		pt.endX = (std::min)(pt.x + wX + 1, pnX);
+		pt.beginY = (std::max)(pt.y - wY, 0);
+		pt.endY = (std::min)(pt.y + wY + 1, pnY);
 	}
 
-}
-
-void ophWRP::addPixel2WRP(int x, int y, oph::Complex<Real> temp, oph::Complex<Real>* wrp)
-{
-	long long int Nx = context_.pixel_number.v[0];
-	long long int Ny = context_.pixel_number.v[1];
-
-	if (x >= 0 && x < Nx && y >= 0 && y < Ny) {
-		long long int adr = x + y*Nx;
-		wrp[adr] += temp[adr];
+	// bin the points by the tiles their windows overlap, so that every tile is written by one thread only.
+	vector<int> tileOffset(nTile + 1, 0);
+	for (int i = 0; i < count; i++)
+	{
+		const WRPPoint& pt = point[i];
+		if (pt.beginX >= pt.endX || pt.beginY >= pt.endY) continue;
+		for (int ty = pt.beginY / WRP_TILE; ty <= (pt.endY - 1) / WRP_TILE; ty++)
+			for (int tx = pt.beginX / WRP_TILE; tx <= (pt.endX - 1) / WRP_TILE; tx++)
+				tileOffset[ty * nTileX + tx + 1]++;
 	}
-}
-
-oph::Complex<Real>* ophWRP::calSubWRP(double wrp_d, Complex<Real>* wrp, OphPointCloudData* pc)
-{
-
-	Real wave_num = context_.k;   // wave_number
-	Real wave_len = context_.wave_length[0];  //wave_length
-
-	int Nx = context_.pixel_number.v[0]; //slm_pixelNumberX
-	int Ny = context_.pixel_number.v[1]; //slm_pixelNumberY
-
-	Real wpx = context_.pixel_pitch.v[0];//wrp pitch
-	Real wpy = context_.pixel_pitch.v[1];
-
-
-	int Nx_h = Nx >> 1;
-	int Ny_h = Ny >> 1;
-
-	int num = n_points;
+	for (int t = 0; t < nTile; t++)
+		tileOffset[t + 1] += tileOffset[t];
 
+	vector<int> tilePoint(tileOffset[nTile]);
+	vector<int> pos(tileOffset.begin(), tileOffset.end() - 1);
+	for (int i = 0; i < count; i++)
+	{
+		const WRPPoint& pt = point[i];
+		if (pt.beginX >= pt.endX || pt.beginY >= pt.endY) continue;
+		for (int ty = pt.beginY / WRP_TILE; ty <= (pt.endY - 1) / WRP_TILE; ty++)
+			for (int tx = pt.beginX / WRP_TILE; tx <= (pt.endX - 1) / WRP_TILE; tx++)
+				tilePoint[pos[ty * nTileX + tx]++] = i;
+	}
 
 #ifdef _OPENMP
-#pragma omp parallel for firstprivate(wrp_d, wpx, wpy, Nx_h, Ny_h, wave_num, wave_len)
+#pragma omp parallel for schedule(dynamic) firstprivate(pnX, pnY, ppX, ppY, k, nTileX)
 #endif
-	for (int k = 0; k < num; k++) {
-
-		uint idx = 3 * k;
-		uint color_idx = pc->n_colors * k;
-
-		Real x = pc->vertices[k].point.pos[_X];
-		Real y = pc->vertices[k].point.pos[_Y];
-		Real z = pc->vertices[k].point.pos[_Z];
-		Real amplitude = pc->vertices[k].color.color[_R];
-
-		float dz = wrp_d - z;
-		//	float tw = (int)fabs(wave_len*dz / wpx / wpx / 2 + 0.5) * 2 - 1;
-		float tw = fabs(dz)*wave_len / wpx / wpx / 2;
-
-		int w = (int)tw;
-
-		int tx = (int)(x / wpx) + Nx_h;
-		int ty = (int)(y / wpy) + Ny_h;
-
-		printf("num=%d, tx=%d, ty=%d, w=%d\n", k, tx, ty, w);
-
-		for (int wy = -w; wy < w; wy++) {
-			for (int wx = -w; wx<w; wx++) {//WRP coordinate
-
-				double dx = wx*wpx;
-				double dy = wy*wpy;
-				double dz = wrp_d - z;
-
-				double sign = (dz>0.0) ? (1.0) : (-1.0);
-				double r = sign*sqrt(dx*dx + dy*dy + dz*dz);
+	for (int t = 0; t < nTile; t++)
+	{
+		const int tileX = (t % nTileX) * WRP_TILE;
+		const int tileY = (t / nTileX) * WRP_TILE;
 
-				//double tmp_re,tmp_im;
-				Complex<Real> tmp;
+		for (int n = tileOffset[t]; n < tileOffset[t + 1]; n++)
+		{
+			const WRPPoint& pt = point[tilePoint[n]];
+			const Real dzz = pt.dz * pt.dz;
+			const bool sign = (pt.dz > 0.0) ? true : false;
+			const int beginX = (std::max)(pt.beginX, tileX), endX = (std::min)(pt.endX, tileX + WRP_TILE);
+			const int beginY = (std::max)(pt.beginY, tileY), endY = (std::min)(pt.endY, tileY + WRP_TILE);
 
-				tmp[_RE] = (amplitude*cosf(wave_num*r)*cosf(wave_num*wave_len*rand(0, 1))) / (r + 0.05);
-				tmp[_IM] = (-amplitude*sinf(wave_num*r)*sinf(wave_num*wave_len*rand(0, 1))) / (r + 0.05);
+			for (int y = beginY; y < endY; y++)
+			{
+				Real dy = (y - pt.y) * ppY;
+				Real dyy = dy * dy;
+				Complex<Real>* row = wrp + (long long int)y * pnX;
 
-				if (tx + wx >= 0 && tx + wx < Nx && ty + wy >= 0 && ty + wy < Ny)
+				for (int x = beginX; x < endX; x++) //WRP coordinate
 				{
-					addPixel2WRP(wx + tx, wy + ty, tmp, wrp);
+					Real dx = (x - pt.x) * ppX;
+					Real r = sqrt(dx * dx + dyy + dzz);
+					if (r == 0) continue; // a point on the WRP itself has no wavefront to sample
+					Real kr = sign ? k * r : -k * r;
+					Complex<Real> tmp(cos(kr) / r, sin(kr) / r);
+					row[x] += tmp * pt.amplitude;
 				}
 			}
 		}
 	}
-
-	return wrp;
 }
 
 void ophWRP::calculateWRPCPU()
+{
+	calculateWRPCPU(0, n_points);
+
+	delete[] scaledVertex;
+	scaledVertex = nullptr;
+}
+
+bool ophWRP::prepareTiles(uint /*flag*/)
+{
+	if (n_points <= 0)
+		return false;
+
+	resetBuffer();
+	autoScaling();
+	return true;
+}
+
+bool ophWRP::generateTiles(uint begin, uint end)
+{
+	if (end <= begin || end > (uint)n_points || scaledVertex == nullptr)
+		return false;
+
+	wrp_config_.num_wrp > 1 ? calculateMWRPCPU(begin, end) : calculateWRPCPU(begin, end);
+	return true;
+}
+
+void ophWRP::calculateWRPCPU(int start, int end)
 {
 	LOG("%s\n", __FUNCTION__);
 	auto begin = CUR_TIME;
 
 	const int pnX = context_.pixel_number[_X]; //slm_pixelNumberX
 	const int pnY = context_.pixel_number[_Y]; //slm_pixelNumberY
-	const Real ppX = context_.pixel_pitch[_X]; //wrp pitch
-	const Real ppY = context_.pixel_pitch[_Y];
 	const long long int N = pnX * pnY;
 	const uint nChannel = context_.waveNum;
 	const Real distance = wrp_config_.propagation_distance;
-	int hpnX = pnX >> 1;
-	int hpnY = pnY >> 1;
-
-	OphPointCloudData pc = obj_;
 	Real wrp_d = wrp_config_.wrp_location;
 
 	// Memory Location for Result Image
@@ -342,93 +410,33 @@ void ophWRP::calculateWRPCPU()
 	}
 	p_wrp_ = new Complex<Real>[N];
 	memset(p_wrp_, 0.0, sizeof(Complex<Real>) * N);
-	
-	int sum = 0;
-	m_nProgress = 0;
-	Real ppXX = ppX * ppX * 2;
-	Real pi2 = 2 * M_PI;
-	Real dz = wrp_d - zmax_;
-	Real dzz = dz * dz;
 
-	bool bRandomPhase = GetRandomPhase();
+	vector<int> index(end - start);
+	for (int i = start; i < end; i++)
+		index[i - start] = i;
+
+	m_nProgress = 0;
 
 	for (uint ch = 0; ch < nChannel; ch++)
 	{
-		Real lambda = context_.wave_length[ch];  //wave_length
-		Real k = context_.k = pi2 / lambda;
-		int iColor = ch;
-		int sum = 0;
-#ifdef _OPENMP
-#pragma omp parallel for firstprivate(iColor, ppXX, pnX, pnY, ppX, ppY, hpnX, hpnY, wrp_d, k, pi2, dz, dzz)
-#endif
-		for (int i = 0; i < n_points; ++i)
-		{
-			uint idx = 3 * i;
-			uint color_idx = pc.n_colors * i;
-
-			Real x = scaledVertex[i].point.pos[_X];
-			Real y = scaledVertex[i].point.pos[_Y];
-			Real z = scaledVertex[i].point.pos[_Z];
-			Real amplitude = pc.vertices[i].color.color[_R + ch];
-
-			//Real dz = wrp_d - z;
-			//Real dzz = dz * dz;
-			bool sign = (dz > 0.0) ? true : false;
-			//Real tw = fabs(lambda * dz / ppXX + 0.5) * 2 - 1;
-			Real tw = fabs(lambda * dz / ppXX) * 2;
-
-			int w = (int)tw;
-
-			int tx = (int)(x / ppX) + hpnX;
-			int ty = (int)(y / ppY) + hpnY;
-
-			for (int wy = -w; wy < w; wy++)
-			{
-				Real dy = wy * ppY;
-				Real dyy = dy * dy;
-				int tmpY = wy + ty;
-				int baseY = tmpY * pnX;
+		// every point is windowed and phased with its own distance to the WRP.
+		calSubWRP(wrp_d, p_wrp_, index.data(), end - start, ch);
 
-				for (int wx = -w; wx < w; wx++) //WRP coordinate
-				{
-					int tmpX = wx + tx;
-					if (tmpX >= 0 && tmpX < pnX && tmpY >= 0 && tmpY < pnY) {
-						uint adr = tmpX + baseY;
-
-						Real dx = wx * ppX;
-						Real r = sign ? sqrt(dx * dx + dyy + dzz) : -sqrt(dx * dx + dyy + dzz);
-						Real kr = k * r;
-						Real randVal = bRandomPhase ? rand(0.0, 1.0) : 1.0;
-						Real randpi2 = pi2 * randVal;
-						Complex<Real> tmp;
-						tmp[_RE] = (amplitude * cos(kr) * cos(randpi2)) / r;
-						tmp[_IM] = (-amplitude * sin(kr) * sin(randpi2)) / r;
-
-						if (adr == 0)
-							std::cout << ".0";
+		// propagated in place and added, complex_H keeps the points of earlier tiles.
+		fresnelPropagation(p_wrp_, p_wrp_, distance, ch);
+		Complex<Real>* holo = complex_H[ch];
 #ifdef _OPENMP
-#pragma omp atomic
-						p_wrp_[adr][_RE] += tmp[_RE];
-#pragma omp atomic
-						p_wrp_[adr][_IM] += tmp[_IM];
-#else
-						p_wrp_[adr] += tmp;
-#endif						
-					}
-				}
-			}
-		}
-		fresnelPropagation(p_wrp_, complex_H[ch], distance, ch);
+#pragma omp parallel for
+#endif
+		for (int i = 0; i < N; i++)
+			holo[i] += p_wrp_[i];
 		memset(p_wrp_, 0.0, sizeof(Complex<Real>) * N);
+		m_nProgress = (ch + 1) * 100 / nChannel;
 	}
 	delete[] p_wrp_;
-	delete[] scaledVertex;
 	p_wrp_ = nullptr;
-	scaledVertex = nullptr;
 
 	LOG("Total : %lf (s)\n", ELAPSED_TIME(begin, CUR_TIME));
-
-	//return 0.;
 }
 
 void ophWRP::generateHologram(void)
@@ -450,45 +458,192 @@ void ophWRP::generateHologram(void)
 	LOG("3) Random Phase Use : %s\n", GetRandomPhase() ? "Y" : "N");
 	LOG("4) Number of Point Cloud : %d\n", n_points);
 	LOG("5) Precision Level : %s\n", m_mode & MODE_FLOAT ? "Single" : "Double");
+	LOG("6) Number of WRP : %d\n", wrp_config_.num_wrp);
 	if (m_mode & MODE_GPU)
-		LOG("6) Use FastMath : %s\n", m_mode & MODE_FASTMATH ? "Y" : "N");
+		LOG("7) Use FastMath : %s\n", m_mode & MODE_FASTMATH ? "Y" : "N");
 	LOG("**************************************************\n");
 	
 	autoScaling();
-	m_mode & MODE_GPU ? calculateWRPGPU() : calculateWRPCPU();
+	if (wrp_config_.num_wrp > 1)
+	{
+		if (m_mode & MODE_GPU)
+			LOG("Multiple WRP is generated on the CPU.\n");
+		calculateMWRPCPU();
+	}
+	else
+		m_mode & MODE_GPU ? calculateWRPGPU() : calculateWRPCPU();
 
 	fftFree();
 	LOG("Total Elapsed Time: %lf (s)\n", ELAPSED_TIME(begin, CUR_TIME));
 }
 
-Complex<Real>** ophWRP::calculateMWRP(void)
+void ophWRP::partitionMWRP(int start, int end)
+{
+	const int nWRP = wrp_config_.num_wrp;
+	// every WRP keeps the distance of the single WRP from the front of its slab.
+	const Real gap = wrp_config_.wrp_location - zmax_;
+	const Real depth = (zmax_ - zmin_) / nWRP;
+
+	m_vecWRPLocation.resize(nWRP);
+	for (int s = 0; s < nWRP; s++)
+		m_vecWRPLocation[s] = zmin_ + depth * (s + 1) + gap;
+	m_vecWRPLocation[nWRP - 1] = wrp_config_.wrp_location;
+
+	auto slabOf = [&](int i) {
+		return (depth > 0) ? (std::min)((int)((scaledVertex[i].point.pos[_Z] - zmin_) / depth), nWRP - 1) : nWRP - 1;
+	};
+
+	// slabs holding any point of the scene; every tile chains through the same planes,
+	// so that the tiles add up to the hologram of the whole scene.
+	m_vecWRPUsed.assign(nWRP, 0);
+	for (int i = 0; i < n_points; i++)
+		m_vecWRPUsed[slabOf(i)] = 1;
+
+	// counting sort of the points by slab, the deepest slab first.
+	vector<int> slab(end - start);
+	m_vecWRPOffset.assign(nWRP + 1, 0);
+	for (int i = start; i < end; i++)
+	{
+		int s = slabOf(i);
+		slab[i - start] = s;
+		m_vecWRPOffset[s + 1]++;
+	}
+	for (int s = 0; s < nWRP; s++)
+		m_vecWRPOffset[s + 1] += m_vecWRPOffset[s];
+
+	vector<int> pos(m_vecWRPOffset.begin(), m_vecWRPOffset.end() - 1);
+	m_vecWRPIndex.resize(end - start);
+	for (int i = start; i < end; i++)
+		m_vecWRPIndex[pos[slab[i - start]]++] = i;
+}
+
+void ophWRP::recordMWRP(uint ch)
 {
-	int wrp_num = wrp_config_.num_wrp;
+	const int nWRP = wrp_config_.num_wrp;
+	const long long int N = context_.pixel_number[_X] * context_.pixel_number[_Y];
+
+	if (m_nWRPList != nWRP)
+	{
+		releaseMWRP();
+		m_pWRPList = new Complex<Real>*[nWRP];
+		for (int s = 0; s < nWRP; s++)
+			m_pWRPList[s] = new Complex<Real>[N];
+		m_nWRPList = nWRP;
+	}
+	for (int s = 0; s < nWRP; s++)
+		memset(m_pWRPList[s], 0, sizeof(Complex<Real>) * N);
+
+	// with a slab per thread the planes are recorded concurrently,
+	// otherwise one after another with the points of the slab split across threads.
+#ifdef _OPENMP
+	if (nWRP >= omp_get_max_threads())
+	{
+#pragma omp parallel for schedule(dynamic)
+		for (int s = 0; s < nWRP; s++)
+		{
+			calSubWRP(m_vecWRPLocation[s], m_pWRPList[s], m_vecWRPIndex.data() + m_vecWRPOffset[s],
+				m_vecWRPOffset[s + 1] - m_vecWRPOffset[s], ch);
+		}
+		return;
+	}
+#endif
+	for (int s = 0; s < nWRP; s++)
+	{
+		calSubWRP(m_vecWRPLocation[s], m_pWRPList[s], m_vecWRPIndex.data() + m_vecWRPOffset[s],
+			m_vecWRPOffset[s + 1] - m_vecWRPOffset[s], ch);
+	}
+}
 
-	if (wrp_num < 1)
+Complex<Real>** ophWRP::calculateMWRP(uint ch)
+{
+	if (wrp_config_.num_wrp < 1 || n_points <= 0 || ch >= context_.waveNum)
 		return nullptr;
 
-	Complex<Real>** wrp_list = nullptr;
+	if (scaledVertex == nullptr)
+		autoScaling();
+
+	partitionMWRP(0, n_points);
+	recordMWRP(ch);
+
+	return m_pWRPList;
+}
+
+void ophWRP::calculateMWRPCPU(void)
+{
+	calculateMWRPCPU(0, n_points);
 
-	Real k = context_.k;   // wave_number
-	Real lambda = context_.wave_length[0];  //wave_length
-	const long long int pnXY = context_.pixel_number[_X] * context_.pixel_number[_Y];
+	delete[] scaledVertex;
+	scaledVertex = nullptr;
+}
+
+void ophWRP::calculateMWRPCPU(int start, int end)
+{
+	LOG("%s\n", __FUNCTION__);
+	auto begin = CUR_TIME;
 
-	Complex<Real>* wrp = new Complex<Real>[pnXY];
+	const int nWRP = wrp_config_.num_wrp;
+	const long long int N = context_.pixel_number[_X] * context_.pixel_number[_Y];
+	const uint nChannel = context_.waveNum;
+	const Real holo_d = wrp_config_.wrp_location + wrp_config_.propagation_distance;
 
-	//OphPointCloudData pc = obj_;
+	partitionMWRP(start, end);
+	m_nProgress = 0;
 
-	for (int i = 0; i < wrp_num; i++)
+	for (uint ch = 0; ch < nChannel; ch++)
 	{
-//		wrp = calSubWRP(wrp_d, wrp, &pc);
-		wrp_list[i] = wrp;
+		recordMWRP(ch);
+
+		// carry the field from the deepest plane forward; slabs empty in the whole scene are stepped over,
+		// as are the planes in front of the first one recorded here, whose field is still zero.
+		Complex<Real>* field = nullptr;
+		Real field_d = 0;
+		for (int s = 0; s < nWRP; s++)
+		{
+			if (!m_vecWRPUsed[s] || (!field && m_vecWRPOffset[s + 1] == m_vecWRPOffset[s]))
+				continue;
+			Complex<Real>* wrp = m_pWRPList[s];
+			if (field)
+			{
+				fresnelPropagation(field, field, m_vecWRPLocation[s] - field_d, ch);
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+				for (int i = 0; i < N; i++)
+					wrp[i] += field[i];
+			}
+			field = wrp;
+			field_d = m_vecWRPLocation[s];
+		}
+		if (field)
+		{
+			// propagated in place and added, complex_H keeps the points of earlier tiles.
+			fresnelPropagation(field, field, holo_d - field_d, ch);
+			Complex<Real>* holo = complex_H[ch];
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+			for (int i = 0; i < N; i++)
+				holo[i] += field[i];
+		}
+		m_nProgress = (ch + 1) * 100 / nChannel;
 	}
+	releaseMWRP();
 
-	return wrp_list;
+	LOG("Total : %lf (s)\n", ELAPSED_TIME(begin, CUR_TIME));
+}
+
+void ophWRP::releaseMWRP(void)
+{
+	for (int s = 0; s < m_nWRPList; s++)
+		delete[] m_pWRPList[s];
+	delete[] m_pWRPList;
+	m_pWRPList = nullptr;
+	m_nWRPList = 0;
 }
 
 void ophWRP::ophFree(void)
 {
+	releaseMWRP();
 	if (obj_.vertices) {
 		delete[] obj_.vertices;
 		obj_.vertices = nullptr;
@@ -160,6 +160,17 @@ public:
 	void calculateWRPCPU(void);
 	void calculateWRPGPU(void);
 
+	/**
+	* @brief Tile-distributed generation splits the point cloud.
+	* @see ophDistributed
+	*/
+	virtual uint getTileUnits(void) { return n_points > 0 ? n_points : 0; }
+	virtual bool prepareTiles(uint flag);
+	/**
+	* @brief Record the points [begin, end) on the WRP and propagate it to the hologram on the CPU.
+	*/
+	virtual bool generateTiles(uint begin, uint end);
+
 //	virtual void fresnelPropagation(Complex<Real>* in, Complex<Real>* out, Real distance);
 
 	/**
@@ -169,9 +180,24 @@ public:
 	void generateHologram(void);
 	/**
 	* @brief Generate multiple wavefront recording planes, main funtion.
-	* @return multiple WRP (sec)
+	* @details The depth range of the point cloud is split into getNumOfWRP() slabs of equal depth.
+	* Each slab is recorded on its own WRP, placed in front of the slab at the same distance
+	* the single WRP keeps from the nearest point, so the active area of a slab only spans its own depth.
+	* @param[in] ch Index of the wavelength.
+	* @return Array of getNumOfWRP() planes ordered from the deepest slab, owned by ophWRP.
+	* @see getWRPLocations
 	*/
-	Complex<Real>** calculateMWRP(void);
+	Complex<Real>** calculateMWRP(uint ch = 0);
+	/**
+	* @brief Hologram generation with multiple WRPs.
+	* @details The planes of calculateMWRP are chained from the deepest one:
+	* each is propagated to the next, added to it, and the last one is propagated to the hologram plane.
+	*/
+	void calculateMWRPCPU(void);
+	/**
+	* @brief Locations of the planes of the last calculateMWRP
+	*/
+	const std::vector<Real>& getWRPLocations() { return m_vecWRPLocation; }
 
 	inline Complex<Real>* getWRPBuff(void) { return p_wrp_; };
 
@@ -204,10 +230,30 @@ protected:
 
 private:
 
-	Complex<Real>* calSubWRP(double d, Complex<Real>* wrp, OphPointCloudData* sobj);
+	/**
+	* @brief Record the points index[0, count) on the WRP at wrp_d.
+	* @details The points are binned by the WRP tiles their windows overlap and each tile
+	* is accumulated by a single thread, so no pixel is written concurrently.
+	*/
+	void calSubWRP(Real wrp_d, Complex<Real>* wrp, const int* index, int count, uint ch);
+	/**
+	* @brief Assign the points [start, end) to the depth slabs of the multiple WRPs.
+	*/
+	void partitionMWRP(int start, int end);
+	/**
+	* @brief Record every slab of the last partitionMWRP on its own WRP.
+	*/
+	void recordMWRP(uint ch);
+	/**
+	* @brief Multiple WRP generation of the points [start, end) into complex_H.
+	*/
+	void calculateMWRPCPU(int start, int end);
+	void releaseMWRP(void);
 
-	void addPixel2WRP(int x, int y, Complex<Real> temp);
-	void addPixel2WRP(int x, int y, Complex<Real> temp, Complex<Real>* wrp);
+	/**
+	* @brief Record the points [start, end) on the WRP and propagate it to complex_H.
+	*/
+	void calculateWRPCPU(int start, int end);
 
 	virtual void ophFree(void);
 	inline Real transVW(Real pt) {
@@ -229,6 +275,14 @@ protected:
 private:
 	bool is_ViewingWindow;
 	Real zmax_;
+	Real zmin_;
+	Complex<Real>** m_pWRPList;       ///< planes of the multiple WRP
+	int m_nWRPList;
+	std::vector<Real> m_vecWRPLocation;
+	std::vector<int> m_vecWRPIndex;   ///< point indices grouped by slab
+	std::vector<int> m_vecWRPOffset;  ///< first m_vecWRPIndex of each slab
+	std::vector<char> m_vecWRPUsed;   ///< slabs holding any point of the scene
+	std::vector<Complex<Real>> m_vecRandPhase; ///< random phase of every point, empty without random phase
 	uint m_nProgress;
 
 };
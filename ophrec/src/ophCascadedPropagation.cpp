@@ -48,18 +48,39 @@
 #include "tinyxml2.h"
 #include <string>
 #include <cfloat>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
+// same index mapping as Openholo::fftShift, one row at a time
+static void shiftRows(const oph::Complex<Real>* src, oph::Complex<Real>* dst, int nx, int ny)
+{
+	const int hnx = nx >> 1;
+	const int hny = ny >> 1;
+	for (int j = 0; j < ny; j++)
+	{
+		int tj = j - hny; if (tj < 0) tj += ny;
+		memcpy(&dst[(long long int)tj * nx], &src[(long long int)j * nx + hnx], sizeof(oph::Complex<Real>) * (nx - hnx));
+		memcpy(&dst[(long long int)tj * nx + nx - hnx], &src[(long long int)j * nx], sizeof(oph::Complex<Real>) * hnx);
+	}
+}
 
 
 ophCascadedPropagation::ophCascadedPropagation()
 	: ready_to_propagate(false),
-	hologram_path(L"")
+	hologram_path(L""),
+	cascade_fft_(nullptr),
+	plan_ready_(false),
+	keep_pupil_(false)
 {
 }
 
 ophCascadedPropagation::ophCascadedPropagation(const wchar_t* configfilepath)
 	: ready_to_propagate(false),
-	hologram_path(L"")
+	hologram_path(L""),
+	cascade_fft_(nullptr),
+	plan_ready_(false),
+	keep_pupil_(false)
 {
 	if (readConfig(configfilepath) && allocateMem())
 	{
@@ -86,21 +107,167 @@ bool ophCascadedPropagation::propagate()
 		return false;
 	}
 
-	if (!propagateSlmToPupil())
+	if (!plan_ready_ && !plan())
 	{
-		PRINT_ERROR("failed to propagate to pupil plane");
+		PRINT_ERROR("failed to plan cascaded propagation");
 		return false;
 	}
 
-	if (!propagatePupilToRetina())
+	auto start_time = CUR_TIME;
+	const int numColors = (int)getNumColors();
+	const int nx = getResX();
+	const int ny = getResY();
+	const int hnx = nx >> 1;
+	const int hny = ny >> 1;
+	const long long int N = (long long int)nx * ny;
+
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(numColors)
+#endif
+	for (int color = 0; color < numColors; color++)
 	{
-		PRINT_ERROR("failed to propagate to retina plane");
-		return false;
+		const CascadePlan& plan = cascade_plans_[color];
+		oph::Complex<Real>* spec = reinterpret_cast<oph::Complex<Real>*>(cascade_buffers_[color * 2]);
+		oph::Complex<Real>* field = reinterpret_cast<oph::Complex<Real>*>(cascade_buffers_[color * 2 + 1]);
+		oph::Complex<Real>* pupil = keep_pupil_ ? getPupilWavefield(color) : nullptr;
+
+		shiftRows(getSlmWavefield(color), spec, nx, ny);
+		fftw_execute_dft(cascade_fft_, cascade_buffers_[color * 2], cascade_buffers_[color * 2]);
+
+		// pupil pixel p reads the spectrum at the unshifted index p + h and feeds the
+		// second FFT at the shifted index p - h, so no shift pass is needed in between.
+		memset(field, 0, sizeof(oph::Complex<Real>) * N);
+		if (pupil) memset(pupil, 0, sizeof(oph::Complex<Real>) * N);
+
+		for (size_t r = 0; r < plan.row.size(); r++)
+		{
+			const int row = plan.row[r];
+			int ur = row + hny; if (ur >= ny) ur -= ny;
+			int qr = row - hny; if (qr < 0) qr += ny;
+			const oph::Complex<Real>* srcRow = spec + (long long int)ur * nx;
+			oph::Complex<Real>* dstRow = field + (long long int)qr * nx;
+			const oph::Complex<Real>* kernel = &plan.kernel[plan.offset[r]];
+
+			for (int col = plan.col_begin[r]; col < plan.col_end[r]; col++)
+			{
+				int uc = col + hnx; if (uc >= nx) uc -= nx;
+				int qc = col - hnx; if (qc < 0) qc += nx;
+				oph::Complex<Real> val = srcRow[uc] * kernel[col - plan.col_begin[r]];
+				if (pupil)
+				{
+					pupil[(long long int)row * nx + col] = val;
+					val *= plan.chirp[plan.offset[r] + col - plan.col_begin[r]];
+				}
+				dstRow[qc] = val;
+			}
+		}
+
+		fftw_execute_dft(cascade_fft_, cascade_buffers_[color * 2 + 1], cascade_buffers_[color * 2 + 1]);
+		shiftRows(field, getRetinaWavefield(color), nx, ny);
 	}
 
+	auto end_time = CUR_TIME;
+
+	auto during_time = ((std::chrono::duration<Real>)(end_time - start_time)).count();
+
+	LOG("Cascaded propagation - Implement time : %.5lf sec\n", during_time);
+
 	return true;
 }
 
+bool ophCascadedPropagation::plan()
+{
+	releasePlan();
+
+	const oph::uint numColors = getNumColors();
+	const oph::uint nx = getResX();
+	const oph::uint ny = getResY();
+	if (numColors == 0 || nx == 0 || ny == 0)
+		return false;
+
+	const Real f = getFieldLensFocalLength();
+	const Real f_eye = (getFieldLensFocalLength() - getDistObjectToPupil()) * getDistPupilToRetina() / (getFieldLensFocalLength() - getDistObjectToPupil() + getDistPupilToRetina());
+	const Real d = getDistPupilToRetina();
+	const Real radius = getPupilDiameter() / 2;
+
+	cascade_plans_.resize(numColors);
+	for (oph::uint color = 0; color < numColors; color++)
+	{
+		CascadePlan& plan = cascade_plans_[color];
+		const Real lambda = getWavelengths()[color];
+		const Real k = 2 * M_PI / lambda;
+		const Real vw = lambda * f / getPixelPitchX();
+		const Real dx1 = vw / (Real)nx;
+		const Real dy1 = vw / (Real)ny;
+		const oph::Complex<Real> t2(0, lambda * f);
+
+		// rows from ny / 2 - 1 on are outside the aperture, as in propagateSlmToPupil().
+		for (oph::uint row = 0; row < ny && row < ny / 2 - 1; row++)
+		{
+			Real Y1 = ((Real)row - ((Real)ny - 1) * 0.5f) * dy1;
+			int begin = -1, end = -1;
+			for (oph::uint col = 0; col < nx; col++)
+			{
+				Real X1 = ((Real)col - ((Real)nx - 1) * 0.5f) * dx1;
+				if (sqrt(X1 * X1 + Y1 * Y1) >= radius)
+					continue;
+				if (begin < 0) begin = col;
+				end = col + 1;
+			}
+			if (begin < 0)
+				continue;
+
+			plan.row.push_back(row);
+			plan.col_begin.push_back(begin);
+			plan.col_end.push_back(end);
+			plan.offset.push_back((long long int)plan.kernel.size());
+
+			for (int col = begin; col < end; col++)
+			{
+				Real X1 = ((Real)col - ((Real)nx - 1) * 0.5f) * dx1;
+				Real rr = X1 * X1 + Y1 * Y1;
+
+				if (keep_pupil_)
+				{
+					plan.kernel.push_back(oph::Complex<Real>(0, k / 2 * rr * (1 / f - 1 / f_eye)).exp() / t2);
+					plan.chirp.push_back(oph::Complex<Real>(0, k / 2 / d * rr).exp());
+				}
+				else
+					plan.kernel.push_back(oph::Complex<Real>(0, k / 2 * rr * (1 / f - 1 / f_eye + 1 / d)).exp() / t2);
+			}
+		}
+	}
+
+	// the colors run in parallel, so each FFT gets its share of the threads.
+	const long long int N = (long long int)nx * ny;
+	for (oph::uint i = 0; i < numColors * 2; i++)
+		cascade_buffers_.push_back((fftw_complex*)fftw_malloc(sizeof(fftw_complex) * N));
+#ifdef _OPENMP
+	fftw_plan_with_nthreads((std::max)(1, omp_get_max_threads() / (int)numColors));
+#endif
+	cascade_fft_ = fftw_plan_dft_2d(ny, nx, cascade_buffers_[0], cascade_buffers_[0], FFTW_FORWARD, FFTW_ESTIMATE);
+#ifdef _OPENMP
+	fftw_plan_with_nthreads(omp_get_max_threads());
+#endif
+
+	plan_ready_ = cascade_fft_ != nullptr;
+	return plan_ready_;
+}
+
+void ophCascadedPropagation::releasePlan()
+{
+	if (cascade_fft_)
+	{
+		fftw_destroy_plan(cascade_fft_);
+		cascade_fft_ = nullptr;
+	}
+	for (auto e : cascade_buffers_)
+		fftw_free(e);
+	cascade_buffers_.clear();
+	cascade_plans_.clear();
+	plan_ready_ = false;
+}
+
 bool ophCascadedPropagation::save(const wchar_t* pathname, uint8_t bitsperpixel)
 {
 	wstring bufw(pathname);
@@ -137,6 +304,7 @@ bool ophCascadedPropagation::loadAsOhc(const char * fname)
 	oph::uint nx = getResX();
 	oph::uint ny = getResY();
 	config_.num_colors = OHC_decoder->getNumOfWavlen();
+	releasePlan();
 	for (oph::uint i = 0; i < getNumColors(); i++)
 		memcpy(wavefield_SLM[i], complex_H[i], nx * ny * sizeof(Complex<Real>));
 
@@ -164,6 +332,8 @@ bool ophCascadedPropagation::allocateMem()
 
 void ophCascadedPropagation::deallocateMem()
 {
+	releasePlan();
+
 	for (auto e : wavefield_SLM)
 		delete[] e;
 	wavefield_SLM.clear();
@@ -305,6 +475,9 @@ bool ophCascadedPropagation::readConfig(const wchar_t* fname)
 		return false;
 	}
 
+	// the plan is made from the parameters and the pixel count read below.
+	releasePlan();
+
 	xml_node = xml_doc.FirstChild();
 	auto next = xml_node->FirstChildElement("SourceType");
 	if (!next || !(next->GetText()))
@@ -177,11 +177,24 @@ class RECON_DLL ophCascadedPropagation : public ophRec {
 
 		/**
 		* @brief Do cascaded propagation
+		* @details Runs the fused plan built by plan(): one FFT, a single multiply over the pupil aperture and
+		* a second FFT per color, with the colors processed in parallel. The pupil wavefield is stored only
+		* when setKeepPupilWavefield(true) was requested.
 		* @return true if successful
 		* @return false when failed
 		*/
 		bool propagate();
 
+		/**
+		* @brief Builds the fused propagation plan
+		* @details The field lens chirp, the 1/(j lambda f) factor, the pupil aperture, the eye lens chirp and the
+		* pupil to retina chirp are merged into one kernel over the aperture support of each color.
+		* propagate() calls it whenever the configuration has changed.
+		* @return true if successful
+		* @return false when failed
+		*/
+		bool plan();
+
 		/**
 		* @brief Save wavefield at retina plane as Windows Bitmap file
 		* @param pathname: absolute or relative path of output file
@@ -273,6 +286,51 @@ class RECON_DLL ophCascadedPropagation : public ophRec {
 		*/
 		oph::uchar* getIntensityfields(vector<oph::Complex<Real>*> wavefields);
 
+		/**
+		* @brief Frees the fused propagation plan
+		*/
+		void releasePlan();
+
+		/**
+		* @brief Fused kernel of one color over the pupil aperture
+		* @details Row r of the aperture covers columns [col_begin[r], col_end[r]) and its values start at
+		* kernel[offset[r]]. When the pupil wavefield is kept, kernel stops at the pupil plane and chirp holds
+		* the pupil to retina chirp.
+		*/
+		struct CascadePlan {
+			vector<int> row;
+			vector<int> col_begin;
+			vector<int> col_end;
+			vector<long long int> offset;
+			vector<oph::Complex<Real>> kernel;
+			vector<oph::Complex<Real>> chirp;
+		};
+
+		/**
+		* @param cascade_plans_: fused kernels of each color
+		*/
+		vector<CascadePlan> cascade_plans_;
+
+		/**
+		* @param cascade_fft_: in-place forward plan shared by the colors
+		*/
+		fftw_plan cascade_fft_;
+
+		/**
+		* @param cascade_buffers_: two FFT buffers per color
+		*/
+		vector<fftw_complex*> cascade_buffers_;
+
+		/**
+		* @param plan_ready_: indicates if the fused plan matches the configuration
+		*/
+		bool plan_ready_;
+
+		/**
+		* @param keep_pupil_: indicates if propagate() stores the wavefield at pupil plane
+		*/
+		bool keep_pupil_;
+
 
 	public:
 		/**
@@ -336,6 +394,36 @@ class RECON_DLL ophCascadedPropagation : public ophRec {
 		*/
 		Real getNor() { return config_.nor; }
 
+		/**
+		* @brief Sets focal length of field lens in meter
+		*/
+		void setFieldLensFocalLength(Real in) { config_.field_lens_focal_length = in; plan_ready_ = false; }
+
+		/**
+		* @brief Sets distance from reconstruction plane to pupil plane in meter
+		*/
+		void setDistObjectToPupil(Real in) { config_.dist_reconstruction_plane_to_pupil = in; plan_ready_ = false; }
+
+		/**
+		* @brief Sets distance from pupil plane to retina plane in meter
+		*/
+		void setDistPupilToRetina(Real in) { config_.dist_pupil_to_retina = in; plan_ready_ = false; }
+
+		/**
+		* @brief Sets diameter of pupil in meter
+		*/
+		void setPupilDiameter(Real in) { config_.pupil_diameter = in; plan_ready_ = false; }
+
+		/**
+		* @brief Requests propagate() to store the wavefield at pupil plane
+		*/
+		void setKeepPupilWavefield(bool in) { if (keep_pupil_ != in) plan_ready_ = false; keep_pupil_ = in; }
+
+		/**
+		* @brief Returns if propagate() stores the wavefield at pupil plane
+		*/
+		bool getKeepPupilWavefield() { return keep_pupil_; }
+
 		/**
 		* @brief Return monochromatic wavefield at SLM plane
 		*/
@@ -70,6 +70,8 @@ void circshift(Complex<Real>* in, Complex<Real>* out, int shift_x, int shift_y,
 void ScaleBilnear(double* src, double* dst, int w, int h, int neww, int newh, double multiplyval = 1.0);
 void reArrangeChannel(std::vector<double*>& src, double* dst, int pnx, int pny, int chnum);
 void rotateCCW180(double* src, double* dst, int pnx, int pny, double mulival = 1.0);
+void cztLines(Complex<Real>* src, Complex<Real>* dst, int nLine, int n, int srcStride, int srcLineStep,
+	int m, int dstStride, int dstLineStep, Real t0, Real dt, Real u0, Real du, int sign);
 
 bool ophRec::readConfig(const char* fname)
 {
@@ -218,6 +220,39 @@ bool ophRec::readConfig(const char* fname)
 	if (!next || XML_SUCCESS != next->QueryBoolText(&rec_config.CenteringRetinaImg))
 		bRet = false;
 
+	// option : region of interest
+	next = xml_node->FirstChildElement("ROI");
+	if (!next || XML_SUCCESS != next->QueryBoolText(&rec_config.ROI))
+		rec_config.ROI = false;
+	if (rec_config.ROI)
+	{
+		next = xml_node->FirstChildElement("ROI_CenterX");
+		if (!next || XML_SUCCESS != next->QueryDoubleText(&rec_config.ROICenter[_X]))
+			rec_config.ROICenter[_X] = 0.0;
+		next = xml_node->FirstChildElement("ROI_CenterY");
+		if (!next || XML_SUCCESS != next->QueryDoubleText(&rec_config.ROICenter[_Y]))
+			rec_config.ROICenter[_Y] = 0.0;
+		next = xml_node->FirstChildElement("ROI_SizeX");
+		if (!next || XML_SUCCESS != next->QueryDoubleText(&rec_config.ROISize[_X]))
+			rec_config.ROISize[_X] = 0.0;
+		next = xml_node->FirstChildElement("ROI_SizeY");
+		if (!next || XML_SUCCESS != next->QueryDoubleText(&rec_config.ROISize[_Y]))
+			rec_config.ROISize[_Y] = 0.0;
+		next = xml_node->FirstChildElement("ROI_PixelNumX");
+		if (!next || XML_SUCCESS != next->QueryIntText(&rec_config.ROIPixelNumber[_X]))
+			rec_config.ROIPixelNumber[_X] = 0;
+		next = xml_node->FirstChildElement("ROI_PixelNumY");
+		if (!next || XML_SUCCESS != next->QueryIntText(&rec_config.ROIPixelNumber[_Y]))
+			rec_config.ROIPixelNumber[_Y] = 0;
+
+		if (rec_config.ROISize[_X] <= 0.0 || rec_config.ROISize[_Y] <= 0.0 ||
+			rec_config.ROIPixelNumber[_X] <= 0 || rec_config.ROIPixelNumber[_Y] <= 0)
+		{
+			LOG("<FAILED> Wrong region of interest. ROI is disabled.\n");
+			rec_config.ROI = false;
+		}
+	}
+
 	context_.ss[_X] = context_.pixel_number[_X] * context_.pixel_pitch[_X];
 	context_.ss[_Y] = context_.pixel_number[_Y] * context_.pixel_pitch[_Y];
 
@@ -236,6 +271,13 @@ bool ophRec::readConfig(const char* fname)
 		(imgCfg.flip == FLIP::VERTICAL) ? "VERTICAL" :
 		(imgCfg.flip == FLIP::HORIZONTAL) ? "HORIZONTAL" : "BOTH");
 	LOG("6) Image Merge : %s\n", imgCfg.merge ? "Y" : "N");
+	LOG("7) ROI : %s\n", rec_config.ROI ? "Y" : "N");
+	if (rec_config.ROI)
+	{
+		LOG(" 7-1) ROI Center : %e x %e\n", rec_config.ROICenter[_X], rec_config.ROICenter[_Y]);
+		LOG(" 7-2) ROI Size : %e x %e\n", rec_config.ROISize[_X], rec_config.ROISize[_Y]);
+		LOG(" 7-3) ROI Resolution : %d x %d\n", rec_config.ROIPixelNumber[_X], rec_config.ROIPixelNumber[_Y]);
+	}
 	LOG("**************************************************\n");
 
 	return bRet;
@@ -248,43 +290,32 @@ bool ophRec::readImage(const char* path)
 	const int N = pnX * pnY;
 
 	int w, h, bytesperpixel;
-	bool ret = getImgSize(w, h, bytesperpixel, path);
-	uchar* imgload = new uchar[w * h * bytesperpixel];
-
-	int nLine = ((w * bytesperpixel) + 3) & ~3;
-	int nSize = nLine * h;
-
-	ret = loadAsImgUpSideDown(path, imgload);
-	if (!ret) {
+	if (!getImgSize(w, h, bytesperpixel, path)) {
 		LOG("Failed::Image Load: %s\n", path);
 		return false;
 	}
-	LOG("Succeed::Image Load: %s\n", path);
-
-	uchar *tmp = new uchar[nSize];
-	memset(tmp, 0, sizeof(char) * nSize);
-
-	if (w != pnX || h != pnY)
-	{
-		for (int ch = 0; ch < bytesperpixel; ch++)
-			imgScaleBilinear(imgload, tmp, w, h, pnX, pnY, ch);
+	const int nCh = bytesperpixel < 3 ? 1 : 3;
+	// decode, separate the colors and resize in one pass.
+	uchar *img = new uchar[N * nCh];
+	uchar *imgPlane[3];
+	for (int ch = 0; ch < nCh; ch++)
+		imgPlane[ch] = img + N * ch;
+	if (!loadAsImgResampled(path, imgPlane, nCh, pnX, pnY, true)) {
+		LOG("Failed::Image Load: %s\n", path);
+		delete[] img;
+		return false;
 	}
-	else
-		memcpy(tmp, imgload, sizeof(char) * nSize);
-
-	delete[] imgload;
+	LOG("Succeed::Image Load: %s\n", path);
 
-	for (int ch = 0; ch < bytesperpixel; ch++)
+	for (int ch = 0; ch < nCh; ch++)
 	{
-		int idx = bytesperpixel - 1 - ch;
 		for (int i = 0; i < N; i++)
 		{
-			int src = i * bytesperpixel;
-			complex_H[ch][i][_RE] = Real(tmp[src + idx]);
+			complex_H[ch][i][_RE] = Real(imgPlane[ch][i]);
 			complex_H[ch][i][_IM] = 0.0;
 		}
 	}
-	delete[] tmp;
+	delete[] img;
 	return true;
 }
 
@@ -295,69 +326,44 @@ bool ophRec::readImagePNA(const char *phase, const char *amplitude)
 	const int N = pnX * pnY;
 
 	int w, h, bytesperpixel;
-	bool ret = getImgSize(w, h, bytesperpixel, phase);
-	uchar* imgload = new uchar[w * h * bytesperpixel];
-
-	int nLine = ((w * bytesperpixel) + 3) & ~3;
-	int nSize = nLine * h;
-
-	ret = loadAsImgUpSideDown(phase, imgload);
-	if (!ret) {
+	if (!getImgSize(w, h, bytesperpixel, phase)) {
 		LOG("Failed::Image Load: %s\n", phase);
 		return false;
 	}
-	LOG("Succeed::Image Load: %s\n", phase);
-
-	uchar *phaseTmp = new uchar[nSize];
-	memset(phaseTmp, 0, sizeof(char) * nSize);
-
-	if (w != pnX || h != pnY)
-	{
-		for (int ch = 0; ch < bytesperpixel; ch++)
-			imgScaleBilinear(imgload, phaseTmp, w, h, pnX, pnY, ch);
+	const int nCh = bytesperpixel < 3 ? 1 : 3;
+	// decode, separate the colors and resize in one pass.
+	uchar *phaseTmp = new uchar[N * nCh];
+	uchar *phaseTmpPlane[3];
+	for (int ch = 0; ch < nCh; ch++)
+		phaseTmpPlane[ch] = phaseTmp + N * ch;
+	if (!loadAsImgResampled(phase, phaseTmpPlane, nCh, pnX, pnY, true)) {
+		LOG("Failed::Image Load: %s\n", phase);
+		delete[] phaseTmp;
+		return false;
 	}
-	else
-		memcpy(phaseTmp, imgload, sizeof(char) * nSize);
-
-	delete[] imgload;
-
-
-	ret = getImgSize(w, h, bytesperpixel, amplitude);
-	imgload = new uchar[w * h * bytesperpixel];
-
-	nLine = ((w * bytesperpixel) + 3) & ~3;
-	nSize = nLine * h;
+	LOG("Succeed::Image Load: %s\n", phase);
 
-	ret = loadAsImgUpSideDown(amplitude, imgload);
-	if (!ret) {
+	// same planes as the first image.
+	uchar *ampTmp = new uchar[N * nCh];
+	uchar *ampTmpPlane[3];
+	for (int ch = 0; ch < nCh; ch++)
+		ampTmpPlane[ch] = ampTmp + N * ch;
+	if (!loadAsImgResampled(amplitude, ampTmpPlane, nCh, pnX, pnY, true)) {
 		LOG("Failed::Image Load: %s\n", amplitude);
+		delete[] phaseTmp;
+		delete[] ampTmp;
 		return false;
 	}
 	LOG("Succeed::Image Load: %s\n", amplitude);
 
-	uchar *ampTmp = new uchar[nSize];
-	memset(ampTmp, 0, sizeof(char) * nSize);
-
-	if (w != pnX || h != pnY)
-	{
-		for (int ch = 0; ch < bytesperpixel; ch++)
-			imgScaleBilinear(imgload, ampTmp, w, h, pnX, pnY, ch);
-	}
-	else
-		memcpy(ampTmp, imgload, sizeof(char) * nSize);
-
-	delete[] imgload;
-
 	Real PI2 = M_PI * 2;
 
-	for (int ch = 0; ch < bytesperpixel; ch++)
+	for (int ch = 0; ch < nCh; ch++)
 	{
-		int idx = bytesperpixel - 1 - ch;
 		for (int i = 0; i < N; i++)
 		{
-			int src = i * bytesperpixel;
-			Real p = Real(phaseTmp[src + idx]);
-			Real a = Real(ampTmp[src + idx]);
+			Real p = Real(phaseTmpPlane[ch][i]);
+			Real a = Real(ampTmpPlane[ch][i]);
 			p = p / 255.0 * PI2 - M_PI; // -pi ~ pi
 			a = a / 255.0; // 0 ~ 1
 			Complex<Real> tmp(0, p);
@@ -379,66 +385,42 @@ bool ophRec::readImageRNI(const char *real, const char *imag)
 	const int N = pnX * pnY;
 
 	int w, h, bytesperpixel;
-	bool ret = getImgSize(w, h, bytesperpixel, real);
-	uchar* imgload = new uchar[w * h * bytesperpixel];
-
-	int nLine = ((w * bytesperpixel) + 3) & ~3;
-	int nSize = nLine * h;
-
-	ret = loadAsImgUpSideDown(real, imgload);
-	if (!ret) {
+	if (!getImgSize(w, h, bytesperpixel, real)) {
 		LOG("Failed::Image Load: %s\n", real);
 		return false;
 	}
-	LOG("Succeed::Image Load: %s\n", real);
-
-	uchar *realTmp = new uchar[nSize];
-	memset(realTmp, 0, sizeof(char) * nSize);
-
-	if (w != pnX || h != pnY)
-	{
-		for (int ch = 0; ch < bytesperpixel; ch++)
-			imgScaleBilinear(imgload, realTmp, w, h, pnX, pnY, ch);
+	const int nCh = bytesperpixel < 3 ? 1 : 3;
+	// decode, separate the colors and resize in one pass.
+	uchar *realTmp = new uchar[N * nCh];
+	uchar *realTmpPlane[3];
+	for (int ch = 0; ch < nCh; ch++)
+		realTmpPlane[ch] = realTmp + N * ch;
+	if (!loadAsImgResampled(real, realTmpPlane, nCh, pnX, pnY, true)) {
+		LOG("Failed::Image Load: %s\n", real);
+		delete[] realTmp;
+		return false;
 	}
-	else
-		memcpy(realTmp, imgload, sizeof(char) * nSize);
-
-	delete[] imgload;
-
-
-	ret = getImgSize(w, h, bytesperpixel, imag);
-	imgload = new uchar[w * h * bytesperpixel];
-	nLine = ((w * bytesperpixel) + 3) & ~3;
-	nSize = nLine * h;
+	LOG("Succeed::Image Load: %s\n", real);
 
-	ret = loadAsImgUpSideDown(imag, imgload);
-	if (!ret) {
+	// same planes as the first image.
+	uchar *imagTmp = new uchar[N * nCh];
+	uchar *imagTmpPlane[3];
+	for (int ch = 0; ch < nCh; ch++)
+		imagTmpPlane[ch] = imagTmp + N * ch;
+	if (!loadAsImgResampled(imag, imagTmpPlane, nCh, pnX, pnY, true)) {
 		LOG("Failed::Image Load: %s\n", imag);
+		delete[] realTmp;
+		delete[] imagTmp;
 		return false;
 	}
 	LOG("Succeed::Image Load: %s\n", imag);
 
-	uchar *imagTmp = new uchar[nSize];
-	memset(imagTmp, 0, sizeof(char) * nSize);
-
-	if (w != pnX || h != pnY)
-	{
-		for (int ch = 0; ch < bytesperpixel; ch++)
-			imgScaleBilinear(imgload, imagTmp, w, h, pnX, pnY, ch);
-	}
-	else
-		memcpy(imagTmp, imgload, sizeof(char) * nSize);
-
-	delete[] imgload;
-
-	for (int ch = 0; ch < bytesperpixel; ch++)
+	for (int ch = 0; ch < nCh; ch++)
 	{
-		int idx = bytesperpixel - 1 - ch;
 		for (int i = 0; i < N; i++)
 		{
-			int src = i * bytesperpixel;
-			complex_H[ch][i][_RE] = (Real)realTmp[src + idx] / 255.0;
-			complex_H[ch][i][_IM] = (Real)imagTmp[src + idx] / 255.0;
+			complex_H[ch][i][_RE] = (Real)realTmpPlane[ch][i] / 255.0;
+			complex_H[ch][i][_IM] = (Real)imagTmpPlane[ch][i] / 255.0;
 		}
 	}
 	delete[] realTmp;
@@ -726,6 +708,164 @@ void ophRec::ASM_Propagation()
 
 }
 
+void ophRec::ASM_Propagation_ROI()
+{
+	const int pnX = context_.pixel_number[_X];
+	const int pnY = context_.pixel_number[_Y];
+	const int N = pnX * pnY;
+	const int nWave = context_.waveNum;
+
+	const Real ppX = context_.pixel_pitch[_X];
+	const Real ppY = context_.pixel_pitch[_Y];
+
+	const Real simFrom = rec_config.SimulationFrom;
+	const Real simTo = rec_config.SimulationTo;
+	const int simStep = rec_config.SimulationStep;
+	const Real simGap = (simStep > 1) ? (simTo - simFrom) / (simStep - 1) : 0;
+
+	const int roiX = rec_config.ROIPixelNumber[_X];
+	const int roiY = rec_config.ROIPixelNumber[_Y];
+	const int roiN = roiX * roiY;
+	const vec2 roiPitch(rec_config.ROISize[_X] / roiX, rec_config.ROISize[_Y] / roiY);
+
+	const Real tx = 1 / ppX;
+	const Real ty = 1 / ppY;
+	const Real dx = tx / pnX;
+	const Real dy = ty / pnY;
+
+	const Real htx = tx / 2;
+	const Real hty = ty / 2;
+	const Real hdx = dx / 2;
+	const Real hdy = dy / 2;
+	const Real baseX = -htx + hdx;
+	const Real baseY = -hty + hdy;
+
+	// sampling of the centered spectrum & the ROI (row index is opposite to y-axis)
+	const vec2 t0(-(pnX >> 1) * dx, -(pnY >> 1) * dy);
+	const vec2 dt(dx, dy);
+	const vec2 u0(rec_config.ROICenter[_X] - (roiX >> 1) * roiPitch[_X], -rec_config.ROICenter[_Y] - (roiY >> 1) * roiPitch[_Y]);
+
+	Complex<Real>* tmp = new Complex<Real>[N];
+	Complex<Real>* dst = new Complex<Real>[roiN];
+	Complex<Real>** spectrums = new Complex<Real>*[nWave];
+	Real** kernels = new Real*[nWave];
+
+	LOG("%s : Get Spectrum & Spatial Kernel\n", __FUNCTION__);
+	auto begin = CUR_TIME;
+	for (int ch = 0; ch < nWave; ch++)
+	{
+		const Real lambda = context_.wave_length[ch];
+		spectrums[ch] = new Complex<Real>[N];
+		kernels[ch] = new Real[N];
+
+		// spectrum is independent of the propagation distance.
+		fft2(complex_H[ch], spectrums[ch], pnX, pnY, FFTW_FORWARD, false);
+
+		int i;
+#ifdef _OPENMP
+#pragma omp parallel for private(i) firstprivate(pnX, lambda, dx, dy, baseX, baseY)
+#endif
+		for (i = 0; i < N; i++)
+		{
+			int x = i % pnX;
+			int y = i / pnX;
+
+			Real xx = (baseX + (x * dx)) * lambda;
+			Real yy = (baseY + (y * dy)) * lambda;
+
+			kernels[ch][i] = sqrt(1 - xx * xx - yy * yy);
+		}
+	}
+	LOG(" => %lf(s)\n", ELAPSED_TIME(begin, CUR_TIME));
+	LOG("%s : Simultation (%d x %d)\n", __FUNCTION__, roiX, roiY);
+	begin = CUR_TIME;
+
+	for (int step = 0; step < simStep; step++)
+	{
+		Real min = MAX_DOUBLE, max = MIN_DOUBLE;
+		for (int ch = 0; ch < nWave; ch++)
+		{
+			const Real lambda = context_.wave_length[ch];
+			const Real k = 2 * M_PI / lambda;
+			const Real z = simFrom + (step * simGap);
+			const Real kz = k * z;
+			Complex<Real>* spectrum = spectrums[ch];
+			Real* kernel = kernels[ch];
+
+			Real* encode = new Real[roiN];
+			uchar* normal = new uchar[roiN];
+
+			int i;
+#ifdef _OPENMP
+#pragma omp parallel for private(i) firstprivate(kz)
+#endif
+			for (i = 0; i < N; i++)
+			{
+				Complex<Real> prop(0, kz * kernel[i]);
+				prop.exp();
+				tmp[i] = spectrum[i] * prop;
+			}
+
+			CZT2(tmp, dst, ivec2(pnX, pnY), t0, dt, ivec2(roiX, roiY), u0, roiPitch, FFTW_BACKWARD);
+
+			for (i = 0; i < roiN; i++)
+			{
+				encode[i] = dst[i].mag() / N;
+
+				if (min > encode[i])
+					min = encode[i];
+				if (max < encode[i])
+					max = encode[i];
+			}
+
+			m_vecEncoded.push_back(encode);
+			m_vecNormalized.push_back(normal);
+		}
+
+		LOG("step: %d => max: %e / min: %e\n", step, max, min);
+		if (nWave == 3)
+		{
+			for (int ch = 0; ch < nWave; ch++)
+			{
+				int idx = step * nWave + ch;
+				normalize(m_vecEncoded[idx], m_vecNormalized[idx], roiX, roiY, max, min);
+			}
+		}
+		else
+			normalize(m_vecEncoded[step], m_vecNormalized[step], roiX, roiY);
+	}
+
+	m_oldSimStep = simStep;
+	LOG(" => %lf(s)\n", ELAPSED_TIME(begin, CUR_TIME));
+
+	for (int i = 0; i < nWave; i++)
+	{
+		delete[] spectrums[i];
+		delete[] kernels[i];
+	}
+	delete[] spectrums;
+	delete[] kernels;
+	delete[] tmp;
+	delete[] dst;
+}
+
+void ophRec::CZT2(Complex<Real>* src, Complex<Real>* dst, ivec2 pn_src, vec2 t0, vec2 dt, ivec2 pn_dst, vec2 u0, vec2 du, int sign)
+{
+	const int nx = pn_src[_X];
+	const int ny = pn_src[_Y];
+	const int mx = pn_dst[_X];
+	const int my = pn_dst[_Y];
+
+	Complex<Real>* mid = new Complex<Real>[ny * mx];
+
+	// rows : (nx x ny) -> (mx x ny)
+	cztLines(src, mid, ny, nx, 1, nx, mx, 1, mx, t0[_X], dt[_X], u0[_X], du[_X], sign);
+	// columns : (mx x ny) -> (mx x my)
+	cztLines(mid, dst, mx, ny, mx, 1, my, mx, 1, t0[_Y], dt[_Y], u0[_Y], du[_Y], sign);
+
+	delete[] mid;
+}
+
 void ophRec::Propagation_Fresnel_FFT(int chnum)
 {
 	LOG("Color Number: %d\n", chnum + 1);
@@ -891,6 +1031,11 @@ void ophRec::Perform_Simulation()
 
 	std::string varname2;
 
+	const bool bROI = rec_config.ROI;
+	const int roiX = rec_config.ROIPixelNumber[_X];
+	const int roiY = rec_config.ROIPixelNumber[_Y];
+	const vec2 roiPitch = bROI ? vec2(rec_config.ROISize[_X] / roiX, rec_config.ROISize[_Y] / roiY) : vec2(0.0);
+
 	for (int vtr = 0; vtr < simStep; vtr++)
 	{
 		if (simMode == 0) {
@@ -902,6 +1047,9 @@ void ophRec::Perform_Simulation()
 			if (bSimPos[_Z]) eyeCenter[_Z] = var_vals[vtr][_X];
 		}
 
+		Real retinal_image_shift_x = eyeCenter[_X] * eyeLen / eyeCenter[_Z];
+		Real retinal_image_shift_y = eyeCenter[_Y] * eyeLen / eyeCenter[_Z];
+
 		for (int ctr = 0; ctr < nChannel; ctr++)
 		{
 			lambda = context_.wave_length[ctr];
@@ -1004,42 +1152,70 @@ void ophRec::Perform_Simulation()
 
 			delete[] hh_p;
 
-			fft2(hh_e_, hh_e_, pn_p_x, pn_p_y, FFTW_FORWARD, false);
-
 			Real pp_ret_x, pp_ret_y;
 			int pn_ret_x, pn_ret_y;
 			vec2 ret_size_xy;
 
-			pp_ret_x = lambda * eyeLen / ss_p_x;
-			pp_ret_y = lambda * eyeLen / ss_p_y;
-			pn_ret_x = pn_p_x;
-			pn_ret_y = pn_p_y;
-			ret_size_xy[0] = pp_ret_x * pn_ret_x;
-			ret_size_xy[1] = pp_ret_y * pn_ret_y;
+			if (bROI)
+			{
+				// evaluate the retinal field only inside the ROI.
+				// |val1 * val2 / val3| of the full-frame path is 1 / (lambda * eyeLen).
+				Real lambdaL = lambda * eyeLen;
+				pp_ret_x = roiPitch[_X];
+				pp_ret_y = roiPitch[_Y];
+				pn_ret_x = roiX;
+				pn_ret_y = roiY;
+
+				vec2 dt(pp_p_x / lambdaL, pp_p_y / lambdaL);
+				vec2 t0(-(pn_p_x >> 1) * dt[_X], -(pn_p_y >> 1) * dt[_Y]);
+				Real cx = rec_config.ROICenter[_X] + (bCenteringRetinaImg ? retinal_image_shift_x : 0.0);
+				Real cy = rec_config.ROICenter[_Y] + (bCenteringRetinaImg ? retinal_image_shift_y : 0.0);
+				vec2 u0(cx - (roiX >> 1) * pp_ret_x, -cy - (roiY >> 1) * pp_ret_y);
+
+				Complex<Real>* hh_roi = new Complex<Real>[roiX * roiY];
+				CZT2(hh_e_, hh_roi, ivec2(pn_p_x, pn_p_y), t0, dt, ivec2(roiX, roiY), u0, roiPitch, FFTW_FORWARD);
+
+				field_ret_set_[ctr] = new Real[roiX * roiY];
+				for (loopp = 0; loopp < roiX * roiY; loopp++)
+					field_ret_set_[ctr][loopp] = hh_roi[loopp].mag() / lambdaL;
+
+				delete[] hh_roi;
+			}
+			else
+			{
+				fft2(hh_e_, hh_e_, pn_p_x, pn_p_y, FFTW_FORWARD, false);
 
-			field_ret_set_[ctr] = new Real[pn_p_x * pn_p_y];
-			memset(field_ret_set_[ctr], 0.0, sizeof(Real)*pn_p_x*pn_p_y);
+				pp_ret_x = lambda * eyeLen / ss_p_x;
+				pp_ret_y = lambda * eyeLen / ss_p_y;
+				pn_ret_x = pn_p_x;
+				pn_ret_y = pn_p_y;
+				ret_size_xy[0] = pp_ret_x * pn_ret_x;
+				ret_size_xy[1] = pp_ret_y * pn_ret_y;
 
-			//#pragma omp parallel for private(loopp)	
-			for (loopp = 0; loopp < pn_p_x*pn_p_y; loopp++)
-			{
-				int x = loopp % pn_p_x;
-				int y = loopp / pn_p_x;
+				field_ret_set_[ctr] = new Real[pn_p_x * pn_p_y];
+				memset(field_ret_set_[ctr], 0.0, sizeof(Real)*pn_p_x*pn_p_y);
 
-				Real XR = ret_size_xy[0] / 2.0 + (pp_ret_x * x);
-				Real YR = ret_size_xy[1] / 2.0 - pp_ret_y - (pp_ret_y * y);
+				//#pragma omp parallel for private(loopp)	
+				for (loopp = 0; loopp < pn_p_x*pn_p_y; loopp++)
+				{
+					int x = loopp % pn_p_x;
+					int y = loopp / pn_p_x;
 
-				Real sval = (XR*XR) + (YR*YR);
-				sval *= k / (2 * eyeLen);
-				Complex<Real> val1(0, sval);
-				val1.exp();
+					Real XR = ret_size_xy[0] / 2.0 + (pp_ret_x * x);
+					Real YR = ret_size_xy[1] / 2.0 - pp_ret_y - (pp_ret_y * y);
 
-				Complex<Real> val2(0, k * eyeLen);
-				val2.exp();
-				Complex<Real> val3(0, lambda * eyeLen);
+					Real sval = (XR*XR) + (YR*YR);
+					sval *= k / (2 * eyeLen);
+					Complex<Real> val1(0, sval);
+					val1.exp();
 
-				field_ret_set_[ctr][x + pn_p_x * y] = (hh_e_[x + pn_p_x * y] * (val1 * val2 / val3)).mag();
+					Complex<Real> val2(0, k * eyeLen);
+					val2.exp();
+					Complex<Real> val3(0, lambda * eyeLen);
 
+					field_ret_set_[ctr][x + pn_p_x * y] = (hh_e_[x + pn_p_x * y] * (val1 * val2 / val3)).mag();
+
+				}
 			}
 			delete[] hh_e_;
 
@@ -1086,9 +1262,6 @@ void ophRec::Perform_Simulation()
 			pny_max = (pn_ret_set_[i][1] > pny_max ? pn_ret_set_[i][1] : pny_max);
 		}
 
-		Real retinal_image_shift_x = eyeCenter[_X] * eyeLen / eyeCenter[_Z];
-		Real retinal_image_shift_y = eyeCenter[_Y] * eyeLen / eyeCenter[_Z];
-
 		res_set_.resize(nChannel);
 		res_set_norm_255_.resize(nChannel);
 
@@ -1100,7 +1273,8 @@ void ophRec::Perform_Simulation()
 			Real* hh_ret_ = new Real[pn_ret_set_[loopi][0] * pn_ret_set_[loopi][1]];
 			memset(hh_ret_, 0.0, sizeof(Real)*pn_ret_set_[loopi][0] * pn_ret_set_[loopi][1]);
 
-			if (bCenteringRetinaImg)
+			// in ROI mode, the window is already centered on the retinal image.
+			if (bCenteringRetinaImg && !bROI)
 			{
 				Real retinal_image_shift_by_pn_x = round(retinal_image_shift_x / pp_ret_set_[loopi][0]);
 				Real retinal_image_shift_by_pn_y = round(retinal_image_shift_y / pp_ret_set_[loopi][1]);
@@ -1109,7 +1283,7 @@ void ophRec::Perform_Simulation()
 
 			}
 			else
-				hh_ret_ = field_ret_set_[loopi];
+				memcpy(hh_ret_, field_ret_set_[loopi], sizeof(Real) * pn_ret_set_[loopi][0] * pn_ret_set_[loopi][1]);
 
 			delete[] field_ret_set_[loopi];
 
@@ -1117,6 +1291,7 @@ void ophRec::Perform_Simulation()
 			res_set_[loopi] = new Real[size];
 			memset(res_set_[loopi], 0.0, sizeof(Real) * size);
 			ScaleBilnear(hh_ret_, res_set_[loopi], pn_ret_set_[loopi][0], pn_ret_set_[loopi][1], pnx_max, pny_max, lambda * lambda);
+			delete[] hh_ret_;
 
 		}
 
@@ -1288,8 +1463,8 @@ void ophRec::SaveImage(const char *path, const char *ext)
 
 	if (m_idx == 0)
 	{
-		pnX = context_.pixel_number[_X];
-		pnY = context_.pixel_number[_Y];
+		pnX = rec_config.ROI ? rec_config.ROIPixelNumber[_X] : context_.pixel_number[_X];
+		pnY = rec_config.ROI ? rec_config.ROIPixelNumber[_Y] : context_.pixel_number[_Y];
 	}
 	else
 	{
@@ -1486,7 +1661,13 @@ bool ophRec::ReconstructImage()
 #endif
 	);
 
-	m_mode & MODE_GPU ? ASM_Propagation_GPU() : ASM_Propagation();
+	if (rec_config.ROI)
+	{
+		LOG("3) Region of Interest : %d x %d (Chirp-Z)\n", rec_config.ROIPixelNumber[_X], rec_config.ROIPixelNumber[_Y]);
+		ASM_Propagation_ROI();
+	}
+	else
+		m_mode & MODE_GPU ? ASM_Propagation_GPU() : ASM_Propagation();
 	
 	LOG("Total Elapsed Time: %lf (s)\n", ELAPSED_TIME(begin, CUR_TIME));
 	return true;
@@ -1666,4 +1847,91 @@ void reArrangeChannel(std::vector<double*>& src, double* dst, int pnx, int pny,
 		}
 
 	}
-}
\ No newline at end of file
+}
+
+void cztLines(Complex<Real>* src, Complex<Real>* dst, int nLine, int n, int srcStride, int srcLineStep,
+	int m, int dstStride, int dstLineStep, Real t0, Real dt, Real u0, Real du, int sign)
+{
+	// Bluestein : u*t = u0*t0 + u0*j*dt + i*du*t0 + (i^2 + j^2 - (i-j)^2) / 2 * du*dt
+	const int L = getOptimalFFTSize(n + m - 1);
+	const Real alpha = sign * 2 * M_PI * du * dt;
+	const Real halfAlpha = alpha / 2;
+
+	Complex<Real>* pre = new Complex<Real>[n];
+	Complex<Real>* post = new Complex<Real>[m];
+	fftw_complex* chirp = (fftw_complex*)fftw_malloc(sizeof(fftw_complex) * L);
+	memset(chirp, 0, sizeof(fftw_complex) * L);
+
+	for (int j = 0; j < n; j++)
+	{
+		pre[j][_RE] = 0;
+		pre[j][_IM] = sign * 2 * M_PI * u0 * dt * j + halfAlpha * j * j;
+		pre[j].exp();
+	}
+	for (int i = 0; i < m; i++)
+	{
+		post[i][_RE] = 0;
+		post[i][_IM] = sign * 2 * M_PI * (u0 + du * i) * t0 + halfAlpha * i * i;
+		post[i].exp();
+	}
+	for (int k = 0; k < m; k++)
+	{
+		chirp[k][_RE] = cos(-halfAlpha * k * k);
+		chirp[k][_IM] = sin(-halfAlpha * k * k);
+	}
+	for (int k = 1; k < n; k++)
+	{
+		chirp[L - k][_RE] = cos(-halfAlpha * k * k);
+		chirp[L - k][_IM] = sin(-halfAlpha * k * k);
+	}
+
+	// each line is transformed by a single thread.
+	fftw_plan_with_nthreads(1);
+	fftw_plan plan_fwd = fftw_plan_dft_1d(L, chirp, chirp, FFTW_FORWARD, FFTW_ESTIMATE);
+	fftw_plan plan_bwd = fftw_plan_dft_1d(L, chirp, chirp, FFTW_BACKWARD, FFTW_ESTIMATE);
+	fftw_plan_with_nthreads(omp_get_max_threads());
+
+	fftw_execute_dft(plan_fwd, chirp, chirp);
+	for (int k = 0; k < L; k++)
+	{
+		chirp[k][_RE] /= L;
+		chirp[k][_IM] /= L;
+	}
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+	{
+		fftw_complex* buf = (fftw_complex*)fftw_malloc(sizeof(fftw_complex) * L);
+		Complex<Real>* line = reinterpret_cast<Complex<Real>*>(buf);
+		Complex<Real>* filter = reinterpret_cast<Complex<Real>*>(chirp);
+
+#ifdef _OPENMP
+#pragma omp for
+#endif
+		for (int l = 0; l < nLine; l++)
+		{
+			Complex<Real>* in = src + l * srcLineStep;
+			Complex<Real>* out = dst + l * dstLineStep;
+
+			for (int j = 0; j < n; j++)
+				line[j] = in[j * srcStride] * pre[j];
+			memset(&line[n], 0, sizeof(Complex<Real>) * (L - n));
+
+			fftw_execute_dft(plan_fwd, buf, buf);
+			for (int k = 0; k < L; k++)
+				line[k] *= filter[k];
+			fftw_execute_dft(plan_bwd, buf, buf);
+
+			for (int i = 0; i < m; i++)
+				out[i * dstStride] = line[i] * post[i];
+		}
+		fftw_free(buf);
+	}
+
+	fftw_destroy_plan(plan_fwd);
+	fftw_destroy_plan(plan_bwd);
+	fftw_free(chirp);
+	delete[] pre;
+	delete[] post;
+}
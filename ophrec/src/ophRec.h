@@ -85,12 +85,16 @@ struct RECON_DLL OphRecConfig
 	bool CenteringRetinaImg;
 	bool ViewingWindow;
 	bool SimulationPos[3];
+	bool ROI;							// reconstruct only the region of interest
+	vec2 ROICenter;						// center of the region of interest
+	vec2 ROISize;						// physical size of the region of interest
+	ivec2 ROIPixelNumber;				// number of samples of the region of interest
 
 	OphRecConfig()
 		: EyeLength(0.0), EyePupilDiaMeter(0.0), EyeBoxSizeScale(0.0), EyeBoxSize(0.0, 0.0), EyeBoxUnit(0),
 		EyeCenter(0.0, 0.0, 0.0), EyeFocusDistance(0.0), ResultSizeScale(0.0), SimulationTo(0.0), SimulationFrom(0.0),
 		SimulationStep(0), SimulationMode(0), RatioAtRetina(0.0), RatioAtPupil(0.0), CreatePupilFieldImg(false),
-		CenteringRetinaImg(false), ViewingWindow(false)
+		CenteringRetinaImg(false), ViewingWindow(false), ROI(false), ROICenter(0.0, 0.0), ROISize(0.0, 0.0), ROIPixelNumber(0, 0)
 	{
 		SimulationPos[0] = SimulationPos[1] = SimulationPos[2] = false;
 	}
@@ -158,12 +162,47 @@ protected:
 	void Propagation_Fresnel_FFT(int chnum);
 	void ASM_Propagation();
 	void ASM_Propagation_GPU();
+	/**
+	* @brief Angular spectrum propagation evaluated only inside the region of interest.
+	* @details The spectrum of each channel is computed once, and the propagated field is
+	*	evaluated on the ROI grid(ROICenter, ROISize, ROIPixelNumber) by the chirp-z transform.
+	* @see CZT2
+	*/
+	void ASM_Propagation_ROI();
+	/**
+	* @brief 2D chirp-z transform.
+	* @details dst(u) = sum{ src(t) * exp(sign * i2pi * u * t) } for each axis,@n
+	*	where t = t0 + n * dt (n = 0 ~ pn_src - 1) and u = u0 + m * du (m = 0 ~ pn_dst - 1).
+	* @param[in] src Source data.
+	* @param[out] dst Destination data.
+	* @param[in] pn_src Number of source samples.
+	* @param[in] t0 Source coordinate of the first sample.
+	* @param[in] dt Source sampling interval.
+	* @param[in] pn_dst Number of destination samples.
+	* @param[in] u0 Destination coordinate of the first sample.
+	* @param[in] du Destination sampling interval.
+	* @param[in] sign Sign of the exponent(FFTW_FORWARD or FFTW_BACKWARD).
+	*/
+	void CZT2(Complex<Real>* src, Complex<Real>* dst, ivec2 pn_src, vec2 t0, vec2 dt, ivec2 pn_dst, vec2 u0, vec2 du, int sign);
 	void GetPupilFieldImage(Complex<Real>* src, double* dst, int pnx, int pny, double ppx, double ppy, double scaleX, double scaleY);
 	void getVarname(int vtr, vec3& var_vals, std::string& varname2);
 public:
 	void SaveImage(const char* path, const char* ext = "bmp");
 	void setConfig(OphRecConfig config) { rec_config = config; }
 	void SetMode(unsigned int mode) { m_mode = mode; }
+	/**
+	* @brief Function for setting the region of interest of the reconstruction
+	* @param[in] bROI If true, only the region of interest is reconstructed.
+	* @param[in] center Center of the region of interest.
+	* @param[in] size Physical size of the region of interest.
+	* @param[in] pixel_number Number of samples of the region of interest.
+	*/
+	void SetROI(bool bROI, vec2 center = vec2(0.0), vec2 size = vec2(0.0), ivec2 pixel_number = ivec2(0)) {
+		rec_config.ROI = bROI;
+		rec_config.ROICenter = center;
+		rec_config.ROISize = size;
+		rec_config.ROIPixelNumber = pixel_number;
+	}
 	OphRecConfig& getConfig() { return rec_config; }
 	bool ReconstructImage();
 	bool readConfig(const char* fname);